@@ -1,4 +1,8 @@
 #include <pebble.h>
+#include "span_fill.h"
+#include "frame_profiler.h"
+#include "battery_ledger.h"
+#include "settings_sync.h"
 
 // ================================
 //  定義
@@ -7,41 +11,27 @@
 #define NUM_TEN_BLOCKS 5
 #define NUM_MIN_BLOCKS 9
 
+// フリック後に秒ブロックを点滅させる時間（秒）
+#define SECOND_MODE_WINDOW_S 30
+
 // ------------------------------
-// 座標定義
+// 設定（電話の設定画面から。common/c/settings_sync.h）
 // ------------------------------
+enum { SETTING_INVERT, SETTING_SECOND_WINDOW, SETTING_COUNT };
 
-// 12時間（32x36）
-static const GRect HOUR_RECTS[NUM_HOUR_BLOCKS] = {
-  {{0,0}, {32,36}}, {{33,0}, {32,36}}, {{67,0}, {32,36}}, {{100,0}, {32,36}},
-  {{134,0}, {32,36}}, {{167,0}, {32,36}},
-  {{0,37}, {32,36}}, {{33,37}, {32,36}}, {{67,37}, {32,36}}, {{100,37}, {32,36}},
-  {{134,37}, {32,36}}, {{167,37}, {32,36}},
-};
-
-// 10分（65x74）
-static const GRect TEN_RECTS[NUM_TEN_BLOCKS] = {
-  {{0,75}, {65,74}},
-  {{67,75}, {65,74}},
-  {{134,75}, {65,74}},
-  {{0,151}, {65,74}},
-  {{67,151}, {65,74}},
+static const SettingDef SETTINGS[SETTING_COUNT] = {
+  [SETTING_INVERT] = { &MESSAGE_KEY_invert_colors, 1, 0, 1, 0 },
+  [SETTING_SECOND_WINDOW] = { &MESSAGE_KEY_second_window, 2, 5, 120, SECOND_MODE_WINDOW_S },
 };
+static int32_t s_settings[SETTING_COUNT];
 
-// 1分（32x14）×9個
-static const GRect MIN_RECTS[NUM_MIN_BLOCKS] = {
-  {{134,151}, {32,14}},
-  {{134,166}, {32,14}},
-  {{134,181}, {32,14}},
-  {{134,196}, {32,14}},
-  {{134,211}, {32,14}},
-  {{167,151}, {32,14}},
-  {{167,166}, {32,14}},
-  {{167,181}, {32,14}},
-  {{167,196}, {32,14}},
-};
+// ------------------------------
+// 座標定義
+// ------------------------------
 
-static const GRect SEC_RECT = {{167,211}, {32,14}};
+// プラットフォームごとの HOUR_RECTS / TEN_RECTS / MIN_RECTS / SEC_RECT / TEXT_RECT は
+// wscript が layout.json から生成する（画面サイズごとの計算はビルド時に済ませる）
+#include "layout.auto.h"
 
 // ================================
 //  状態管理
@@ -52,69 +42,94 @@ static bool hour_active[NUM_HOUR_BLOCKS];
 static bool ten_active[NUM_TEN_BLOCKS];
 static bool min_active[NUM_MIN_BLOCKS];
 static bool sec_on;
-static bool invert_colors = false;
+static bool invert_colors = false;   // s_settings[SETTING_INVERT] の写し
+
+// ------------------------------
+// 描画キャッシュ（分単位）
+// ------------------------------
+// 時・10分・1分ブロックは1分間変わらないので、分が変わった最初のフレームで
+// 描いたものを 1bit のオフスクリーンに保存し、毎秒のフレームはそれを貼って
+// 小さい時刻と秒ブロックだけ描く（文字はアンチエイリアスがあるので毎回描く）。
+static GBitmap *s_cache;
+static int s_cache_stamp = -1;   // キャッシュした時刻（時*60+分）、-1 = 無効
+static int s_minute_stamp;       // 現在の時刻（時*60+分）
+// カラーは 1bit パレット（0 = 背景、1 = ブロック）で、反転はパレットを入れ替えるだけ。
+// aplite はフレームバッファの 1bit をそのまま写し、反転は合成モードで行う
+#ifdef PBL_COLOR
+static GColor s_cache_palette[2];
+#else
+static bool s_cache_inverted;
+#endif
+
+// ------------------------------
+// 省電力モード
+// ------------------------------
+// 普段は MINUTE_UNIT で1分に1回だけ起きる。手首をフリックすると
+// s_second_mode_window 秒だけ SECOND_UNIT に切り替えて秒を点滅させる。
+static TimeUnits s_tick_unit;            // 現在購読中の単位（0 = 未購読）
+static time_t s_second_mode_until;       // この時刻を過ぎたら分モードへ戻る
+static int s_second_mode_window = SECOND_MODE_WINDOW_S;  // s_settings[SETTING_SECOND_WINDOW]
+
+// 電池消費の記録（battery_ledger）で使うモード
+enum { LEDGER_MINUTE, LEDGER_SECOND };
+static const char *const LEDGER_MODES[] = { "minute", "second" };
 
 // ----------------------------------------------------------
 // クリック
 // ----------------------------------------------------------
 static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
   invert_colors = !invert_colors;
+  settings_sync_set(SETTING_INVERT, invert_colors);
   layer_mark_dirty(s_layer);
 }
 
 static void click_config_provider(void *context) {
   window_single_click_subscribe(BUTTON_ID_UP, up_click_handler);
+  battery_ledger_long_click_subscribe(BUTTON_ID_UP);
+  frame_profiler_long_click_subscribe(BUTTON_ID_DOWN);
 }
 
-// ★ これを追加
-static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
-
 // ================================
 //  描画処理
 // ================================
-static void layer_update_proc(Layer *layer, GContext *ctx) {
-
-  GColor bg = invert_colors ? GColorWhite : GColorBlack;
-  GColor fg = invert_colors ? GColorBlack : GColorWhite;
 
-  graphics_context_set_fill_color(ctx, bg);
-  graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
+// 分単位で変わるブロック（時・10分・1分）
+static void draw_minute_blocks(Layer *layer, GContext *ctx, GColor bg, GColor fg) {
+  // 矩形はまとめてフレームバッファへ直接塗る
+  SpanFill fill;
+  span_fill_begin(&fill, ctx, layer);
 
-  graphics_context_set_fill_color(ctx, fg);
+  span_fill_rect(&fill, layer_get_bounds(layer), bg);
 
   // 時刻
   for(int i=0;i<NUM_HOUR_BLOCKS;i++){
     if(hour_active[i])
-      graphics_fill_rect(ctx, HOUR_RECTS[i], 0, GCornerNone);
+      span_fill_rect(&fill, HOUR_RECTS[i], fg);
   }
 
   for(int i=0;i<NUM_TEN_BLOCKS;i++){
     if(ten_active[i])
-      graphics_fill_rect(ctx, TEN_RECTS[i], 0, GCornerNone);
+      span_fill_rect(&fill, TEN_RECTS[i], fg);
   }
 
   for(int i=0;i<NUM_MIN_BLOCKS;i++){
     if(min_active[i])
-      graphics_fill_rect(ctx, MIN_RECTS[i], 0, GCornerNone);
+      span_fill_rect(&fill, MIN_RECTS[i], fg);
   }
 
-  if(sec_on)
-    graphics_fill_rect(ctx, SEC_RECT, 0, GCornerNone);
-
+  span_fill_end(&fill);
+}
 
-  // ----------------------------------------
-  // 小さいデジタル文字（50分ブロックの上）
-  // ----------------------------------------
+// 小さいデジタル文字（50分ブロックの上／丸型は中央の下）
+static void draw_small_time(GContext *ctx, GColor bg, GColor fg) {
   time_t now = time(NULL);
   struct tm *t = localtime(&now);
 
   static char small_time[6];
   snprintf(small_time, sizeof(small_time), "%02d:%02d", t->tm_hour, t->tm_min);
 
-  GRect text_rect = GRect(TEN_RECTS[4].origin.x, 200, 65, 20);
+  bool block_on = (TEXT_OVER_TEN >= 0) && ten_active[TEXT_OVER_TEN];
 
-  bool block_on = ten_active[4];
-  
   // ブロックがONなら背景は fg → 文字色は bg
   // ブロックがOFFなら背景は bg → 文字色は fg
   GColor text_color = block_on ? bg : fg;
@@ -124,14 +139,91 @@ static void layer_update_proc(Layer *layer, GContext *ctx) {
   graphics_draw_text(
     ctx,
     small_time,
-    fonts_get_system_font(FONT_KEY_GOTHIC_24),
-    text_rect,
+    fonts_get_system_font(TEXT_FONT_KEY),
+    TEXT_RECT,
     GTextOverflowModeTrailingEllipsis,
     GTextAlignmentCenter,
     NULL
   );
 }
 
+// 描き終えたブロックをキャッシュへ写す
+static void cache_capture(GContext *ctx, GColor fg) {
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if(!fb) return;
+
+  GRect fb_bounds = gbitmap_get_bounds(fb);
+  GRect cache_bounds = gbitmap_get_bounds(s_cache);
+  int h = MIN(fb_bounds.size.h, cache_bounds.size.h);
+  int w = MIN(fb_bounds.size.w, cache_bounds.size.w);
+
+  for(int y=0;y<h;y++){
+    GBitmapDataRowInfo src = gbitmap_get_data_row_info(fb, y);
+    GBitmapDataRowInfo dst = gbitmap_get_data_row_info(s_cache, y);
+#ifdef PBL_COLOR
+    // 8bit → 1bit（ブロックは矩形だけなので fg かどうかで決まる。
+    // 丸型は行ごとに描ける範囲だけ）
+    int max_x = MIN(src.max_x, w - 1);
+    for(int x=src.min_x;x<=max_x;x++){
+      uint8_t bit = 0x80 >> (x & 7);
+      if(src.data[x] == fg.argb)
+        dst.data[x >> 3] |= bit;
+      else
+        dst.data[x >> 3] &= ~bit;
+    }
+#else
+    memcpy(dst.data, src.data, (w + 7) / 8);
+#endif
+  }
+
+  graphics_release_frame_buffer(ctx, fb);
+
+#ifndef PBL_COLOR
+  s_cache_inverted = invert_colors;
+#endif
+  s_cache_stamp = s_minute_stamp;
+}
+
+static void draw_cache(GContext *ctx, GRect bounds, GColor bg, GColor fg) {
+#ifdef PBL_COLOR
+  s_cache_palette[0] = bg;
+  s_cache_palette[1] = fg;
+#else
+  graphics_context_set_compositing_mode(ctx,
+    (invert_colors != s_cache_inverted) ? GCompOpAssignInverted : GCompOpAssign);
+#endif
+  graphics_draw_bitmap_in_rect(ctx, s_cache, bounds);
+#ifndef PBL_COLOR
+  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+#endif
+}
+
+static void layer_update_proc(Layer *layer, GContext *ctx) {
+
+  GColor bg = invert_colors ? GColorWhite : GColorBlack;
+  GColor fg = invert_colors ? GColorBlack : GColorWhite;
+  GRect bounds = layer_get_bounds(layer);
+
+  if(s_cache && s_cache_stamp == s_minute_stamp) {
+    // 1分以内：キャッシュを貼るだけ
+    draw_cache(ctx, bounds, bg, fg);
+  } else {
+    // 分が変わった（またはキャッシュなし）：ブロックを描いて保存
+    draw_minute_blocks(layer, ctx, bg, fg);
+    if(s_cache)
+      cache_capture(ctx, fg);
+  }
+
+  draw_small_time(ctx, bg, fg);
+
+  if(sec_on) {
+    SpanFill fill;
+    span_fill_begin(&fill, ctx, layer);
+    span_fill_rect(&fill, SEC_RECT, fg);
+    span_fill_end(&fill);
+  }
+}
+
 // ================================
 //  時刻ロジック
 // ================================
@@ -152,7 +244,10 @@ static void update_time(struct tm *t) {
     min_active[i] = (i < one);
   }
 
-  sec_on = (t->tm_sec % 2 == 0);
+  // 分モード中は秒ブロックを消しておく
+  sec_on = (s_tick_unit == SECOND_UNIT) && (t->tm_sec % 2 == 0);
+
+  s_minute_stamp = t->tm_hour * 60 + t->tm_min;
 
   layer_mark_dirty(s_layer);
 }
@@ -160,8 +255,47 @@ static void update_time(struct tm *t) {
 // ================================
 //  Tick Handler
 // ================================
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
+
+static void set_tick_unit(TimeUnits unit) {
+  if(unit == s_tick_unit) return;
+  s_tick_unit = unit;
+  tick_timer_service_subscribe(unit, tick_handler);
+  battery_ledger_set_mode(unit == SECOND_UNIT ? LEDGER_SECOND : LEDGER_MINUTE);
+}
+
+// 秒モードの期限切れを確認してから表示を更新する
+static void sync_time(struct tm *t) {
+  if(s_tick_unit == SECOND_UNIT && time(NULL) >= s_second_mode_until) {
+    set_tick_unit(MINUTE_UNIT);
+  }
+  update_time(t);
+}
+
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
-  update_time(tick_time);
+  sync_time(tick_time);
+}
+
+// フリック → 秒モード（連続したフリックは期限を延ばすだけ）
+static void accel_tap_handler(AccelAxisType axis, int32_t direction) {
+  time_t now = time(NULL);
+  s_second_mode_until = now + s_second_mode_window;
+  set_tick_unit(SECOND_UNIT);
+  update_time(localtime(&now));
+}
+
+// 通知などから戻ったとき、止まっていた間の分と秒モードの期限を反映する
+static void app_focus_handler(bool in_focus) {
+  if(!in_focus) return;
+  time_t now = time(NULL);
+  sync_time(localtime(&now));
+}
+
+// 電話から設定が届いた（秒モード中の期限は次のフリックから）
+static void settings_changed(uint32_t changed) {
+  invert_colors = s_settings[SETTING_INVERT];
+  s_second_mode_window = s_settings[SETTING_SECOND_WINDOW];
+  if(s_layer) layer_mark_dirty(s_layer);
 }
 
 // ================================
@@ -172,15 +306,26 @@ static void window_load(Window *window) {
   GRect bounds = layer_get_bounds(root);
 
   s_layer = layer_create(bounds);
-  layer_set_update_proc(s_layer, layer_update_proc);
+  frame_profiler_attach(s_layer, layer_update_proc);
   layer_add_child(root, s_layer);
 
+  // 確保できなければキャッシュなしで毎回全部描く
+#ifdef PBL_COLOR
+  s_cache = gbitmap_create_blank_with_palette(bounds.size, GBitmapFormat1BitPalette,
+                                              s_cache_palette, false);
+#else
+  s_cache = gbitmap_create_blank(bounds.size, GBitmapFormat1Bit);
+#endif
+  s_cache_stamp = -1;
+
   time_t now = time(NULL);
   struct tm *t = localtime(&now);
   update_time(t);
 }
 
 static void window_unload(Window *window) {
+  gbitmap_destroy(s_cache);
+  s_cache = NULL;
   layer_destroy(s_layer);
 }
 
@@ -188,10 +333,17 @@ static void window_unload(Window *window) {
 //  main
 // ================================
 static void init(void) {
+  frame_profiler_init("9blocks");
+  battery_ledger_init(LEDGER_MODES, ARRAY_LENGTH(LEDGER_MODES));
+  settings_sync_init(&MESSAGE_KEY_settings_revision, SETTINGS, s_settings, SETTING_COUNT,
+                     settings_changed);
+  settings_changed(0);
+
   s_window = window_create();
   window_set_click_config_provider(s_window, click_config_provider);
 
-  window_set_background_color(s_window, GColorBlack);
+  // 背景はレイヤーが全面を塗る（キャッシュを貼るフレームで二重に塗らない）
+  window_set_background_color(s_window, GColorClear);
 
   window_set_window_handlers(s_window, (WindowHandlers){
     .load = window_load,
@@ -199,11 +351,21 @@ static void init(void) {
   });
 
   window_stack_push(s_window, true);
-  tick_timer_service_subscribe(SECOND_UNIT, tick_handler);
+  set_tick_unit(MINUTE_UNIT);
+  accel_tap_service_subscribe(accel_tap_handler);
+  app_focus_service_subscribe_handlers((AppFocusHandlers){
+    .did_focus = app_focus_handler,
+  });
 }
 
 static void deinit(void) {
+  settings_sync_deinit();
+  app_focus_service_unsubscribe();
+  accel_tap_service_unsubscribe();
+  tick_timer_service_unsubscribe();
   window_destroy(s_window);
+  battery_ledger_deinit();
+  frame_profiler_deinit();
 }
 
 int main(void) {
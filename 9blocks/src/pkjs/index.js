@@ -1,5 +1,8 @@
-Pebble.addEventListener("ready",
-    function(e) {
-        console.log("Hello world! - Sent from your javascript application.");
-    }
-);
+// 設定画面とウォッチへの同期（アプリ間で共有。wscript が一緒に同梱する）
+var settings = require('../../../common/pkjs/settings_sync');
+
+// fallback は src/c/9blocks.c の SETTINGS と同じ値
+settings.init('9blocks', [
+  { key: 'invert_colors', label: 'Invert colors', type: 'toggle', fallback: 0 },
+  { key: 'second_window', label: 'Seconds shown after a flick', min: 5, max: 120, fallback: 30 }
+]);
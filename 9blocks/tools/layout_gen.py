@@ -0,0 +1,150 @@
+#
+# 9blocks のレイアウト記述（layout.json）から、プラットフォームごとの
+# static const GRect テーブルを持つヘッダを生成する。
+#
+# wscript の build() から呼ばれる。単体でも
+#   python tools/layout_gen.py layout.json out.h
+# で実行できる。
+#
+import json
+import math
+import os
+import sys
+
+NUM_HOUR_BLOCKS = 12
+NUM_TEN_BLOCKS = 5
+NUM_MIN_BLOCKS = 9
+
+
+def tens_and_minutes(x0, y0, width, ten_row_y, ten_h):
+    """10分ブロック（3列x2段の5枠）と、6枠目に入る1分+秒ブロック。"""
+    col = (width + 1) // 3
+    ten_w = col - 2
+    small_w = (ten_w - 1) // 2
+    ten_ys = (ten_row_y, ten_row_y + ten_h + 2)
+
+    tens = [(x0 + c * col, y0 + ten_ys[r], ten_w, ten_h)
+            for r in range(2) for c in range(3)][:NUM_TEN_BLOCKS]
+
+    min_h = (ten_h - 4) // 5
+    cells = [(x0 + 2 * col + c * (small_w + 1), y0 + ten_ys[1] + r * (min_h + 1), small_w, min_h)
+             for c in range(2) for r in range(5)]
+    return tens, cells[:NUM_MIN_BLOCKS], cells[NUM_MIN_BLOCKS]
+
+
+def rect_layout(p):
+    w, h = p['screen']
+    col = (w + 1) // 3
+    ten_w = col - 2
+    hour_w = (ten_w - 1) // 2
+    hour_h = (h - 12) // 6
+    ten_h = 2 * hour_h + 2
+
+    hours = [(c * col + half * (hour_w + 1), r * (hour_h + 1), hour_w, hour_h)
+             for r in range(2) for c in range(3) for half in range(2)]
+    tens, mins, sec = tens_and_minutes(0, 0, w, 2 * hour_h + 3, ten_h)
+
+    tx, ty, tw, th = tens[4]
+    text = (tx, ty + th - p['text_bottom'], tw, p['text_height'])
+    return hours, tens, mins, sec, text, 4
+
+
+def round_layout(p):
+    w, h = p['screen']
+    cx, cy = w // 2, h // 2
+    radius = p['ring_radius']
+    block = p['ring_block']
+
+    # 時は文字盤の 1〜12 時の位置に並べる
+    hours = []
+    for i in range(NUM_HOUR_BLOCKS):
+        angle = math.radians((i + 1) * 30)
+        x = int(round(cx + radius * math.sin(angle) - block / 2))
+        y = int(round(cy - radius * math.cos(angle) - block / 2))
+        hours.append((x, y, block, block))
+
+    # 10分・1分は内側の正方形に四角い画面と同じ並びで入れる
+    size = p['inner_size']
+    x0, y0 = cx - size // 2, cy - size // 2
+    tens, mins, sec = tens_and_minutes(x0, y0, size, 0, (size - 2) // 2)
+
+    # 文字は内側の正方形の真下、5 時と 7 時のブロックの間（幅と高さは layout.json で収める）
+    tw = p['text_width']
+    text = (cx - tw // 2, y0 + size, tw, p['text_height'])
+    return hours, tens, mins, sec, text, -1
+
+
+def intersects(a, b):
+    ax, ay, aw, ah = a
+    bx, by, bw, bh = b
+    return ax < bx + bw and bx < ax + aw and ay < by + bh and by < ay + ah
+
+
+def check_overlaps(name, hours, tens, mins, sec, text, text_over_ten):
+    """どの矩形も重ならないこと（文字と、その下の 10 分ブロックだけは重ねて描く）。"""
+    named = ([('hour %d' % (i + 1), r) for i, r in enumerate(hours)] +
+             [('ten %d' % i, r) for i, r in enumerate(tens)] +
+             [('min %d' % i, r) for i, r in enumerate(mins)] +
+             [('sec', sec), ('text', text)])
+    allowed = ('text', 'ten %d' % text_over_ten)
+    for i, (a_name, a) in enumerate(named):
+        for b_name, b in named[i + 1:]:
+            if (b_name, a_name) == allowed or (a_name, b_name) == allowed:
+                continue
+            assert not intersects(a, b), '%s: %s %r と %s %r が重なる' % (name, a_name, a, b_name, b)
+
+
+def rect_list(rects):
+    return ',\n'.join('  {{%d,%d}, {%d,%d}}' % r for r in rects)
+
+
+def platform_block(directive, name, p):
+    layout = round_layout(p) if p['shape'] == 'round' else rect_layout(p)
+    hours, tens, mins, sec, text, text_over_ten = layout
+    assert len(hours) == NUM_HOUR_BLOCKS and len(tens) == NUM_TEN_BLOCKS
+    check_overlaps(name, *layout)
+    return '\n'.join([
+        '#%s defined(PBL_PLATFORM_%s)' % (directive, name.upper()),
+        '// %s: %dx%d %s' % (name, p['screen'][0], p['screen'][1], p['shape']),
+        'static const GRect HOUR_RECTS[NUM_HOUR_BLOCKS] = {\n%s\n};' % rect_list(hours),
+        'static const GRect TEN_RECTS[NUM_TEN_BLOCKS] = {\n%s\n};' % rect_list(tens),
+        'static const GRect MIN_RECTS[NUM_MIN_BLOCKS] = {\n%s\n};' % rect_list(mins),
+        'static const GRect SEC_RECT = {{%d,%d}, {%d,%d}};' % sec,
+        'static const GRect TEXT_RECT = {{%d,%d}, {%d,%d}};' % text,
+        '#define TEXT_FONT_KEY %s' % p['font'],
+        '#define TEXT_OVER_TEN %d  // 文字の下にある10分ブロック（-1 = なし）' % text_over_ten,
+    ])
+
+
+def generate(descriptor):
+    platforms = descriptor['platforms']
+    blocks = [platform_block('if' if i == 0 else 'elif', name, platforms[name])
+              for i, name in enumerate(sorted(platforms))]
+    return '\n'.join([
+        '// このファイルは tools/layout_gen.py が layout.json から生成する。編集しないこと。',
+        '#pragma once',
+        '',
+        '\n\n'.join(blocks),
+        '#else',
+        '#error "9blocks: layout.json にこのプラットフォームのレイアウトがない"',
+        '#endif',
+        '',
+    ])
+
+
+def write_header(descriptor_path, header_path):
+    with open(descriptor_path) as f:
+        text = generate(json.load(f))
+
+    # 内容が同じなら書かない（不要な再コンパイルを避ける）
+    if os.path.exists(header_path):
+        with open(header_path) as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(header_path) or '.', exist_ok=True)
+    with open(header_path, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    write_header(sys.argv[1], sys.argv[2])
@@ -1,52 +1,98 @@
 #include <pebble.h>
-
-#define TILE_SIZE 20
-#define MAP_COLS 10
-#define MAP_ROWS 9
+#include "span_fill.h"
+#include "frame_profiler.h"
+#include "battery_ledger.h"
+#include "level.h"
+#include "rules.h"
+#include "map_gen.h"
+#include "policy.h"
+#include "save.h"
+#include "level_upload.h"
+#include "replay.h"
+#include "settings_sync.h"
+
+// マスの大きさは画面の幅から決める（横 10 マス。emery 20px、basalt/aplite 14px、chalk 18px）
+#define TILE_SIZE (PBL_DISPLAY_WIDTH / 10)
+// 下の HUD（チェック表示・ダイス・劣化）の高さ
+#define HUD_HEIGHT 40
+// 丸型は四隅が欠けるので、マップを内側に寄せる（chalk 27px）。下は HUD が円の中に
+// 収まるよう半分だけ空ける。四角い画面は 0
+#define VIEW_INSET PBL_IF_ROUND_ELSE(PBL_DISPLAY_WIDTH * 3 / 20, 0)
+#define VIEW_X VIEW_INSET
+#define VIEW_Y VIEW_INSET
+// 一度に映すマス数。マップはこれより大きくてよい（カメラがプレイヤーを追う）
+#define VIEW_COLS ((PBL_DISPLAY_WIDTH - 2 * VIEW_INSET) / TILE_SIZE)
+#define VIEW_ROWS ((PBL_DISPLAY_HEIGHT - VIEW_INSET * 3 / 2 - HUD_HEIGHT) / TILE_SIZE)
+// HUD はマップの真下に、マップと同じ幅で置く
+#define HUD_X VIEW_X
+#define HUD_Y (VIEW_Y + VIEW_ROWS * TILE_SIZE)
+#define HUD_W (VIEW_COLS * TILE_SIZE)
+// 劣化ブロックの間隔（MAX_DECAY 個が HUD の幅に収まる。emery 13px、basalt 9px、chalk 8px）。
+// ダイスの目も同じ間隔で並べる
+#define HUD_STRIDE (HUD_W / MAX_DECAY)
+#define HUD_BLOCK (HUD_STRIDE - 2)
 
 // ---- グローバル変数（必ず先に置く） ----
 static Window *s_main_window;
 static Layer *s_map_layer;
 
-static int player_x;   // 列（0〜9）
-static int player_y;   // 行（0〜8）
-static int dice_result = 0;
+// 位置・向き・劣化・残りの目など（ルールは rules.c）
+static GameState s_game;
+
+// 電池消費の記録（battery_ledger）で使うモード
+enum { LEDGER_IDLE, LEDGER_PLAY };
+static const char *const LEDGER_MODES[] = { "idle", "play" };
+
+// 最後の操作からこの時間（ミリ秒）何もなければ待機扱いに戻す
+#define PLAY_IDLE_TIMEOUT_MS 30000
+static AppTimer *s_play_idle_timer;
 
-static int move_dir = 0;       // 0=上, 1=右, 2=下, 3=左
-static bool moving_phase = false; // true=プレイヤーは移動待ち
 
-static int decay = 0;   // 荷物の劣化（0〜10）
-#define MAX_DECAY 15
 
-static bool game_over = false;
-static bool passed_check = false;
-static bool game_clear = false;
+// ---- マップデータ ----
+// 今のレベルだけをパック形式のまま持つ（地形 enum と形式は level.h）。
+// 大きいマップはヘッダだけで、タイルは見たチャンクだけパックから読む。
+// 電話から送られてくるマップ（level_upload）は表示していない方へ直接書き、
+// 検査が通ったら s_level を付け替える
+static Level s_level_buffers[2];
+static Level *s_level = &s_level_buffers[0];
+static bool s_level_loaded = false;
+static int s_level_index = 0;
+
+// 電話から送られたマップを遊んでいる間の s_level_index（パックは 255 個まで）
+#define LEVEL_INDEX_UPLOADED 255
+
+static TileType tile_at(int x, int y) {
+  return level_tile(s_level, x, y);
+}
+
+static bool load_level(int index) {
+  s_level_loaded = level_pack_load(index, s_level);
+  if (s_level_loaded) {
+    s_level_index = index;
+  }
+  return s_level_loaded;
+}
 
+// ---- エンドレスモード（map_gen で作ったマップを続けて遊ぶ） ----
+static bool s_endless = false;
+static uint32_t s_endless_seed;
+static int s_endless_count = 0;
+static int s_endless_difficulty;   // 今のマップを作ったときの難しさ（リプレイで作り直す）
 
+// ---- ヒント（パックのレベルだけ。表は policy.c） ----
+static bool s_hint_enabled = false;
 
-// ---- 地形 enum ----
-typedef enum {
-  TILE_EMPTY = 0,
-  TILE_MOUNTAIN,
-  TILE_RIVER,
-  TILE_STRANDED,
-  TILE_START,
-  TILE_CHECK,
-  TILE_GOAL
-} TileType;
+// ---- 設定（電話の設定画面から。common/c/settings_sync.h） ----
+// persist のキー 1・2 は save.h（遊びかけと記録）
+enum { SETTING_DIFFICULTY, SETTING_HINT, SETTING_COUNT };
 
-// ---- マップデータ ----
-static TileType map[MAP_ROWS][MAP_COLS] = {
-  {TILE_GOAL, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_RIVER, TILE_RIVER, TILE_RIVER},
-  {TILE_EMPTY, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_EMPTY, TILE_EMPTY, TILE_RIVER, TILE_RIVER, TILE_RIVER, TILE_MOUNTAIN, TILE_MOUNTAIN},
-  {TILE_EMPTY, TILE_EMPTY, TILE_STRANDED, TILE_CHECK, TILE_RIVER, TILE_RIVER, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN},
-  {TILE_EMPTY, TILE_EMPTY, TILE_RIVER, TILE_RIVER, TILE_RIVER, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN},
-  {TILE_EMPTY, TILE_RIVER, TILE_RIVER, TILE_STRANDED, TILE_STRANDED, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN},
-  {TILE_RIVER, TILE_RIVER, TILE_STRANDED, TILE_STRANDED, TILE_STRANDED, TILE_EMPTY, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN},
-  {TILE_MOUNTAIN, TILE_RIVER, TILE_MOUNTAIN, TILE_STRANDED, TILE_STRANDED, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY},
-  {TILE_MOUNTAIN, TILE_RIVER, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY},
-  {TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_MOUNTAIN, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_START}
+static const SettingDef SETTINGS[SETTING_COUNT] = {
+  [SETTING_DIFFICULTY] = { &MESSAGE_KEY_difficulty, 3, 0, MAP_GEN_DIFFICULTY_COUNT - 1,
+                           MAP_GEN_NORMAL },
+  [SETTING_HINT]       = { &MESSAGE_KEY_hint, 4, 0, 1, 0 },
 };
+static int32_t s_settings[SETTING_COUNT];
 
 
 // ---- 色定義 ----
@@ -59,57 +105,477 @@ static GColor tile_color(TileType t) {
   }
 }
 
-// ---- 関数プロトタイプ ----
-static void get_cursor_position(int *cx, int *cy) {
-  *cx = player_x;
-  *cy = player_y;
+//ダイスの出目制限
+// 山 1〜2、川 1〜3、座礁 1 固定、それ以外 1〜4（rules_dice_max）。
+// 目はゲームごとのシードから振る（replay.h。シードと歩いた向きでゲームを再生できる）
+static int roll_dice_for_tile(TileType tile) {
+  return replay_roll(rules_dice_max(tile));
+}
+
+
+//マップ内チェック
+static bool is_in_map(int x, int y) {
+  return rules_in_level(s_level, x, y);
+}
+
+// ---- カメラ（画面の左上に映すマス） ----
+// プレイヤーが画面の端から CAMERA_MARGIN マス以内に来たら、プレイヤーが真ん中に
+// 来るように動かす（マップの外は映さない）。マップが画面に収まる向きは 0 のまま。
+#define CAMERA_MARGIN 2
+static int s_cam_x, s_cam_y;
 
-  switch(move_dir) {
-    case 0: *cy -= 1; break; // 上
-    case 1: *cx -= 1; break; // 左
-    case 2: *cy += 1; break; // 下
-    case 3: *cx += 1; break; // 右
+static int camera_axis(int cam, int player, int view, int size) {
+  if (size <= view) return 0;
+  if (player < cam + CAMERA_MARGIN || player >= cam + view - CAMERA_MARGIN) {
+    cam = player - view / 2;
   }
+  if (cam < 0) cam = 0;
+  if (cam > size - view) cam = size - view;
+  return cam;
 }
 
-//クリアランク
-static const char* get_rank_text(int decay) {
-  if (decay <= 8)      return "EXCELLENT!!";
-  else if (decay <= 11) return "GOOD!";
-  else                 return "SO SO";
+// マスの左上の画面座標
+static GPoint tile_origin(int x, int y) {
+  return GPoint(VIEW_X + (x - s_cam_x) * TILE_SIZE, VIEW_Y + (y - s_cam_y) * TILE_SIZE);
 }
 
-//ダイスの出目制限
-static int roll_dice_for_tile(TileType tile) {
-  switch(tile) {
-    case TILE_MOUNTAIN:
-      return (rand() % 2) + 1;   // 1〜2
-    case TILE_RIVER:
-      return (rand() % 3) + 1;   // 1〜3
-    case TILE_STRANDED:
-      return 1;                  // 1固定
-    default:
-      return (rand() % 4) + 1;   // 1〜4
+// ---- 地形キャッシュ ----
+// 地形は変わらないので、画面に映る範囲だけをビットマップにしておき、
+// カメラが動いたときだけ作り直す（大きさは画面で決まり、マップの大きさによらない）。
+// カラー機は 2bit パレット（emery 200x180 で約 9KB）、白黒機は 1bit。
+// 毎フレームはこれを貼って、ドット・START/GOAL/CHECK・プレイヤー・HUD を上に描く。
+static GBitmap *s_terrain;
+static int s_terrain_cam_x = -1, s_terrain_cam_y;   // s_terrain を作ったときのカメラ（-1 は作り直し）
+
+// パレット番号 → 色（tile_color と同じ 4 色）
+static GColor s_terrain_palette[4];
+
+static uint8_t terrain_index(TileType t) {
+  switch(t) {
+    case TILE_MOUNTAIN: return 1;
+    case TILE_RIVER: return 2;
+    case TILE_STRANDED: return 3;
+    default: return 0;
   }
 }
 
+// START / GOAL / CHECK の位置（毎フレームマップ全体を見ないで済むように）
+#define MAX_SPECIALS 3
+typedef struct {
+  GPoint tile;     // マスの位置
+  TileType type;
+} SpecialTile;
+
+static SpecialTile s_specials[MAX_SPECIALS];
+static int s_special_count;
+
+// CHECK とカーソルの三角形（マスの左上からの相対座標）。gpath_move_to で動かす
+static const GPathInfo TRIANGLE_PATH_INFO = {
+  .num_points = 3,
+  .points = (GPoint[]){ {TILE_SIZE / 2, TILE_SIZE / 5},
+                        {TILE_SIZE / 5, TILE_SIZE * 4 / 5},
+                        {TILE_SIZE * 4 / 5, TILE_SIZE * 4 / 5} }
+};
+static GPath *s_triangle_path;
+
+// 1 行のうち [x0, x1) 画素をパレット番号 index にする（行は 0 で埋めてある）
+static void terrain_fill_span(uint8_t *row, int x0, int x1, uint8_t index) {
+#ifdef PBL_COLOR
+  // 2bit: 1 バイト 4 画素、左の画素が上位ビット。揃っている間は memset
+  for (; x0 < x1 && (x0 & 3); x0++) row[x0 >> 2] |= index << (6 - (x0 & 3) * 2);
+  int bytes = (x1 - x0) >> 2;
+  memset(row + (x0 >> 2), index * 0x55, bytes);
+  for (x0 += bytes * 4; x0 < x1; x0++) row[x0 >> 2] |= index << (6 - (x0 & 3) * 2);
+#else
+  // 1bit: 左の画素が下位ビット。淡い色は白、濃い色は黒
+  GColor c = s_terrain_palette[index];
+  if (c.r + c.g + c.b >= 6) {
+    for (int x = x0; x < x1; x++) {
+      row[x >> 3] |= 1 << (x & 7);
+    }
+  }
+#endif
+}
 
-//マップ内チェック
-static bool is_in_map(int x, int y) {
-  return (x >= 0 && x < MAP_COLS && y >= 0 && y < MAP_ROWS);
+// カメラが動いたとき（とレベルが変わったとき）に呼ぶ。ビットマップは画面の大きさで一度だけ作る
+static void build_terrain(void) {
+  s_terrain_cam_x = s_cam_x;
+  s_terrain_cam_y = s_cam_y;
+  if (!s_terrain) {
+    GSize size = GSize(VIEW_COLS * TILE_SIZE, VIEW_ROWS * TILE_SIZE);
+    s_terrain_palette[0] = tile_color(TILE_EMPTY);
+    s_terrain_palette[1] = tile_color(TILE_MOUNTAIN);
+    s_terrain_palette[2] = tile_color(TILE_RIVER);
+    s_terrain_palette[3] = tile_color(TILE_STRANDED);
+
+#ifdef PBL_COLOR
+    s_terrain = gbitmap_create_blank_with_palette(size, GBitmapFormat2BitPalette,
+                                                  s_terrain_palette, false);
+#else
+    s_terrain = gbitmap_create_blank(size, GBitmapFormat1Bit);
+#endif
+    if (!s_terrain) return;   // 確保できなければ毎回直接塗る
+  }
+
+  uint8_t *data = gbitmap_get_data(s_terrain);
+  uint16_t stride = gbitmap_get_bytes_per_row(s_terrain);
+
+  for (int vy = 0; vy < VIEW_ROWS; vy++) {
+    // マスの 1 行目を作り、残りの行はコピーする
+    uint8_t *row = data + vy * TILE_SIZE * stride;
+    memset(row, 0, stride);
+
+    for (int vx = 0; vx < VIEW_COLS; vx++) {
+      // レベルの外は平地と同じ色
+      int tx = s_cam_x + vx, ty = s_cam_y + vy;
+      uint8_t index = is_in_map(tx, ty) ? terrain_index(tile_at(tx, ty)) : 0;
+      terrain_fill_span(row, vx * TILE_SIZE, (vx + 1) * TILE_SIZE, index);
+    }
+
+    for (int y = 1; y < TILE_SIZE; y++) {
+      memcpy(row + y * stride, row, stride);
+    }
+  }
+}
+
+// 位置はレベルのヘッダにあるのでマップを走査しない
+static void find_specials(void) {
+  s_special_count = 0;
+  if (!s_level_loaded) return;
+  s_specials[s_special_count++] = (SpecialTile){
+    GPoint(level_start_x(s_level), level_start_y(s_level)), TILE_START };
+  s_specials[s_special_count++] = (SpecialTile){
+    GPoint(level_check_x(s_level), level_check_y(s_level)), TILE_CHECK };
+  s_specials[s_special_count++] = (SpecialTile){
+    GPoint(level_goal_x(s_level), level_goal_y(s_level)), TILE_GOAL };
+}
+
+// ---- 行き先の先読み（rules_reach） ----
+// 振ったあと（と 1 歩ごと）に、移動が終わりうるマスを求めて内側の枠で示す。
+// 求めるのは描き直しを頼むとき（redraw_all）。向きを変えただけでは変わらないので、
+// 向き以外が同じなら求め直さない
+static RulesReach s_reach;
+static GameState s_reach_for;
+static bool s_reach_valid;
+
+static void update_reach(void) {
+  GameState key = s_game;
+  key.dir = 0;
+  if (s_reach_valid && memcmp(&key, &s_reach_for, sizeof(key)) == 0) return;
+  rules_reach(&s_game, s_level, &s_reach);
+  s_reach_for = key;
+  s_reach_valid = true;
+}
+
+// レベルが変わったら呼ぶ（地形は次の描画で今のカメラの位置に作る）
+static void level_changed(void) {
+  s_cam_x = s_cam_y = 0;
+  s_terrain_cam_x = -1;
+  s_reach_valid = false;
+  find_specials();
+}
+
+// プレイヤーに合わせてカメラを動かし、動いたら地形を作り直す
+static void update_camera(void) {
+  s_cam_x = camera_axis(s_cam_x, s_game.x, VIEW_COLS, level_cols(s_level));
+  s_cam_y = camera_axis(s_cam_y, s_game.y, VIEW_ROWS, level_rows(s_level));
+  if (s_cam_x != s_terrain_cam_x || s_cam_y != s_terrain_cam_y) {
+    build_terrain();
+  }
+}
+
+// ビットマップに入っている色（白黒機は淡い色が白、濃い色が黒）
+static GColor terrain_color(TileType t) {
+#ifdef PBL_COLOR
+  return tile_color(t);
+#else
+  GColor c = tile_color(t);
+  return (c.r + c.g + c.b >= 6) ? GColorWhite : GColorBlack;
+#endif
+}
+
+// マス [x0, x1) x [y0, y1) の地形・中央ドット・START/GOAL/CHECK を描く（画面に映るマスだけ。
+// ヒープ確保なし）。画面全体ならキャッシュのビットマップを貼り、一部ならそのマスだけ同じ色で塗る
+static void draw_terrain(Layer *layer, GContext *ctx, int x0, int y0, int x1, int y1) {
+  SpanFill fill;
+  bool whole = x0 <= s_cam_x && y0 <= s_cam_y &&
+               x1 >= s_cam_x + VIEW_COLS && y1 >= s_cam_y + VIEW_ROWS;
+  if (x0 < s_cam_x) x0 = s_cam_x;
+  if (y0 < s_cam_y) y0 = s_cam_y;
+  if (x1 > s_cam_x + VIEW_COLS) x1 = s_cam_x + VIEW_COLS;
+  if (y1 > s_cam_y + VIEW_ROWS) y1 = s_cam_y + VIEW_ROWS;
+  if (x1 > level_cols(s_level)) x1 = level_cols(s_level);
+  if (y1 > level_rows(s_level)) y1 = level_rows(s_level);
+
+  if (whole && s_terrain) {
+    GRect bounds = gbitmap_get_bounds(s_terrain);
+    graphics_draw_bitmap_in_rect(ctx, s_terrain,
+                                 GRect(VIEW_X, VIEW_Y, bounds.size.w, bounds.size.h));
+    span_fill_begin(&fill, ctx, layer);
+  } else {
+    span_fill_begin(&fill, ctx, layer);
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+        GPoint o = tile_origin(x, y);
+        span_fill_rect(&fill, GRect(o.x, o.y, TILE_SIZE, TILE_SIZE), terrain_color(tile_at(x, y)));
+      }
+    }
+  }
+
+  // 中央の小さな黒ドット（2x2）
+  for (int y = y0; y < y1; y++) {
+    for (int x = x0; x < x1; x++) {
+      GPoint o = tile_origin(x, y);
+      span_fill_rect(&fill, GRect(o.x + TILE_SIZE / 2 - 1, o.y + TILE_SIZE / 2 - 1, 2, 2),
+                     GColorBlack);
+    }
+  }
+  span_fill_end(&fill);
+
+  // 移動が終わりうるマス（rules_reach の窓の中だけ見る）
+  if (s_game.moving && s_reach_valid) {
+    graphics_context_set_stroke_width(ctx, 1);
+    graphics_context_set_stroke_color(ctx, PBL_IF_COLOR_ELSE(GColorOrange, GColorBlack));
+    for (int y = MAX(y0, s_reach.y0); y < MIN(y1, s_reach.y0 + RULES_REACH_SIZE); y++) {
+      for (int x = MAX(x0, s_reach.x0); x < MIN(x1, s_reach.x0 + RULES_REACH_SIZE); x++) {
+        if (!rules_reach_has(&s_reach, x, y)) continue;
+#ifndef PBL_COLOR
+        // 白黒機は濃いマスの上だけ白で
+        bool dark = gcolor_equal(terrain_color(tile_at(x, y)), GColorBlack);
+        graphics_context_set_stroke_color(ctx, dark ? GColorWhite : GColorBlack);
+#endif
+        GPoint o = tile_origin(x, y);
+        graphics_draw_rect(ctx, GRect(o.x + 2, o.y + 2, TILE_SIZE - 4, TILE_SIZE - 4));
+      }
+    }
+  }
+
+  // START / GOAL / CHECK（円とパスは SDK で描く）
+  for (int i = 0; i < s_special_count; i++) {
+    GPoint t = s_specials[i].tile;
+    if (t.x < x0 || t.x >= x1 || t.y < y0 || t.y >= y1) continue;
+    GPoint o = tile_origin(s_specials[i].tile.x, s_specials[i].tile.y);
+    GPoint center = GPoint(o.x + TILE_SIZE / 2, o.y + TILE_SIZE / 2);
+    switch (s_specials[i].type) {
+      case TILE_START:
+        graphics_context_set_fill_color(ctx, GColorRed);
+        graphics_fill_circle(ctx, center, TILE_SIZE * 3 / 10);
+        break;
+      case TILE_GOAL:
+        graphics_context_set_fill_color(ctx, GColorBlack);
+        graphics_fill_circle(ctx, center, TILE_SIZE * 3 / 10);
+        break;
+      case TILE_CHECK:
+        if (s_triangle_path) {
+          graphics_context_set_fill_color(ctx, GColorGreen);
+          gpath_move_to(s_triangle_path, o);
+          gpath_draw_filled(ctx, s_triangle_path);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// ---- アニメーション（駒の移動・ダイスを振る） ----
+// 状態（s_game）は先に進めておき、見た目だけが後から追いかける。
+// 始めと終わりのフレームは全体を描き、間のフレームは動いたところだけを描く
+// （駒：前の位置と今の位置にかかるマス、ダイス：HUD のダイス欄）。ウィンドウの背景を
+// 透明にしてあるので、描かなかったところは前のフレームのまま残る。
+// 前のフレームがまだ描かれていないとき、描画時間から決めた間隔が空いていないときは
+// そのフレームを飛ばす（溜めない。次のフレームで今の進み具合を描く）。
+#define MOVE_ANIM_MS 150
+#define ROLL_ANIM_MS 300
+#define ROLL_FACE_MS 50         // 振っている間にダイスの目を変える間隔
+#define ANIM_MIN_FRAME_MS 33    // 速くても 30fps
+#define ANIM_MAX_FRAME_MS 100   // 遅い機種でも 10fps
+#define SPRITE_RADIUS (TILE_SIZE * 7 / 20)
+
+typedef enum { ANIM_NONE, ANIM_MOVE, ANIM_ROLL } AnimKind;
+
+static Animation *s_anim;
+static AnimKind s_anim_kind = ANIM_NONE;
+static AnimationProgress s_anim_progress;
+static GPoint s_anim_from, s_anim_to;   // 駒の中心（画面座標）
+
+static bool s_sprite_only;      // 次の描画は動いたところだけ
+static bool s_frame_pending;    // 描画を頼んだがまだ描かれていない
+static GPoint s_sprite_drawn;   // 最後に描いた駒の中心
+static int s_dice_drawn;        // 最後に描いたダイスの目
+static uint32_t s_last_frame_ms;
+static uint32_t s_frame_cost_ms;   // 部分描画にかかった時間（移動平均）
+
+static uint32_t now_ms(void) {
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  return (uint32_t)t * 1000 + ms;
+}
+
+// 描画時間の 2 倍を間隔にする（描画で CPU を埋めない）
+static uint32_t anim_frame_interval(void) {
+  uint32_t interval = s_frame_cost_ms * 2;
+  if (interval < ANIM_MIN_FRAME_MS) return ANIM_MIN_FRAME_MS;
+  if (interval > ANIM_MAX_FRAME_MS) return ANIM_MAX_FRAME_MS;
+  return interval;
+}
+
+static GPoint tile_center(int x, int y) {
+  GPoint o = tile_origin(x, y);
+  return GPoint(o.x + TILE_SIZE / 2, o.y + TILE_SIZE / 2);
+}
+
+// 今描く駒の中心
+static GPoint sprite_center(void) {
+  if (s_anim_kind != ANIM_MOVE) return tile_center(s_game.x, s_game.y);
+  int32_t p = s_anim_progress;
+  return GPoint(s_anim_from.x + (s_anim_to.x - s_anim_from.x) * p / ANIMATION_NORMALIZED_MAX,
+                s_anim_from.y + (s_anim_to.y - s_anim_from.y) * p / ANIMATION_NORMALIZED_MAX);
+}
+
+// 今描くダイスの目（振っている間は目を回す。乱数はゲームの分を進めない）
+static int dice_shown(void) {
+  if (s_anim_kind != ANIM_ROLL) return s_game.dice;
+  int max = rules_dice_max(tile_at(s_game.x, s_game.y));
+  uint32_t elapsed = (uint32_t)s_anim_progress * ROLL_ANIM_MS / ANIMATION_NORMALIZED_MAX;
+  return (s_game.dice + elapsed / ROLL_FACE_MS) % max + 1;
+}
+
+// 全体を描き直す（ボタン・レベルの切り替え・アニメーションの始めと終わり）
+static void redraw_all(void) {
+  update_reach();
+  s_sprite_only = false;
+  s_frame_pending = true;
+  layer_mark_dirty(s_map_layer);
+}
+
+static void anim_update(Animation *animation, const AnimationProgress progress) {
+  s_anim_progress = progress;
+  if (s_frame_pending) return;
+  if (now_ms() - s_last_frame_ms < anim_frame_interval()) return;
+
+  // 見た目が変わらなければ描かない
+  if (s_anim_kind == ANIM_MOVE) {
+    GPoint c = sprite_center();
+    if (gpoint_equal(&s_sprite_drawn, &c)) return;
+  }
+  if (s_anim_kind == ANIM_ROLL && s_dice_drawn == dice_shown()) return;
+
+  s_sprite_only = true;
+  s_frame_pending = true;
+  layer_mark_dirty(s_map_layer);
+}
+
+static void anim_stopped(Animation *animation, bool finished, void *context) {
+  s_anim = NULL;
+  s_anim_kind = ANIM_NONE;
+  redraw_all();
+}
+
+static const AnimationImplementation ANIM_IMPLEMENTATION = {
+  .update = anim_update,
+};
+
+static void stop_anim(void) {
+  if (s_anim) {
+    animation_unschedule(s_anim);   // anim_stopped が片付ける（Animation は SDK が破棄する）
+  }
+}
+
+static void start_anim(AnimKind kind, uint32_t duration_ms) {
+  stop_anim();
+  s_anim = animation_create();
+  if (!s_anim) return;   // 作れなければ動かさずに描く
+  s_anim_kind = kind;
+  s_anim_progress = 0;
+  animation_set_duration(s_anim, duration_ms);
+  animation_set_curve(s_anim, kind == ANIM_MOVE ? AnimationCurveEaseInOut : AnimationCurveLinear);
+  animation_set_implementation(s_anim, &ANIM_IMPLEMENTATION);
+  animation_set_handlers(s_anim, (AnimationHandlers) { .stopped = anim_stopped }, NULL);
+  animation_schedule(s_anim);
 }
 
 // ---- マップ描画 ----
-static void map_layer_update(Layer *layer, GContext *ctx) {
+static void draw_player(GContext *ctx, GPoint center) {
+  graphics_context_set_stroke_color(ctx, GColorRed);
+  graphics_context_set_stroke_width(ctx, 2);
+  graphics_draw_circle(ctx, center, SPRITE_RADIUS);
+  graphics_draw_circle(ctx, center, TILE_SIZE * 3 / 10);
+  s_sprite_drawn = center;
+}
+
+// ダイス欄（全体の描画と、振っている間の部分描画で使う）
+#define DICE_MAX_FACES 4
+#define DICE_X (HUD_X + HUD_W - DICE_MAX_FACES * HUD_STRIDE)   // 右寄せ
+#define DICE_Y (HUD_Y + 4)
+
+static void draw_dice(GContext *ctx, int count) {
+  TileType tile = tile_at(s_game.x, s_game.y);
+  GColor dice_color = GColorRed;
+
+  switch(tile) {
+    case TILE_MOUNTAIN: dice_color = GColorArmyGreen; break;
+    case TILE_RIVER:    dice_color = GColorBlue;      break;
+    case TILE_STRANDED: dice_color = GColorLightGray; break;
+    default:            dice_color = GColorRed;       break;
+  }
+
+  graphics_context_set_fill_color(ctx, dice_color);
+  for (int i = 0; i < count; i++) {
+    graphics_fill_rect(ctx, GRect(DICE_X + i * HUD_STRIDE, DICE_Y, HUD_BLOCK, HUD_BLOCK), 0,
+                       GCornerNone);
+  }
+  s_dice_drawn = count;
+}
+
+// 間のフレーム：駒の前の位置と今の位置にかかるマスだけ描き直して駒を描く
+static void draw_sprite_frame(Layer *layer, GContext *ctx) {
+  GPoint c = sprite_center();
+  int r = SPRITE_RADIUS + 2;
+  // マップの左上からの座標
+  int left = MAX(MIN(s_sprite_drawn.x, c.x) - r - VIEW_X, 0);
+  int top = MAX(MIN(s_sprite_drawn.y, c.y) - r - VIEW_Y, 0);
+  int right = MAX(s_sprite_drawn.x, c.x) + r - VIEW_X;
+  int bottom = MAX(s_sprite_drawn.y, c.y) + r - VIEW_Y;
+  draw_terrain(layer, ctx, s_cam_x + left / TILE_SIZE, s_cam_y + top / TILE_SIZE,
+               s_cam_x + right / TILE_SIZE + 1, s_cam_y + bottom / TILE_SIZE + 1);
+  draw_player(ctx, c);
+}
+
+// 間のフレーム：ダイス欄だけ描き直す
+static void draw_dice_frame(GContext *ctx) {
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  graphics_fill_rect(ctx, GRect(DICE_X, DICE_Y, DICE_MAX_FACES * HUD_STRIDE, HUD_BLOCK), 0,
+                     GCornerNone);
+  draw_dice(ctx, dice_shown());
+}
+
+// 全体（背景は透明なので、マップの外も自分で塗る）
+static void draw_map(Layer *layer, GContext *ctx) {
+  GRect full = layer_get_bounds(layer);
+  bool moving_anim = s_anim_kind == ANIM_MOVE;
+
+  if (map_gen_busy() || !s_level_loaded || (s_game.over && !moving_anim)) {
+    graphics_context_set_fill_color(ctx, GColorWhite);
+    graphics_fill_rect(ctx, full, 0, GCornerNone);
+  }
 
-  if (game_over) {
+  if (map_gen_busy() || !s_level_loaded) {
+      graphics_context_set_text_color(ctx, GColorBlack);
+      graphics_draw_text(ctx, map_gen_busy() ? "GENERATING..." : "NO LEVEL", fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+                         GRect(0, 90, layer_get_bounds(layer).size.w, 40), GTextOverflowModeWordWrap,
+                         GTextAlignmentCenter, NULL);
+      return;
+  }
+
+  if (s_game.over && !moving_anim) {
       graphics_context_set_text_color(ctx, GColorBlack);
 
       graphics_draw_text(
           ctx,
           "GAME OVER",
           fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
-          GRect(0, 90, 200, 40),
+          GRect(0, 90, layer_get_bounds(layer).size.w, 40),
           GTextOverflowModeWordWrap,
           GTextAlignmentCenter,
           NULL
@@ -118,9 +584,7 @@ static void map_layer_update(Layer *layer, GContext *ctx) {
   }
 
   // ---- GAME CLEAR ----
-  if (game_clear) {
-      GRect full = layer_get_bounds(layer);
-
+  if (s_game.clear && !moving_anim) {
       graphics_context_set_fill_color(ctx, GColorWhite);
       graphics_fill_rect(ctx, full, 0, GCornerNone);
 
@@ -138,7 +602,7 @@ static void map_layer_update(Layer *layer, GContext *ctx) {
       );
 
       // ランク
-      const char* rank = get_rank_text(decay);
+      const char* rank = rules_rank_text(rules_rank(s_game.decay));
       graphics_draw_text(
         ctx,
         rank,
@@ -149,102 +613,93 @@ static void map_layer_update(Layer *layer, GContext *ctx) {
         NULL
       );
 
-      return;  // ここで描画を完了
-  }
-
-
-
-  // --- タイル描画 ---
-  for(int y = 0; y < MAP_ROWS; y++) {
-    for(int x = 0; x < MAP_COLS; x++) {
-
-      TileType t = map[y][x];
-      GRect rect = GRect(x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE);
-
-      graphics_context_set_fill_color(ctx, tile_color(t));
-      graphics_fill_rect(ctx, rect, 0, GCornerNone);
-
-//      graphics_context_set_stroke_color(ctx, GColorBlack);
-//      graphics_draw_rect(ctx, rect);
-      // --- 中央の小さな黒ドット ---
-      graphics_context_set_fill_color(ctx, GColorBlack);
-
-      // このマスの中心座標
-      int cx = rect.origin.x + TILE_SIZE / 2;
-      int cy = rect.origin.y + TILE_SIZE / 2;
-
-      // 2x2 の黒い四角として描画（好みで 3x3 にもできる）
-      graphics_fill_rect(ctx, GRect(cx - 1, cy - 1, 2, 2), 0, GCornerNone);
-
-      // START
-      if(t == TILE_START) {
-        graphics_context_set_fill_color(ctx, GColorRed);
-        graphics_fill_circle(ctx, GPoint(rect.origin.x + 10, rect.origin.y + 10), 6);
+      // このレベルのベスト
+      int best = s_endless ? -1 : save_best_decay(s_level_index);
+      if (best >= 0) {
+        static char s_best_text[24];
+        snprintf(s_best_text, sizeof(s_best_text), "BEST %s", rules_rank_text(rules_rank(best)));
+        graphics_draw_text(ctx, s_best_text, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                           GRect(0, 118, full.size.w, 22), GTextOverflowModeWordWrap,
+                           GTextAlignmentCenter, NULL);
       }
 
-      // GOAL
-      if(t == TILE_GOAL) {
-        graphics_context_set_fill_color(ctx, GColorBlack);
-        graphics_fill_circle(ctx, GPoint(rect.origin.x + 10, rect.origin.y + 10), 6);
+      // 次のレベル（UP でエンドレスモード）
+      static char s_level_text[32];
+      if (s_endless) {
+        snprintf(s_level_text, sizeof(s_level_text), "ENDLESS %d", s_endless_count);
+      } else if (s_level_index == LEVEL_INDEX_UPLOADED) {
+        snprintf(s_level_text, sizeof(s_level_text), "PHONE MAP  UP:ENDLESS");
+      } else {
+        snprintf(s_level_text, sizeof(s_level_text), "LEVEL %d/%d  UP:ENDLESS",
+                 s_level_index + 1, level_pack_count());
       }
+      graphics_draw_text(
+        ctx,
+        s_level_text,
+        fonts_get_system_font(FONT_KEY_GOTHIC_18),
+        GRect(0, 140, full.size.w, 24),
+        GTextOverflowModeWordWrap,
+        GTextAlignmentCenter,
+        NULL
+      );
 
-      // CHECK
-      if(t == TILE_CHECK) {
-        graphics_context_set_fill_color(ctx, GColorGreen);
-
-        GPoint p1 = GPoint(rect.origin.x + 10, rect.origin.y + 4);
-        GPoint p2 = GPoint(rect.origin.x + 4,  rect.origin.y + 16);
-        GPoint p3 = GPoint(rect.origin.x + 16, rect.origin.y + 16);
-
-        GPathInfo info = {
-          .num_points = 3,
-          .points = (GPoint[]){ p1, p2, p3 }
-        };
-        GPath *tri = gpath_create(&info);
-        gpath_draw_filled(ctx, tri);
-        gpath_destroy(tri);
-      }
-    }
+      return;  // ここで描画を完了
   }
 
-  // --- プレイヤー ---
-  GPoint pc = GPoint(
-    player_x * TILE_SIZE + TILE_SIZE / 2,
-    player_y * TILE_SIZE + TILE_SIZE / 2
-  );
-  graphics_context_set_stroke_color(ctx, GColorRed);
-  graphics_context_set_stroke_width(ctx, 2);
-  graphics_draw_circle(ctx, pc, 7);
-  graphics_draw_circle(ctx, pc, 6);
 
-  // --- 移動カーソル ---
-  if (moving_phase && dice_result > 0) {
-    int cx, cy;
-    get_cursor_position(&cx, &cy);
-    if (is_in_map(cx, cy)) {
 
-      GPoint p1 = GPoint(cx * TILE_SIZE + 10, cy * TILE_SIZE + 4);
-      GPoint p2 = GPoint(cx * TILE_SIZE + 4,  cy * TILE_SIZE + 16);
-      GPoint p3 = GPoint(cx * TILE_SIZE + 16, cy * TILE_SIZE + 16);
+  // --- マップの外（丸型の上と左、右の余りと HUD）---
+  int view_right = VIEW_X + VIEW_COLS * TILE_SIZE;
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  if (VIEW_INSET > 0) {
+    graphics_fill_rect(ctx, GRect(0, 0, full.size.w, VIEW_Y), 0, GCornerNone);
+    graphics_fill_rect(ctx, GRect(0, VIEW_Y, VIEW_X, HUD_Y - VIEW_Y), 0, GCornerNone);
+  }
+  graphics_fill_rect(ctx, GRect(view_right, VIEW_Y, full.size.w - view_right, HUD_Y - VIEW_Y), 0,
+                     GCornerNone);
+  graphics_fill_rect(ctx, GRect(0, HUD_Y, full.size.w, full.size.h - HUD_Y), 0, GCornerNone);
 
-      GPathInfo info = {
-        .num_points = 3,
-        .points = (GPoint[]){ p1, p2, p3 }
-      };
+  // --- 地形（カメラが動いていなければ作ってあるビットマップを貼るだけ） ---
+  update_camera();
+  draw_terrain(layer, ctx, s_cam_x, s_cam_y, s_cam_x + VIEW_COLS, s_cam_y + VIEW_ROWS);
+
+  // --- プレイヤー ---
+  draw_player(ctx, sprite_center());
 
-      GPath *path = gpath_create(&info);
+  // --- 移動カーソル（駒が動いている間は出さない） ---
+  if (s_game.moving && s_game.dice > 0 && !moving_anim) {
+    int cx, cy;
+    rules_cursor(&s_game, &cx, &cy);
+    if (is_in_map(cx, cy) && s_triangle_path) {
+      gpath_move_to(s_triangle_path, tile_origin(cx, cy));
       graphics_context_set_fill_color(ctx, GColorRed);
-      gpath_draw_filled(ctx, path);
-      gpath_destroy(path);
+      gpath_draw_filled(ctx, s_triangle_path);
+    }
+
+    // --- ヒント：一番よい方向のマスを枠で囲む ---
+    int hint = s_hint_enabled && !s_endless
+        ? policy_hint(s_level_index, level_cols(s_level), level_rows(s_level),
+                      s_game.x, s_game.y, s_game.decay, s_game.passed_check, s_game.dice)
+        : -1;
+    if (hint >= 0) {
+      GameState probe = s_game;
+      probe.dir = hint;
+      int hx, hy;
+      rules_cursor(&probe, &hx, &hy);
+      graphics_context_set_stroke_color(ctx, PBL_IF_COLOR_ELSE(GColorIslamicGreen, GColorBlack));
+      graphics_context_set_stroke_width(ctx, 1);
+      GPoint ho = tile_origin(hx, hy);
+      graphics_draw_rect(ctx, GRect(ho.x, ho.y, TILE_SIZE, TILE_SIZE));
+      graphics_draw_rect(ctx, GRect(ho.x + 1, ho.y + 1, TILE_SIZE - 2, TILE_SIZE - 2));
     }
   }
 
   // ---- チェックポイント通過表示 ----
   {
-    int label_x = 20;   // ← 左から20px (調整可)
-    int label_y = MAP_ROWS * TILE_SIZE + 4;  // ダイスゲージと同じ高さ
+    int label_x = HUD_X + TILE_SIZE;   // ← 左から 1 マス
+    int label_y = DICE_Y;              // ダイスゲージと同じ高さ
 
-    const char *text = passed_check ? "Check Passed" : "Unchecked";
+    const char *text = s_game.passed_check ? "Check Passed" : "Unchecked";
 
     graphics_context_set_text_color(ctx, GColorBlack);
 
@@ -252,7 +707,7 @@ static void map_layer_update(Layer *layer, GContext *ctx) {
       ctx,
       text,
       fonts_get_system_font(FONT_KEY_GOTHIC_14),
-      GRect(label_x, label_y-2, 140, 16),   // ← 横幅70px
+      GRect(label_x, label_y-2, DICE_X - label_x, 16),   // ← ダイスの手前まで
       GTextOverflowModeWordWrap,
       GTextAlignmentLeft,
       NULL
@@ -260,222 +715,350 @@ static void map_layer_update(Layer *layer, GContext *ctx) {
   }
 
   // --- ダイス ---
-  if (dice_result > 0) {
-
-    TileType tile = map[player_y][player_x];
-    GColor dice_color = GColorRed;
-
-    switch(tile) {
-      case TILE_MOUNTAIN: dice_color = GColorArmyGreen; break;
-      case TILE_RIVER:    dice_color = GColorBlue;      break;
-      case TILE_STRANDED: dice_color = GColorLightGray; break;
-      default:            dice_color = GColorRed;       break;
-    }
-
-    int base_x = 100;
-    int y = MAP_ROWS * TILE_SIZE + 4;
-
-    for (int i = 0; i < dice_result; i++) {
-      GRect r = GRect(base_x + i * 14, y, 12, 12);
-      graphics_context_set_fill_color(ctx, dice_color);
-      graphics_fill_rect(ctx, r, 0, GCornerNone);
-    }
+  if (s_game.dice > 0) {
+    draw_dice(ctx, dice_shown());
   }
 
   // --- 荷物劣化 ---
-  int decay_x = 0;
-  int decay_y = MAP_ROWS * TILE_SIZE + 20;
+  int decay_x = HUD_X;
+  int decay_y = HUD_Y + 20;
 
-  for (int i = 0; i < decay; i++) {
+  for (int i = 0; i < s_game.decay; i++) {
     graphics_context_set_fill_color(ctx, GColorBlack);
-    graphics_fill_rect(ctx, GRect(decay_x + i * 14, decay_y, 12, 12),
+    graphics_fill_rect(ctx, GRect(decay_x + i * HUD_STRIDE, decay_y, HUD_BLOCK, HUD_BLOCK),
                        0, GCornerNone);
   }
 
 }
 
-//プレイヤー初期位置を設定
-static void find_start_position() {
-  for (int y = 0; y < MAP_ROWS; y++) {
-    for (int x = 0; x < MAP_COLS; x++) {
-      if (map[y][x] == TILE_START) {
-        player_x = x;
-        player_y = y;
-        return;
-      }
+static void map_layer_update(Layer *layer, GContext *ctx) {
+  uint32_t start = now_ms();
+
+  if (s_sprite_only && s_anim_kind == ANIM_MOVE) {
+    draw_sprite_frame(layer, ctx);
+  } else if (s_sprite_only && s_anim_kind == ANIM_ROLL) {
+    draw_dice_frame(ctx);
+  } else {
+    draw_map(layer, ctx);
+  }
+
+  // 部分描画の時間で次のフレームまでの間隔を決める（1/4 ずつ寄せる）
+  if (s_sprite_only) {
+    s_frame_cost_ms = (s_frame_cost_ms * 3 + (now_ms() - start)) / 4;
+  }
+  s_sprite_only = false;
+  s_frame_pending = false;
+  s_last_frame_ms = start;
+}
+
+// ---- プレイ中かどうか（電池の記録用） ----
+static void play_idle_timeout(void *data) {
+  s_play_idle_timer = NULL;
+  battery_ledger_set_mode(LEDGER_IDLE);
+}
+
+static void note_play_activity(void) {
+  if (s_game.over || s_game.clear) {
+    if (s_play_idle_timer) {
+      app_timer_cancel(s_play_idle_timer);
+      s_play_idle_timer = NULL;
     }
+    battery_ledger_set_mode(LEDGER_IDLE);
+    return;
+  }
+
+  battery_ledger_set_mode(LEDGER_PLAY);
+  if (!s_play_idle_timer || !app_timer_reschedule(s_play_idle_timer, PLAY_IDLE_TIMEOUT_MS)) {
+    s_play_idle_timer = app_timer_register(PLAY_IDLE_TIMEOUT_MS, play_idle_timeout, NULL);
   }
 }
 
-//ゲームリセット
+// ---- リプレイの記録（replay.h） ----
+static bool s_replaying = false;   // 記録を再生している（s_game と s_level は再生用）
+
+// 下の「リプレイの再生」
+static void stop_replay(void);      // 再生をやめて遊びかけに戻る
+static void cancel_replay(void);    // 再生をやめるだけ（マップは呼ぶ側が入れ替える）
+static void replay_list_push(void);
+
+// 今のマップ（エンドレスのマップのシードは s_endless_seed の 1 つ前）
+static ReplaySource journal_source(void) {
+  return s_endless ? REPLAY_ENDLESS
+       : s_level_index == LEVEL_INDEX_UPLOADED ? REPLAY_UPLOADED : REPLAY_PACK;
+}
+
+static void journal_begin(void) {
+  replay_begin(journal_source(), s_level_index, s_endless_seed - 1, s_endless_difficulty);
+}
+
+//ゲームリセット（プレイヤーは START に戻る。新しいゲームとして記録する）
 static void reset_game() {
-  decay = 0;
-  dice_result = 0;
-  moving_phase = false;
-  move_dir = 0;
-  passed_check = false;
-  game_clear = false;
-  game_over = false;
+  rules_reset(&s_game, s_level);
+  journal_begin();
+}
+
+// 1 歩（向きを記録してから進める）
+static void step_game(void) {
+  replay_record_step(s_game.dir);
+  rules_step(&s_game, s_level);
+}
+
+// ---- エンドレスモード ----
+static void endless_level_ready(const Level *level, int par_decay, void *context) {
+  *s_level = *level;
+  s_level_loaded = true;
+  s_endless_count++;
+  level_changed();
+  reset_game();
+  redraw_all();
+}
 
-  find_start_position();  // プレイヤー初期位置に戻す
+// ---- 電話から送られたマップ（level_upload） ----
+// level は表示していない方のバッファに書かれている。付け替えて、空いた方を返す
+static Level *uploaded_level_ready(Level *level) {
+  Level *previous = s_level;
+  cancel_replay();
+  map_gen_cancel();
+  stop_anim();
+  s_level = level;
+  s_level_loaded = true;
+  s_level_index = LEVEL_INDEX_UPLOADED;
+  s_endless = false;
+  level_changed();
+  reset_game();
+  redraw_all();
+  return previous;
+}
+
+// 設定でないメッセージ（settings_sync_share）
+static void inbox_received(DictionaryIterator *iter, void *context) {
+  level_upload_receive(iter);
+}
+
+static void start_endless_level(void) {
+  if (!s_endless) {
+    s_endless = true;
+    s_endless_seed = (uint32_t)time(NULL);
+  }
+  s_endless_difficulty = s_settings[SETTING_DIFFICULTY];
+  map_gen_start(s_endless_seed++, endless_level_ready, NULL);
+  redraw_all();
+}
+
+// ---- 入力 ----
+// SELECT は押し続けるとリピートする。リピートは移動中だけ受け付け、残りの歩数を
+// まとめて進めて最後に 1 回だけ描く（リピートでダイスを振ったり、クリア画面を飛ばしたりはしない）。
+// 前の押下がまだ描かれないうちに次の押下が来たら、状態だけ進めて描画は 1 回にまとめる
+// （アニメーションも始めない）。
+#define SELECT_REPEAT_MS 150
+
+// 移動の残りをまとめて進める（曲がらず、止まるかダイスを使い切るまで）
+static void run_move_batch(void) {
+  for (int i = 0; i < DICE_MAX_FACES && s_game.moving; i++) {
+    step_game();
+  }
 }
 
 static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
-  int cx, cy;
-  get_cursor_position(&cx, &cy);
+  if (s_replaying) {
+    stop_replay();
+    return;
+  }
+  if (map_gen_busy() || !s_level_loaded) return;
+  bool repeating = click_recognizer_is_repeating(recognizer);
+  if (repeating && !s_game.moving) return;
+  bool coalesce = s_frame_pending;   // 前の押下がまだ描かれていない
+  stop_anim();   // 動いている途中なら終わりまで飛ばす
 
   // ---- GAME OVER 中の SELECT → リセット ----
-  if (game_over) {
+  if (s_game.over) {
       reset_game();
-      layer_mark_dirty(s_map_layer);
+      redraw_all();
       return;
   }
 
-  // ---- GAME CLEAR 中の SELECT → リセット ----
-  if (game_clear) {
+  // ---- GAME CLEAR 中の SELECT → 次のレベル ----
+  if (s_game.clear && s_endless) {
+      start_endless_level();
+      return;
+  }
+  if (s_game.clear) {
+      // 電話から送られたマップの次はパックの最初から
+      int next = s_level_index == LEVEL_INDEX_UPLOADED ? 0 : s_level_index + 1;
+      if (load_level(next % level_pack_count())) {
+        level_changed();
+      } else {
+        load_level(s_level_index);   // 読めなければ同じレベルをもう一度
+      }
       reset_game();
-      layer_mark_dirty(s_map_layer);
+      redraw_all();
       return;
   }
 
 
-  if (!moving_phase) {
-    // 現在地の地形を判定
-    TileType current = map[player_y][player_x];
-    decay++;
-    if (decay >= 15) {
-      game_over = true;
+  if (!s_game.moving) {
+    // 地形に応じたダイスを振る（劣化 +1、向きはマップの中へ）
+    TileType tile = rules_tile(&s_game, s_level);
+    rules_roll(&s_game, s_level, roll_dice_for_tile(tile));
+    if (!coalesce && !s_game.over && rules_dice_max(tile) > 1) {
+      start_anim(ANIM_ROLL, ROLL_ANIM_MS);
     }
-    // 地形に応じたダイスを振る
-    dice_result = roll_dice_for_tile(current);
-
-    move_dir = 0;
-    moving_phase = true;
-
-    // ★方向補正ループ
-    for (int i = 0; i < 4; i++) {
-      int nx, ny;
-      get_cursor_position(&nx, &ny);
-      if (is_in_map(nx, ny)) break;
-      move_dir = (move_dir + 1) % 4;
+  } else if (repeating) {
+    run_move_batch();
+  } else {
+    // カーソルの向きへ 1 歩（停止・座礁・CHECK・GOAL は rules_step）
+    GPoint from = tile_center(s_game.x, s_game.y);
+    step_game();
+    // カメラが動くときは画面全体が変わるので、動かさずに描く
+    if (!coalesce &&
+        camera_axis(s_cam_x, s_game.x, VIEW_COLS, level_cols(s_level)) == s_cam_x &&
+        camera_axis(s_cam_y, s_game.y, VIEW_ROWS, level_rows(s_level)) == s_cam_y) {
+      s_anim_from = from;
+      s_anim_to = tile_center(s_game.x, s_game.y);
+      start_anim(ANIM_MOVE, MOVE_ANIM_MS);
     }
+  }
+  if (s_game.clear && !s_endless) {
+    save_record_clear(s_level_index, s_game.decay);
+  }
+  if (s_game.clear || s_game.over) {
+    replay_finish(s_game.clear);
+  }
 
-  } else {
-    // --- 移動処理（既存） ---
-    if (is_in_map(cx, cy)) {
+  note_play_activity();
+  redraw_all();
+}
 
-        TileType before = map[player_y][player_x];  // 元の地形
-        TileType after  = map[cy][cx];              // 移動先の地形
 
-        // ★ チェックポイント通過（立ち止まる必要なし）
-        if (map[player_y][player_x] == TILE_CHECK) {
-            passed_check = true;
-        }
-        
-        // ★ 座礁地帯に侵入したら decay+2 ★
-        if (after == TILE_STRANDED && before != TILE_STRANDED) {
-            decay += 2;
-            if (decay >= 15) {
-              game_over = true;
-            }
-            if (decay > MAX_DECAY) decay = MAX_DECAY;
-        }
-
-        // 移動
-        player_x = cx;
-        player_y = cy;
 
-        // --- ペナルティチェック ---
-        bool stop_tile = false;
+static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
+  if (s_replaying) {
+    stop_replay();
+    return;
+  }
+  stop_anim();
+  // ---- GAME CLEAR 中の UP → エンドレスモード ----
+  if (s_game.clear && !map_gen_busy()) {
+    start_endless_level();
+    return;
+  }
 
-        if (after == TILE_MOUNTAIN || after == TILE_RIVER || after == TILE_STRANDED) {
-            if (before != after) {   // 異なる地形に移動した時だけ停止
-                stop_tile = true;
-            }
-        }
+  if (!s_level_loaded || !s_game.moving) {
+      return;   // 移動フェーズ外では UP は完全に無視
+  }
 
-        // ★ ゴール判定（チェック通過してなければ無効）
-        if (map[player_y][player_x] == TILE_GOAL) {
-            if (passed_check) {
-              game_clear = true;
-              moving_phase = false;  // 動きを止める
-            } else {
-                // チェック通過してない → ゴール無効（何も起きない）
-            }
-        }
+  rules_turn(&s_game, s_level, 1);   // 有効な方向まで回す
 
-        if (stop_tile) {
-            dice_result = 0;
-            moving_phase = false;
-
-        } else {
-
-            // 通常のダイス消費
-            dice_result--;
-
-            if (dice_result <= 0) {
-                moving_phase = false;
-            } else {
-                // --- 移動後の方向補正 ---
-                for (int i = 0; i < 4; i++) {
-                    int nx, ny;
-                    get_cursor_position(&nx, &ny);
-                    if (is_in_map(nx, ny)) break;
-                    move_dir = (move_dir + 1) % 4;
-                }
-            }
-        }
-    }
+  note_play_activity();
+  redraw_all();
+}
 
+static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
+  if (s_replaying) {
+    stop_replay();
+    return;
+  }
+  stop_anim();
+  if (!s_level_loaded || !s_game.moving) {
+      return;   // 移動フェーズ外では DOWN は完全に無視
   }
 
-  layer_mark_dirty(s_map_layer);
+  rules_turn(&s_game, s_level, -1);
+
+  note_play_activity();
+  redraw_all();
 }
 
+// ---- ゲームメニュー（DOWN 長押し） ----
+enum { MENU_HINT, MENU_REPLAY, MENU_BATTERY,
+#ifdef FRAME_PROFILER
+       MENU_PROFILER,
+#endif
+       MENU_COUNT };
 
+static Window *s_menu_window;
+static MenuLayer *s_menu_layer;
 
-static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
-  if (!moving_phase) {
-      return;   // 移動フェーズ外では UP は完全に無視
-  }
-
-  for (int i = 0; i < 4; i++) {
-    move_dir = (move_dir + 1) % 4;
-
-    int cx, cy;
-    get_cursor_position(&cx, &cy);
+static uint16_t menu_get_num_rows(MenuLayer *menu_layer, uint16_t section_index, void *context) {
+  return MENU_COUNT;
+}
 
-    if (is_in_map(cx, cy)) {
-      break;  // 有効方向が見つかった！
-    }
+static void menu_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index,
+                          void *context) {
+  switch (cell_index->row) {
+    case MENU_HINT:
+      menu_cell_basic_draw(ctx, cell_layer, s_hint_enabled ? "Hint: ON" : "Hint: OFF",
+                           s_endless ? "not in endless" : NULL, NULL);
+      break;
+    case MENU_REPLAY:
+      menu_cell_basic_draw(ctx, cell_layer, "Replays", NULL, NULL);
+      break;
+    case MENU_BATTERY:
+      menu_cell_basic_draw(ctx, cell_layer, "Battery", NULL, NULL);
+      break;
+#ifdef FRAME_PROFILER
+    case MENU_PROFILER:
+      menu_cell_basic_draw(ctx, cell_layer, "Profiler", NULL, NULL);
+      break;
+#endif
   }
-
-  layer_mark_dirty(s_map_layer);
 }
 
-static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
-  if (!moving_phase) {
-      return;   // 移動フェーズ外では UP は完全に無視
+static void menu_select(MenuLayer *menu_layer, MenuIndex *cell_index, void *context) {
+  switch (cell_index->row) {
+    case MENU_HINT:
+      s_hint_enabled = !s_hint_enabled;
+      settings_sync_set(SETTING_HINT, s_hint_enabled);
+      menu_layer_reload_data(menu_layer);
+      break;
+    case MENU_REPLAY:
+      replay_list_push();
+      break;
+    case MENU_BATTERY:
+      battery_ledger_window_push();
+      break;
+#ifdef FRAME_PROFILER
+    case MENU_PROFILER:
+      frame_profiler_window_push();
+      break;
+#endif
   }
+}
 
-  for (int i = 0; i < 4; i++) {
-    move_dir = (move_dir - 1 + 4) % 4;
+static void menu_window_load(Window *window) {
+  Layer *root = window_get_root_layer(window);
+  s_menu_layer = menu_layer_create(layer_get_bounds(root));
+  menu_layer_set_callbacks(s_menu_layer, NULL, (MenuLayerCallbacks) {
+    .get_num_rows = menu_get_num_rows,
+    .draw_row = menu_draw_row,
+    .select_click = menu_select,
+  });
+  menu_layer_set_click_config_onto_window(s_menu_layer, window);
+  layer_add_child(root, menu_layer_get_layer(s_menu_layer));
+}
 
-    int cx, cy;
-    get_cursor_position(&cx, &cy);
+static void menu_window_unload(Window *window) {
+  menu_layer_destroy(s_menu_layer);
+  s_menu_layer = NULL;
+}
 
-    if (is_in_map(cx, cy)) {
-      break;  // 有効方向が見つかった！
-    }
+static void menu_long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  if (!s_menu_window) {
+    s_menu_window = window_create();
+    window_set_window_handlers(s_menu_window, (WindowHandlers) {
+      .load = menu_window_load,
+      .unload = menu_window_unload
+    });
   }
-
-  layer_mark_dirty(s_map_layer);
+  window_stack_push(s_menu_window, true);
 }
 
 static void click_config_provider(void *context) {
-  window_single_click_subscribe(BUTTON_ID_SELECT, select_click_handler);
+  window_single_repeating_click_subscribe(BUTTON_ID_SELECT, SELECT_REPEAT_MS, select_click_handler);
   window_single_click_subscribe(BUTTON_ID_UP,     up_click_handler);
   window_single_click_subscribe(BUTTON_ID_DOWN,   down_click_handler);
+  battery_ledger_long_click_subscribe(BUTTON_ID_UP);
+  window_long_click_subscribe(BUTTON_ID_DOWN, 0, menu_long_click_handler, NULL);
 }
 
 // ---- ウィンドウ ----
@@ -485,27 +1068,301 @@ static Layer *s_map_layer;
 static void main_window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
 
-  // --- 画面全体のレイヤーにする（縦228px） ---
-  s_map_layer = layer_create(GRect(0, 0, 200, 228));
+  // --- 画面全体のレイヤーにする ---
+  s_map_layer = layer_create(layer_get_bounds(window_layer));
 
-  layer_set_update_proc(s_map_layer, map_layer_update);
+  frame_profiler_attach(s_map_layer, map_layer_update);
   layer_add_child(window_layer, s_map_layer);
+
+  level_changed();
+  s_triangle_path = gpath_create(&TRIANGLE_PATH_INFO);
+}
+
+
+
+// ---- 保存（閉じるときとフォーカスを失うときだけ。変わっていなければ書かない） ----
+static void save_game(void) {
+  replay_flush();
+  if (s_replaying) {
+    save_flush();   // 再生中のゲームは保存しない（再生の前に保存したものを書く）
+    return;
+  }
+  SaveState state = {
+    .game = s_game,
+    .endless = s_endless,
+    .level_index = s_level_index,
+    .endless_count = s_endless_count,
+    .endless_seed = s_endless_seed,
+  };
+  if (s_endless) {
+    state.level = *s_level;
+  }
+  if (s_level_loaded) {
+    save_store(&state);
+  }
+  save_flush();
+}
+
+// 遊びかけの続きにできたら true
+static bool restore_game(void) {
+  SaveState state;
+  if (!save_load(&state)) return false;
+
+  if (state.endless) {
+    *s_level = state.level;
+    s_level_loaded = true;
+    s_endless = true;
+    s_endless_count = state.endless_count;
+    s_endless_seed = state.endless_seed;
+  } else if (state.level_index == LEVEL_INDEX_UPLOADED && level_upload_load(s_level)) {
+    s_level_loaded = true;
+    s_level_index = LEVEL_INDEX_UPLOADED;
+  } else if (!load_level(state.level_index)) {
+    load_level(0);
+    return false;   // パックが変わっていたら最初から
+  }
+  // パックが変わって位置がマップの外になっていたら最初から
+  if (!rules_in_level(s_level, state.game.x, state.game.y)) return false;
+  s_game = state.game;
+  return true;
+}
+
+// ---- リプレイの再生 ----
+// 記録（replay.h）を REPLAY_TICK_MS ごとに 1 手ずつ、アニメーションなしで進める。
+// 再生の前に遊びかけを保存し、終わったら（どれかのボタンを押しても）読み直して戻る。
+// 同じ記録からは同じフレームが出るので、描画の速さを同じ入力で比べるのにも使える。
+#define REPLAY_TICK_MS 120
+#define REPLAY_END_MS 1500    // 最後の場面を見せる時間
+
+static ReplayRecord s_replay_record;   // 表は再生中も変わりうるので写して持つ
+static ReplayPlayer s_replay_player;
+static AppTimer *s_replay_timer;
+
+static void replay_end(void *data) {
+  s_replay_timer = NULL;
+  stop_replay();
+}
+
+static void replay_tick(void *data) {
+  bool more = replay_player_next(&s_replay_player, &s_game, s_level);
+  s_replay_timer = app_timer_register(more ? REPLAY_TICK_MS : REPLAY_END_MS,
+                                      more ? replay_tick : replay_end, NULL);
+  redraw_all();
+}
+
+// マップが揃ったら最初から
+static void replay_play(void) {
+  s_level_loaded = true;
+  level_changed();
+  replay_player_start(&s_replay_player, &s_replay_record, &s_game, s_level);
+  s_replay_timer = app_timer_register(REPLAY_TICK_MS, replay_tick, NULL);
+  redraw_all();
+}
+
+static void replay_level_ready(const Level *level, int par_decay, void *context) {
+  *s_level = *level;
+  replay_play();
+}
+
+static void start_replay(const ReplayRecord *record) {
+  if (!s_replaying) {
+    save_game();   // stop_replay で読み直す
+  }
+  s_replay_record = *record;
+  cancel_replay();
+  stop_anim();
+  s_replaying = true;
+
+  bool ok = true;
+  s_endless = replay_source(record) == REPLAY_ENDLESS;
+  switch (replay_source(record)) {
+    case REPLAY_PACK:
+      ok = load_level(s_replay_record.level_index);
+      break;
+    case REPLAY_UPLOADED:
+      ok = level_upload_load(s_level);   // 今持っている（最後に送られた）マップ
+      s_level_index = LEVEL_INDEX_UPLOADED;
+      break;
+    case REPLAY_ENDLESS:
+      // 同じシードと難しさで作り直す（終わると replay_level_ready）
+      map_gen_set_difficulty((MapGenDifficulty)replay_difficulty(&s_replay_record));
+      map_gen_start(s_replay_record.map_seed, replay_level_ready, NULL);
+      redraw_all();
+      return;
+  }
+  if (ok) {
+    replay_play();
+  } else {
+    stop_replay();
+  }
+}
+
+static void cancel_replay(void) {
+  if (!s_replaying) return;
+  s_replaying = false;
+  if (s_replay_timer) {
+    app_timer_cancel(s_replay_timer);
+    s_replay_timer = NULL;
+  }
+  map_gen_cancel();
+  map_gen_set_difficulty((MapGenDifficulty)s_settings[SETTING_DIFFICULTY]);
+}
+
+static void stop_replay(void) {
+  cancel_replay();
+  s_endless = false;
+  load_level(0);
+  rules_reset(&s_game, s_level);
+  if (!restore_game()) {
+    reset_game();
+  }
+  level_changed();
+  redraw_all();
+}
+
+// ---- リプレイの一覧（ゲームメニューから。新しい順） ----
+static Window *s_replay_window;
+static MenuLayer *s_replay_menu;
+
+static uint16_t replay_list_rows(MenuLayer *menu_layer, uint16_t section_index, void *context) {
+  return replay_count() ? replay_count() : 1;
+}
+
+static void replay_list_draw_row(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index,
+                                 void *context) {
+  const ReplayRecord *r = replay_get(cell_index->row);
+  if (!r) {
+    menu_cell_basic_draw(ctx, cell_layer, "No replays", NULL, NULL);
+    return;
+  }
+  char title[16], subtitle[32];
+  switch (replay_source(r)) {
+    case REPLAY_PACK:
+      snprintf(title, sizeof(title), "Level %d", r->level_index + 1);
+      break;
+    case REPLAY_ENDLESS:
+      snprintf(title, sizeof(title), "Endless");
+      break;
+    default:
+      snprintf(title, sizeof(title), "Phone map");
+      break;
+  }
+  const char *result = (r->flags & REPLAY_FLAG_CLEAR) ? "Clear"
+                     : (r->flags & REPLAY_FLAG_OVER) ? "Game over" : "Unfinished";
+  snprintf(subtitle, sizeof(subtitle), "%s, %d rolls", result, r->rolls);
+  menu_cell_basic_draw(ctx, cell_layer, title, subtitle, NULL);
+}
+
+// メニューを閉じて、ゲームの画面で再生する
+static void replay_list_select(MenuLayer *menu_layer, MenuIndex *cell_index, void *context) {
+  const ReplayRecord *r = replay_get(cell_index->row);
+  if (!r) return;
+  if (s_menu_window) {
+    window_stack_remove(s_menu_window, false);
+  }
+  window_stack_pop(true);
+  start_replay(r);
+}
+
+static void replay_window_load(Window *window) {
+  Layer *root = window_get_root_layer(window);
+  s_replay_menu = menu_layer_create(layer_get_bounds(root));
+  menu_layer_set_callbacks(s_replay_menu, NULL, (MenuLayerCallbacks) {
+    .get_num_rows = replay_list_rows,
+    .draw_row = replay_list_draw_row,
+    .select_click = replay_list_select,
+  });
+  menu_layer_set_click_config_onto_window(s_replay_menu, window);
+  layer_add_child(root, menu_layer_get_layer(s_replay_menu));
+}
+
+static void replay_window_unload(Window *window) {
+  menu_layer_destroy(s_replay_menu);
+  s_replay_menu = NULL;
 }
 
+static void replay_list_push(void) {
+  if (!s_replay_window) {
+    s_replay_window = window_create();
+    window_set_window_handlers(s_replay_window, (WindowHandlers) {
+      .load = replay_window_load,
+      .unload = replay_window_unload
+    });
+  }
+  window_stack_push(s_replay_window, true);
+}
+
+static void app_focus_will_change(bool in_focus) {
+  if (!in_focus) {
+    save_game();
+  }
+}
 
+static void main_window_appear(Window *window) {
+  redraw_all();   // 上に重なっていたウィンドウの跡を消す
+}
 
 static void main_window_unload(Window *window) {
+  stop_anim();
+  save_game();
+  gpath_destroy(s_triangle_path);
+  s_triangle_path = NULL;
+  gbitmap_destroy(s_terrain);
+  s_terrain = NULL;
   layer_destroy(s_map_layer);
 }
 
+// 電話から設定が届いた（難しさは次に作るマップから）
+static void settings_changed(uint32_t changed) {
+  map_gen_set_difficulty((MapGenDifficulty)s_settings[SETTING_DIFFICULTY]);
+  s_hint_enabled = s_settings[SETTING_HINT];
+  if (s_menu_layer) {
+    menu_layer_reload_data(s_menu_layer);
+  }
+  if (s_map_layer) {
+    layer_mark_dirty(s_map_layer);
+  }
+}
+
 static void init() {
+  frame_profiler_init("DSonPaper");
+  battery_ledger_init(LEDGER_MODES, ARRAY_LENGTH(LEDGER_MODES));
+  level_upload_init(&s_level_buffers[1], uploaded_level_ready);
+  settings_sync_share(&(SettingsSyncShare) {
+    .received = inbox_received,
+    .sent = level_upload_outbox_sent,
+    .failed = level_upload_outbox_failed,
+    .inbox_size = LEVEL_UPLOAD_INBOX_SIZE,
+    .outbox_size = LEVEL_UPLOAD_OUTBOX_SIZE,
+  });
+  settings_sync_init(&MESSAGE_KEY_settings_revision, SETTINGS, s_settings, SETTING_COUNT,
+                     settings_changed);
+  settings_changed(0);
+
   s_main_window = window_create();
   window_set_window_handlers(s_main_window, (WindowHandlers) {
     .load = main_window_load,
+    .appear = main_window_appear,
     .unload = main_window_unload
   });
+  // 背景は塗らない（アニメーションの間は前のフレームに重ねて描く。マップの外は draw_map が塗る）
+  window_set_background_color(s_main_window, GColorClear);
+
+  replay_init();
+  s_endless_difficulty = s_settings[SETTING_DIFFICULTY];
+  load_level(0);
+  rules_reset(&s_game, s_level);  //プレイヤー初期位置
+  // 遊びかけがあれば続きから（記録も続ける。記録がなければ次のゲームから記録する）
+  if (!restore_game()) {
+    rules_reset(&s_game, s_level);
+    journal_begin();
+  } else {
+    replay_resume(journal_source(), s_level_index, s_endless_seed - 1);
+  }
 
-  find_start_position();  //プレイヤー初期位置
+  app_focus_service_subscribe_handlers((AppFocusHandlers) {
+    .will_focus = app_focus_will_change,
+  });
 
   window_stack_push(s_main_window, true);
   window_set_click_config_provider(s_main_window, click_config_provider);
@@ -513,7 +1370,21 @@ static void init() {
 }
 
 static void deinit() {
+  settings_sync_deinit();
+  app_focus_service_unsubscribe();
+  map_gen_cancel();
+  if (s_menu_window) {
+    window_destroy(s_menu_window);
+  }
+  if (s_replay_window) {
+    window_destroy(s_replay_window);
+  }
+  if (s_play_idle_timer) {
+    app_timer_cancel(s_play_idle_timer);
+  }
   window_destroy(s_main_window);
+  battery_ledger_deinit();
+  frame_profiler_deinit();
 }
 
 int main(void) {
@@ -0,0 +1,75 @@
+#include "level.h"
+
+// SDK に依存しない部分（ホストのツールからもリンクする）。パックの読み込みは level_pack.c
+
+// ================================
+//  検査
+// ================================
+static bool in_level(const Level *level, int x, int y) {
+  return x >= 0 && x < level_cols(level) && y >= 0 && y < level_rows(level);
+}
+
+bool level_validate(const Level *level, int size) {
+  int cols = level_cols(level);
+  int rows = level_rows(level);
+  if(cols < 1 || rows < 1 || size < LEVEL_HEADER_SIZE) return false;
+  if(level_resident(level) && size < (int)(LEVEL_HEADER_SIZE + LEVEL_TILE_BYTES(cols, rows))) {
+    return false;
+  }
+
+  return in_level(level, level_start_x(level), level_start_y(level)) &&
+         in_level(level, level_check_x(level), level_check_y(level)) &&
+         in_level(level, level_goal_x(level), level_goal_y(level)) &&
+         level_tile(level, level_start_x(level), level_start_y(level)) == TILE_START &&
+         level_tile(level, level_check_x(level), level_check_y(level)) == TILE_CHECK &&
+         level_tile(level, level_goal_x(level), level_goal_y(level)) == TILE_GOAL;
+}
+
+// ================================
+//  大きいマップのチャンクキャッシュ
+// ================================
+// 画面に入るチャンクと、その周りを少しだけ持つ。一番長く使っていないものから捨てる
+typedef struct {
+  uint32_t offset;   // 読み出し元でのチャンクの位置
+  uint32_t used;     // 最後に使ったときの s_clock
+  bool valid;
+  uint8_t bytes[LEVEL_CHUNK_BYTES];
+} CachedChunk;
+
+static LevelReader s_reader;
+static CachedChunk s_cache[LEVEL_CACHE_CHUNKS];
+static uint32_t s_clock;
+
+void level_stream_begin(LevelReader reader) {
+  s_reader = reader;
+  for(int i = 0; i < LEVEL_CACHE_CHUNKS; i++) s_cache[i].valid = false;
+}
+
+LevelReader level_stream_reader(void) {
+  return s_reader;
+}
+
+uint8_t level_stream_byte(const Level *level, uint32_t index) {
+  uint32_t offset = level->stream_offset + (index / LEVEL_CHUNK_BYTES) * LEVEL_CHUNK_BYTES;
+  s_clock++;
+
+  CachedChunk *victim = &s_cache[0];
+  for(int i = 0; i < LEVEL_CACHE_CHUNKS; i++) {
+    CachedChunk *c = &s_cache[i];
+    if(c->valid && c->offset == offset) {
+      c->used = s_clock;
+      return c->bytes[index % LEVEL_CHUNK_BYTES];
+    }
+    if(!c->valid || (victim->valid && c->used < victim->used)) victim = c;
+  }
+
+  // 読めなかったチャンクは平地として扱い、キャッシュには入れない
+  if(!s_reader || !s_reader(offset, victim->bytes, LEVEL_CHUNK_BYTES)) {
+    victim->valid = false;
+    return 0;
+  }
+  victim->offset = offset;
+  victim->used = s_clock;
+  victim->valid = true;
+  return victim->bytes[index % LEVEL_CHUNK_BYTES];
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ================================
+//  レベル（パック形式のマップ）
+// ================================
+// 1 マス 4bit（上位ニブルが偶数番目のマス）で詰め、先頭 8 バイトのヘッダに
+// 大きさ・START・CHECK・GOAL の位置を持つ。タイルは 8x8 マスのチャンク
+// （32 バイト）ごとにまとめ、チャンクを左上から行の順に並べる。
+//
+//   [0] cols  [1] rows  [2..3] start x,y  [4..5] check x,y  [6..7] goal x,y
+//   [8..]     チャンク ceil(cols/8)*ceil(rows/8) 個（中は y*8+x の順、はみ出しは 0）
+//
+// チャンクが LEVEL_RESIDENT_CHUNKS 個までのマップはタイルごと Level に持つ。
+// それより大きいマップはヘッダだけを持ち、タイルは見るときにチャンク単位で
+// 読み出し元（level_stream_begin）から読んで小さなキャッシュに置く。
+//
+// レベルパック（resources/data/levels.bin、tools/level_pack.py が生成）:
+//
+//   "DSLP" version(1) count(1) offset[count](uint32 LE, パック先頭から) レベル…
+//
+// このヘッダは SDK に依存しない（ホストのツールからも使える）。
+
+// ---- 地形 enum ----
+typedef enum {
+  TILE_EMPTY = 0,
+  TILE_MOUNTAIN,
+  TILE_RIVER,
+  TILE_STRANDED,
+  TILE_START,
+  TILE_CHECK,
+  TILE_GOAL
+} TileType;
+
+#define LEVEL_MAX_SIZE 255
+#define LEVEL_HEADER_SIZE 8
+#define LEVEL_CHUNK_SHIFT 3
+#define LEVEL_CHUNK (1 << LEVEL_CHUNK_SHIFT)
+#define LEVEL_CHUNK_BYTES (LEVEL_CHUNK * LEVEL_CHUNK / 2)
+#define LEVEL_CHUNKS(n) (((n) + LEVEL_CHUNK - 1) >> LEVEL_CHUNK_SHIFT)
+#define LEVEL_TILE_BYTES(cols, rows) \
+  ((uint32_t)LEVEL_CHUNKS(cols) * LEVEL_CHUNKS(rows) * LEVEL_CHUNK_BYTES)
+
+// Level に丸ごと持つ大きさ（16x16 マスまで）
+#define LEVEL_RESIDENT_CHUNKS 4
+#define LEVEL_MAX_BYTES (LEVEL_HEADER_SIZE + LEVEL_RESIDENT_CHUNKS * LEVEL_CHUNK_BYTES)
+
+// 大きいマップのチャンクのキャッシュ（10x9 マスの画面が跨ぐのは多くて 3x3 個）
+#define LEVEL_CACHE_CHUNKS 9
+
+#define LEVEL_PACK_MAGIC "DSLP"
+#define LEVEL_PACK_VERSION 2
+#define LEVEL_PACK_HEADER_SIZE 6
+
+typedef struct {
+  uint8_t data[LEVEL_MAX_BYTES];  // ヘッダ +（丸ごと持つマップなら）タイル
+  const uint8_t *tiles;           // 大きいマップ: メモリ上のタイル（ホストのツール用）
+  uint32_t stream_offset;         // 大きいマップ: 読み出し元でのタイルの位置
+} Level;
+
+static inline int level_cols(const Level *level) { return level->data[0]; }
+static inline int level_rows(const Level *level) { return level->data[1]; }
+static inline int level_start_x(const Level *level) { return level->data[2]; }
+static inline int level_start_y(const Level *level) { return level->data[3]; }
+static inline int level_check_x(const Level *level) { return level->data[4]; }
+static inline int level_check_y(const Level *level) { return level->data[5]; }
+static inline int level_goal_x(const Level *level) { return level->data[6]; }
+static inline int level_goal_y(const Level *level) { return level->data[7]; }
+
+static inline bool level_resident(const Level *level) {
+  return LEVEL_TILE_BYTES(level_cols(level), level_rows(level)) <=
+         LEVEL_RESIDENT_CHUNKS * LEVEL_CHUNK_BYTES;
+}
+
+// (x, y) がタイルの何ニブル目か
+static inline uint32_t level_nibble(const Level *level, int x, int y) {
+  uint32_t chunk = (uint32_t)(y >> LEVEL_CHUNK_SHIFT) * LEVEL_CHUNKS(level_cols(level)) +
+                   (uint32_t)(x >> LEVEL_CHUNK_SHIFT);
+  return (chunk << (2 * LEVEL_CHUNK_SHIFT)) +
+         ((uint32_t)(y & (LEVEL_CHUNK - 1)) << LEVEL_CHUNK_SHIFT) + (x & (LEVEL_CHUNK - 1));
+}
+
+// 大きいマップのタイルの 1 バイト（キャッシュになければチャンクごと読む）
+uint8_t level_stream_byte(const Level *level, uint32_t index);
+
+static inline TileType level_tile(const Level *level, int x, int y) {
+  uint32_t i = level_nibble(level, x, y);
+  uint8_t b = level_resident(level) ? level->data[LEVEL_HEADER_SIZE + (i >> 1)]
+            : level->tiles ? level->tiles[i >> 1]
+            : level_stream_byte(level, i >> 1);
+  return (TileType)((i & 1) ? (b & 0x0f) : (b >> 4));
+}
+
+// 書き込み（ジェネレータ用。丸ごと持つマップだけ）。位置のヘッダは呼ぶ側で埋める
+static inline void level_set_tile(Level *level, int x, int y, TileType tile) {
+  uint32_t i = level_nibble(level, x, y);
+  uint8_t *b = &level->data[LEVEL_HEADER_SIZE + (i >> 1)];
+  *b = (i & 1) ? ((*b & 0xf0) | tile) : ((*b & 0x0f) | (tile << 4));
+}
+
+// バイト列がレベルとして正しいか（大きさと位置が範囲内か）。
+// size は data に読めたバイト数（大きいマップはヘッダの分だけでよい）
+bool level_validate(const Level *level, int size);
+
+// ---- 大きいマップの読み出し元 ----
+// offset から size バイトを buffer に読む。読めなければ false
+typedef bool (*LevelReader)(uint32_t offset, uint8_t *buffer, size_t size);
+
+// 読み出し元を切り替えてキャッシュを空にする（レベルを読み替えるたびに呼ぶ）
+void level_stream_begin(LevelReader reader);
+// 今の読み出し元（読み替えに失敗したとき元に戻す）
+LevelReader level_stream_reader(void);
+
+// ---- レベルパック（resource から必要な分だけ読む） ----
+int level_pack_count(void);
+bool level_pack_load(int index, Level *out);
@@ -0,0 +1,74 @@
+#include <pebble.h>
+#include "level.h"
+
+// ================================
+//  レベルパック
+// ================================
+// パックのヘッダだけ覚えておき、レベル本体は選ばれたときに読む
+static ResHandle s_pack;
+static int s_pack_count = -1;
+
+static bool pack_open(void) {
+  if(s_pack_count >= 0) return s_pack_count > 0;
+
+  s_pack_count = 0;
+  s_pack = resource_get_handle(RESOURCE_ID_LEVEL_PACK);
+  uint8_t header[LEVEL_PACK_HEADER_SIZE];
+  if(!s_pack || resource_load_byte_range(s_pack, 0, header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  if(memcmp(header, LEVEL_PACK_MAGIC, 4) != 0 || header[4] != LEVEL_PACK_VERSION) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "level pack: bad header");
+    return false;
+  }
+  s_pack_count = header[5];
+  return s_pack_count > 0;
+}
+
+int level_pack_count(void) {
+  return pack_open() ? s_pack_count : 0;
+}
+
+// 大きいマップのタイルはパックから直接読む
+static bool pack_read(uint32_t offset, uint8_t *buffer, size_t size) {
+  return resource_load_byte_range(s_pack, offset, buffer, size) == size;
+}
+
+// 読めて検査も通ったときだけ out を書き換える（out は表示中の s_level のことがある）
+bool level_pack_load(int index, Level *out) {
+  if(!pack_open() || index < 0 || index >= s_pack_count) return false;
+
+  uint8_t offset_le[4];
+  if(resource_load_byte_range(s_pack, LEVEL_PACK_HEADER_SIZE + index * 4, offset_le, 4) != 4) {
+    return false;
+  }
+  uint32_t offset = offset_le[0] | (offset_le[1] << 8) | (offset_le[2] << 16) |
+                    ((uint32_t)offset_le[3] << 24);
+
+  // ヘッダで大きさを知ってから、丸ごと持てるマップならタイルも読む
+  Level level = { .tiles = NULL, .stream_offset = offset + LEVEL_HEADER_SIZE };
+  if(resource_load_byte_range(s_pack, offset, level.data, LEVEL_HEADER_SIZE) !=
+     LEVEL_HEADER_SIZE) {
+    return false;
+  }
+  size_t size = LEVEL_HEADER_SIZE;
+  if(level_resident(&level)) {
+    size_t tile_bytes = LEVEL_TILE_BYTES(level_cols(&level), level_rows(&level));
+    if(resource_load_byte_range(s_pack, level.stream_offset,
+                                level.data + LEVEL_HEADER_SIZE, tile_bytes) != tile_bytes) {
+      return false;
+    }
+    size += tile_bytes;
+  }
+
+  // 大きいマップの検査はパックから読む。通らなければ読み出し元も元に戻す
+  LevelReader previous = level_stream_reader();
+  level_stream_begin(pack_read);
+  if(!level_validate(&level, size)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "level pack: level %d is broken", index);
+    level_stream_begin(previous);
+    return false;
+  }
+  *out = level;
+  return true;
+}
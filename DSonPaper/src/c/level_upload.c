@@ -0,0 +1,343 @@
+#include "level_upload.h"
+
+// ================================
+//  定義
+// ================================
+#define META_VERSION 1
+
+// 返事を送れなかったときに送り直す回数
+#define REPLY_RETRIES 3
+
+// 1 面のチャンクの数（丸ごと持つマップもここに置く）
+#define BANK_CHUNKS LEVEL_UPLOAD_MAX_CHUNKS
+#define BANK_BYTES (BANK_CHUNKS * LEVEL_CHUNK_BYTES)
+
+// 今表に出ているマップの面とヘッダ
+typedef struct __attribute__((__packed__)) {
+  uint8_t version;
+  uint8_t bank;
+  uint8_t header[LEVEL_HEADER_SIZE];
+} UploadMeta;
+
+// RLE の展開の途中（1 通の切れ目で止まってもよいように状態で持つ）
+typedef enum {
+  RUN_CONTROL,   // 次は制御バイト
+  RUN_LITERAL,   // そのまま写す残り s_run_left バイト
+  RUN_REPEAT,    // 次の 1 バイトを s_run_left 回
+} RunState;
+
+// 返事（送信箱は 1 つなので、空くまで待つ）
+typedef enum {
+  REPLY_NONE,
+  REPLY_QUEUED,      // まだ送っていない
+  REPLY_IN_FLIGHT,   // 送った。結果（sent / failed）待ち
+} ReplyState;
+
+// 検査で見る START / CHECK / GOAL
+enum { SPECIAL_START, SPECIAL_CHECK, SPECIAL_GOAL, SPECIAL_COUNT };
+
+// ================================
+//  状態管理
+// ================================
+static Level *s_back;
+static LevelUploadHandler s_handler;
+static int s_bank = -1;          // 表に出ている面（-1 = まだない）
+
+static bool s_receiving;
+static uint32_t s_size;          // RLE 全体
+static uint32_t s_offset;        // RLE の次にほしい位置
+static RunState s_run;
+static int s_run_left;
+
+static uint32_t s_written;       // 展開したバイト数（ヘッダ込み）
+static uint32_t s_tile_bytes;    // ヘッダから決まる（ヘッダが揃うまで 0）
+static bool s_resident;
+static int s_write_bank;
+
+static ReplyState s_reply;
+static LevelUploadStatus s_reply_status;
+static uint32_t s_reply_offset;
+static int s_reply_tries;
+
+// 大きいマップ: 書き込み中のチャンク 1 つだけ持つ
+static uint8_t s_chunk[LEVEL_CHUNK_BYTES];
+
+// 検査に使うタイルのバイトの位置と、展開しながら拾った値
+static uint32_t s_special_byte[SPECIAL_COUNT];
+static uint8_t s_special_value[SPECIAL_COUNT];
+
+static uint32_t chunk_key(int bank, uint32_t chunk) {
+  return LEVEL_UPLOAD_CHUNK_KEY + bank * BANK_CHUNKS + chunk;
+}
+
+// ================================
+//  読み出し元（大きいマップのタイル）
+// ================================
+// offset は面の先頭を 0 とした位置に BANK_BYTES * 面 を足したもの（Level.stream_offset）
+static bool bank_read(uint32_t offset, uint8_t *buffer, size_t size) {
+  if(size != LEVEL_CHUNK_BYTES || offset % LEVEL_CHUNK_BYTES) return false;
+  uint32_t key = LEVEL_UPLOAD_CHUNK_KEY + offset / LEVEL_CHUNK_BYTES;
+  return persist_read_data(key, buffer, size) == (int)size;
+}
+
+// 書けなければ false（persist が一杯など）
+static bool bank_write(int bank, uint32_t chunk, const uint8_t *data) {
+  return persist_write_data(chunk_key(bank, chunk), data, LEVEL_CHUNK_BYTES) ==
+         LEVEL_CHUNK_BYTES;
+}
+
+// ================================
+//  返事
+// ================================
+// 待っている返事を送る（送信箱が空いていなければ、次に空いたとき）
+static void send_reply(void) {
+  if(s_reply != REPLY_QUEUED) return;
+  DictionaryIterator *iter;
+  if(app_message_outbox_begin(&iter) != APP_MSG_OK) return;
+  dict_write_int32(iter, MESSAGE_KEY_level_status, s_reply_status);
+  dict_write_int32(iter, MESSAGE_KEY_level_offset, s_reply_offset);
+  if(app_message_outbox_send() == APP_MSG_OK) s_reply = REPLY_IN_FLIGHT;
+}
+
+// 新しい返事は前の返事に代わる（電話が見るのは最後のものだけ）
+static void reply(LevelUploadStatus status) {
+  s_reply = REPLY_QUEUED;
+  s_reply_status = status;
+  s_reply_offset = s_offset;
+  s_reply_tries = 0;
+  send_reply();
+}
+
+static bool is_reply(DictionaryIterator *iter) {
+  return iter && dict_find(iter, MESSAGE_KEY_level_status);
+}
+
+void level_upload_outbox_sent(DictionaryIterator *iter, void *context) {
+  if(s_reply == REPLY_IN_FLIGHT && is_reply(iter)) s_reply = REPLY_NONE;
+  send_reply();   // ほかのメッセージが送信箱を空けた
+}
+
+void level_upload_outbox_failed(DictionaryIterator *iter, AppMessageResult reason,
+                                void *context) {
+  if(s_reply == REPLY_IN_FLIGHT && is_reply(iter)) {
+    s_reply = ++s_reply_tries < REPLY_RETRIES ? REPLY_QUEUED : REPLY_NONE;
+  }
+  send_reply();
+}
+
+static void fail(LevelUploadStatus status) {
+  s_receiving = false;
+  s_offset = 0;
+  reply(status);
+}
+
+// ================================
+//  展開先
+// ================================
+// ヘッダが揃った：大きさと位置を見て、タイルの行き先を決める
+static LevelUploadStatus header_ready(void) {
+  const Level *level = s_back;
+  int cols = level_cols(level), rows = level_rows(level);
+  if(cols < 1 || rows < 1) return LEVEL_UPLOAD_INVALID;
+
+  s_tile_bytes = LEVEL_TILE_BYTES(cols, rows);
+  s_resident = level_resident(level);
+  if(s_tile_bytes > BANK_BYTES) return LEVEL_UPLOAD_TOO_LARGE;
+
+  const uint8_t *positions = &level->data[2];
+  for(int i = 0; i < SPECIAL_COUNT; i++) {
+    int x = positions[i * 2], y = positions[i * 2 + 1];
+    if(x >= cols || y >= rows) return LEVEL_UPLOAD_INVALID;
+    s_special_byte[i] = level_nibble(level, x, y) >> 1;
+  }
+  return LEVEL_UPLOAD_DONE;
+}
+
+static LevelUploadStatus put_byte(uint8_t b) {
+  if(s_written < LEVEL_HEADER_SIZE) {
+    s_back->data[s_written++] = b;
+    return s_written == LEVEL_HEADER_SIZE ? header_ready() : LEVEL_UPLOAD_DONE;
+  }
+
+  uint32_t t = s_written - LEVEL_HEADER_SIZE;
+  if(t >= s_tile_bytes) return LEVEL_UPLOAD_INVALID;
+  s_written++;
+
+  for(int i = 0; i < SPECIAL_COUNT; i++) {
+    if(s_special_byte[i] == t) s_special_value[i] = b;
+  }
+
+  if(s_resident) {
+    s_back->data[LEVEL_HEADER_SIZE + t] = b;
+    return LEVEL_UPLOAD_DONE;
+  }
+  // チャンクが埋まるたびに、表示していない方の面へ書く
+  s_chunk[t % LEVEL_CHUNK_BYTES] = b;
+  if(t % LEVEL_CHUNK_BYTES == LEVEL_CHUNK_BYTES - 1 &&
+     !bank_write(s_write_bank, t / LEVEL_CHUNK_BYTES, s_chunk)) {
+    return LEVEL_UPLOAD_STORAGE;
+  }
+  return LEVEL_UPLOAD_DONE;
+}
+
+static LevelUploadStatus expand(const uint8_t *data, uint16_t length) {
+  for(uint16_t i = 0; i < length; i++) {
+    uint8_t b = data[i];
+    LevelUploadStatus status = LEVEL_UPLOAD_DONE;
+    switch(s_run) {
+      case RUN_CONTROL:
+        s_run = b < 0x80 ? RUN_LITERAL : RUN_REPEAT;
+        s_run_left = b < 0x80 ? b + 1 : b - 0x80 + 3;
+        break;
+      case RUN_LITERAL:
+        status = put_byte(b);
+        if(--s_run_left == 0) s_run = RUN_CONTROL;
+        break;
+      case RUN_REPEAT:
+        for(; s_run_left > 0 && status == LEVEL_UPLOAD_DONE; s_run_left--) status = put_byte(b);
+        s_run = RUN_CONTROL;
+        break;
+    }
+    if(status != LEVEL_UPLOAD_DONE) return status;
+  }
+  return LEVEL_UPLOAD_DONE;
+}
+
+// ================================
+//  仕上げ
+// ================================
+static bool specials_ok(void) {
+  static const TileType EXPECTED[SPECIAL_COUNT] = { TILE_START, TILE_CHECK, TILE_GOAL };
+  for(int i = 0; i < SPECIAL_COUNT; i++) {
+    const uint8_t *p = &s_back->data[2 + i * 2];
+    uint32_t nibble = level_nibble(s_back, p[0], p[1]);
+    uint8_t b = s_special_value[i];
+    if((TileType)((nibble & 1) ? (b & 0x0f) : (b >> 4)) != EXPECTED[i]) return false;
+  }
+  return true;
+}
+
+static void commit(void) {
+  Level *level = s_back;
+  if(s_run != RUN_CONTROL || s_written != LEVEL_HEADER_SIZE + s_tile_bytes || !specials_ok()) {
+    fail(LEVEL_UPLOAD_INVALID);
+    return;
+  }
+
+  // 丸ごと持つマップも面に残す（次に起動したとき level_upload_load で読む）
+  if(s_resident) {
+    for(uint32_t c = 0; c < s_tile_bytes / LEVEL_CHUNK_BYTES; c++) {
+      if(!bank_write(s_write_bank, c, &level->data[LEVEL_HEADER_SIZE + c * LEVEL_CHUNK_BYTES])) {
+        fail(LEVEL_UPLOAD_STORAGE);   // meta はそのまま：前のマップが残る
+        return;
+      }
+    }
+  }
+  // ここで面が切り替わる（ここより前に切れても、書けなくても前のマップが残る）
+  UploadMeta meta = { .version = META_VERSION, .bank = s_write_bank };
+  memcpy(meta.header, level->data, LEVEL_HEADER_SIZE);
+  if(persist_write_data(LEVEL_UPLOAD_META_KEY, &meta, sizeof(meta)) != (int)sizeof(meta)) {
+    fail(LEVEL_UPLOAD_STORAGE);
+    return;
+  }
+  s_bank = s_write_bank;
+
+  level->tiles = NULL;
+  level->stream_offset = (uint32_t)s_bank * BANK_BYTES;
+  if(!s_resident) level_stream_begin(bank_read);
+
+  s_receiving = false;
+  reply(LEVEL_UPLOAD_DONE);
+  s_back = s_handler ? s_handler(level) : level;
+}
+
+// ================================
+//  公開関数
+// ================================
+void level_upload_init(Level *back, LevelUploadHandler handler) {
+  s_back = back;
+  s_handler = handler;
+  if(s_bank < 0) {
+    UploadMeta meta;
+    if(persist_read_data(LEVEL_UPLOAD_META_KEY, &meta, sizeof(meta)) == sizeof(meta) &&
+       meta.version == META_VERSION && meta.bank < 2) {
+      s_bank = meta.bank;
+    }
+  }
+}
+
+bool level_upload_receive(DictionaryIterator *iter) {
+  send_reply();   // 送れずに待っている返事があれば先に
+  Tuple *offset = dict_find(iter, MESSAGE_KEY_level_offset);
+  Tuple *data = dict_find(iter, MESSAGE_KEY_level_data);
+  if(!offset || !data || data->type != TUPLE_BYTE_ARRAY) return false;
+
+  Tuple *size = dict_find(iter, MESSAGE_KEY_level_size);
+  if(size && offset->value->int32 == 0) {
+    // 最初の 1 通：やり直しも含めてここから
+    s_receiving = true;
+    s_size = size->value->uint32;
+    s_offset = 0;
+    s_run = RUN_CONTROL;
+    s_written = 0;
+    s_tile_bytes = 0;
+    s_write_bank = s_bank == 0 ? 1 : 0;
+  }
+  if(!s_receiving) {
+    // 始まりを取りこぼした：最初から
+    s_offset = 0;
+    reply(LEVEL_UPLOAD_RESEND);
+    return true;
+  }
+
+  uint32_t at = offset->value->uint32;
+  if(at < s_offset) return true;   // ACK が届かずに送り直された分（もう持っている）
+  if(at > s_offset || at + data->length > s_size) {
+    reply(LEVEL_UPLOAD_RESEND);
+    return true;
+  }
+
+  LevelUploadStatus status = expand(data->value->data, data->length);
+  if(status != LEVEL_UPLOAD_DONE) {
+    fail(status);
+    return true;
+  }
+  s_offset += data->length;
+  if(s_offset == s_size) commit();
+  return true;
+}
+
+// 読めて検査も通ったときだけ s_bank・読み出し元・out を書き換える（out は表示中の s_level）
+bool level_upload_load(Level *out) {
+  UploadMeta meta;
+  if(persist_read_data(LEVEL_UPLOAD_META_KEY, &meta, sizeof(meta)) != sizeof(meta) ||
+     meta.version != META_VERSION || meta.bank > 1) {
+    return false;
+  }
+  Level level = { .tiles = NULL, .stream_offset = (uint32_t)meta.bank * BANK_BYTES };
+  memcpy(level.data, meta.header, LEVEL_HEADER_SIZE);
+
+  uint32_t tile_bytes = LEVEL_TILE_BYTES(level_cols(&level), level_rows(&level));
+  if(tile_bytes > BANK_BYTES) return false;
+  bool resident = level_resident(&level);
+  if(resident) {
+    for(uint32_t c = 0; c < tile_bytes / LEVEL_CHUNK_BYTES; c++) {
+      if(!bank_read(level.stream_offset + c * LEVEL_CHUNK_BYTES,
+                    &level.data[LEVEL_HEADER_SIZE + c * LEVEL_CHUNK_BYTES], LEVEL_CHUNK_BYTES)) {
+        return false;
+      }
+    }
+  }
+
+  // 大きいマップの検査は面から読む。通らなければ読み出し元も元に戻す
+  LevelReader previous = level_stream_reader();
+  if(!resident) level_stream_begin(bank_read);
+  if(!level_validate(&level, LEVEL_HEADER_SIZE + (resident ? tile_bytes : 0))) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "level upload: saved level is broken");
+    if(!resident) level_stream_begin(previous);
+    return false;
+  }
+  s_bank = meta.bank;
+  *out = level;
+  return true;
+}
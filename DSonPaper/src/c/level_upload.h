@@ -0,0 +1,62 @@
+#pragma once
+#include <pebble.h>
+#include "level.h"
+
+// ================================
+//  level_upload: 電話から送られたマップを受け取る
+// ================================
+// 電話（src/pkjs/level_upload.js）はマップをパック形式（level.h）にしてから RLE で縮め、
+// LEVEL_UPLOAD_CHUNK バイトずつ送る。次の 1 通は前の 1 通の ACK が返ってから。
+//
+//   電話 → ウォッチ  level_offset（RLE の何バイト目か） level_data（RLE の一部）
+//                    最初の 1 通だけ level_size（RLE 全体のバイト数）も付ける
+//   ウォッチ → 電話  level_status（LevelUploadStatus） level_offset（次にほしい位置）
+//                    終わったときと、抜けや壊れたデータに気づいたときだけ。
+//                    送信箱が空いていなければ待って、送れなければ何回か送り直す
+//
+// 受け取りながら展開し、ヘッダとタイルは裏のバッファ（表示中でない方の Level）へ直接書く。
+// 丸ごと持てない大きいマップのタイルはチャンク（32 バイト）ごとに persist へ書くので、
+// マップ全体の大きさの一時領域は要らない。
+// 最後に検査して通ったときだけ表に出す（handler）。
+//
+// 受け取ったマップは persist に 2 面持ち、新しいマップは表示中でない方の面に書く。
+// 途中で切れたり壊れていたりしても、前のマップは消えない。
+//
+// RLE（1 バイトの制御 + データ）:
+//   0x00..0x7f  続く (c + 1) バイトをそのまま
+//   0x80..0xff  続く 1 バイトを (c - 0x80 + 3) 回
+
+// 1 通に載せる RLE のバイト数（src/pkjs/level_upload.js と同じ値）
+#define LEVEL_UPLOAD_CHUNK 120
+// 受け取れる大きいマップのタイルのチャンク数（例: 64x32 マス、40x48 マス）
+#define LEVEL_UPLOAD_MAX_CHUNKS 32
+
+// persist のキー（5: 今の面とヘッダ、6〜: 2 面ぶんのチャンク）
+#define LEVEL_UPLOAD_META_KEY 5
+#define LEVEL_UPLOAD_CHUNK_KEY 6
+
+typedef enum {
+  LEVEL_UPLOAD_DONE = 0,      // 受け取って表に出した
+  LEVEL_UPLOAD_RESEND = 1,    // level_offset から送り直してほしい
+  LEVEL_UPLOAD_INVALID = 2,   // 壊れている（展開できない・検査に通らない）
+  LEVEL_UPLOAD_TOO_LARGE = 3, // 面に入らない
+  LEVEL_UPLOAD_STORAGE = 4,   // persist に書けなかった（前のマップのまま）
+} LevelUploadStatus;
+
+// 受け取ったレベルを表に出し、次に書き込んでよい（表示しなくなった）方を返す
+typedef Level *(*LevelUploadHandler)(Level *level);
+
+// 受信箱と送信箱に要る大きさ（app_message_open に渡す）
+#define LEVEL_UPLOAD_INBOX_SIZE (1 + 2 * (7 + 4) + 7 + LEVEL_UPLOAD_CHUNK)
+#define LEVEL_UPLOAD_OUTBOX_SIZE (1 + 2 * (7 + 4))
+
+// back: 表示していない方の Level
+void level_upload_init(Level *back, LevelUploadHandler handler);
+// level_ キーを含むメッセージなら処理して true
+bool level_upload_receive(DictionaryIterator *iter);
+// 送信の結果（AppMessage のコールバックからそのまま呼ぶ。返事の送り直しに使う）
+void level_upload_outbox_sent(DictionaryIterator *iter, void *context);
+void level_upload_outbox_failed(DictionaryIterator *iter, AppMessageResult reason,
+                                void *context);
+// 最後に受け取ったマップを persist から読む（なければ false）
+bool level_upload_load(Level *out);
@@ -0,0 +1,355 @@
+#include "map_gen.h"
+
+// ================================
+//  定義
+// ================================
+#define SLICE_STEPS 4          // 1 回のタイマーで進める段数
+#define SLICE_INTERVAL_MS 10   // 次の段までの間（ボタンや描画を先に通す）
+#define MAX_ATTEMPTS 8         // 通らなければ障害物を減らして作り直す回数
+
+// 障害物（山・川・座礁地帯）の割合（%）。難しさごとの最初の値から、作り直すたびに減らし、最後は 0
+static const uint8_t DENSITY_START[MAP_GEN_DIFFICULTY_COUNT] = { 30, 42, 54 };
+#define CLUSTER_PCT 55         // 隣の障害物と同じ地形にする割合（塊にする）
+
+// 作るマップの大きさの上限（Level に丸ごと持てて、1 行が CellSet の 1 語に入る）
+#define GEN_MAX_COLS 10
+#define GEN_MAX_ROWS 9
+
+// 手番の始めに止まっていられる劣化（0〜MAX_DECAY-2。次に振ると MAX_DECAY）
+#define LAYERS (MAX_DECAY - 1)
+
+// マスの集合。1 行 1 語、ビット x が列 x
+typedef struct {
+  uint16_t row[GEN_MAX_ROWS];
+} CellSet;
+
+typedef enum {
+  PHASE_IDLE,
+  PHASE_FILL,    // 地形を 1 行ずつ
+  PHASE_PLACE,   // START / CHECK / GOAL と検査の準備
+  PHASE_SOLVE,   // 劣化 1 段ずつ到達できる位置を広げる
+} Phase;
+
+// ================================
+//  状態管理
+// ================================
+static Phase s_phase = PHASE_IDLE;
+static int s_difficulty = MAP_GEN_NORMAL;
+static AppTimer *s_timer;
+static MapGenHandler s_handler;
+static void *s_context;
+
+static uint32_t s_rng;
+static int s_attempt;
+static int s_fill_row;
+static Level s_level;
+
+// 検査用：地形ごとのマス、GOAL / CHECK、劣化と CHECK 済みごとの停止位置
+static CellSet s_plain;              // 平地・START・CHECK・GOAL
+static CellSet s_hazard[3];          // 山・川・座礁地帯
+static CellSet s_check;
+static CellSet s_goal;
+static CellSet s_rest[LAYERS][2];
+static int s_layer;
+
+// ----------------------------------------------------------
+// 乱数（xorshift32。同じシードなら同じマップ）
+// ----------------------------------------------------------
+static uint32_t next_random(void) {
+  s_rng ^= s_rng << 13;
+  s_rng ^= s_rng >> 17;
+  s_rng ^= s_rng << 5;
+  return s_rng;
+}
+
+static int random_below(int n) {
+  return (int)(next_random() % (uint32_t)n);
+}
+
+// ----------------------------------------------------------
+// マスの集合
+// ----------------------------------------------------------
+static bool cells_any(const CellSet *a) {
+  for(int y = 0; y < GEN_MAX_ROWS; y++) {
+    if(a->row[y]) return true;
+  }
+  return false;
+}
+
+static void cells_or(CellSet *dst, const CellSet *a) {
+  for(int y = 0; y < GEN_MAX_ROWS; y++) dst->row[y] |= a->row[y];
+}
+
+static void cells_set(CellSet *a, int x, int y) {
+  a->row[y] |= 1 << x;
+}
+
+// 上下左右に 1 マス動いた先（マップの外は落とす）
+static void cells_step(CellSet *dst, const CellSet *a) {
+  int cols = level_cols(&s_level);
+  int rows = level_rows(&s_level);
+  uint16_t mask = (1 << cols) - 1;
+  for(int y = 0; y < rows; y++) {
+    uint16_t r = (a->row[y] << 1) | (a->row[y] >> 1);
+    if(y > 0) r |= a->row[y - 1];
+    if(y + 1 < rows) r |= a->row[y + 1];
+    dst->row[y] = r & mask;
+  }
+  for(int y = rows; y < GEN_MAX_ROWS; y++) dst->row[y] = 0;
+}
+
+// ================================
+//  生成
+// ================================
+static int hazard_index(TileType t) {
+  switch(t) {
+    case TILE_MOUNTAIN: return 0;
+    case TILE_RIVER: return 1;
+    case TILE_STRANDED: return 2;
+    default: return -1;
+  }
+}
+
+static TileType random_hazard(void) {
+  int r = random_below(10);
+  return r < 4 ? TILE_MOUNTAIN : r < 8 ? TILE_RIVER : TILE_STRANDED;
+}
+
+static void begin_attempt(void) {
+  int cols = 7 + random_below(GEN_MAX_COLS - 6);
+  int rows = 6 + random_below(GEN_MAX_ROWS - 5);
+  memset(&s_level, 0, sizeof(s_level));
+  s_level.data[0] = cols;
+  s_level.data[1] = rows;
+  s_fill_row = 0;
+  s_phase = PHASE_FILL;
+}
+
+static void fill_row(void) {
+  int y = s_fill_row;
+  int start = DENSITY_START[s_difficulty];
+  int density = start - s_attempt * (start / (MAX_ATTEMPTS - 1));
+  if(s_attempt == MAX_ATTEMPTS - 1) density = 0;
+
+  for(int x = 0; x < level_cols(&s_level); x++) {
+    TileType t = TILE_EMPTY;
+    if(random_below(100) < density) {
+      TileType left = x > 0 ? level_tile(&s_level, x - 1, y) : TILE_EMPTY;
+      TileType up = y > 0 ? level_tile(&s_level, x, y - 1) : TILE_EMPTY;
+      TileType near = (random_below(2) && left != TILE_EMPTY) ? left : up;
+      if(near == TILE_EMPTY) near = left;
+      t = (near != TILE_EMPTY && random_below(100) < CLUSTER_PCT) ? near : random_hazard();
+    }
+    level_set_tile(&s_level, x, y, t);
+  }
+
+  if(++s_fill_row == level_rows(&s_level)) s_phase = PHASE_PLACE;
+}
+
+static int distance(int ax, int ay, int bx, int by) {
+  return abs(ax - bx) + abs(ay - by);
+}
+
+// START / GOAL は離し、CHECK は両方から少し離す（試す回数は決まっている）
+static void place_marks(void) {
+  int cols = level_cols(&s_level);
+  int rows = level_rows(&s_level);
+  int far = (cols + rows) / 2;
+
+  int sx = random_below(cols), sy = random_below(rows);
+  int gx = cols - 1 - sx, gy = rows - 1 - sy;
+  for(int i = 0; i < 16; i++) {
+    int x = random_below(cols), y = random_below(rows);
+    if(distance(sx, sy, x, y) >= far) {
+      gx = x;
+      gy = y;
+      break;
+    }
+  }
+  int cx = (sx + gx) / 2, cy = (sy + gy) / 2;
+  for(int i = 0; i < 16; i++) {
+    int x = random_below(cols), y = random_below(rows);
+    if(distance(sx, sy, x, y) >= 3 && distance(gx, gy, x, y) >= 3) {
+      cx = x;
+      cy = y;
+      break;
+    }
+  }
+  if((cx == sx && cy == sy) || (cx == gx && cy == gy)) {
+    cx = (sx + 1) % cols;   // 小さいマップで重なったとき
+    cy = sy;
+  }
+
+  level_set_tile(&s_level, sx, sy, TILE_START);
+  level_set_tile(&s_level, cx, cy, TILE_CHECK);
+  level_set_tile(&s_level, gx, gy, TILE_GOAL);
+  s_level.data[2] = sx;
+  s_level.data[3] = sy;
+  s_level.data[4] = cx;
+  s_level.data[5] = cy;
+  s_level.data[6] = gx;
+  s_level.data[7] = gy;
+}
+
+// ================================
+//  検査
+// ================================
+// 地形ごとに「最大の目を出さない」ときの目の上限
+static int assumed_dice(TileType t) {
+  int max = rules_dice_max(t);
+  return max > 1 ? max - 1 : 1;
+}
+
+static void begin_solve(void) {
+  memset(&s_plain, 0, sizeof(s_plain));
+  memset(s_hazard, 0, sizeof(s_hazard));
+  memset(&s_check, 0, sizeof(s_check));
+  memset(&s_goal, 0, sizeof(s_goal));
+  memset(s_rest, 0, sizeof(s_rest));
+
+  for(int y = 0; y < level_rows(&s_level); y++) {
+    for(int x = 0; x < level_cols(&s_level); x++) {
+      int h = hazard_index(level_tile(&s_level, x, y));
+      cells_set(h >= 0 ? &s_hazard[h] : &s_plain, x, y);
+    }
+  }
+  cells_set(&s_check, level_check_x(&s_level), level_check_y(&s_level));
+  cells_set(&s_goal, level_goal_x(&s_level), level_goal_y(&s_level));
+  cells_set(&s_rest[0][0], level_start_x(&s_level), level_start_y(&s_level));
+  s_layer = 0;
+  s_phase = PHASE_SOLVE;
+}
+
+static void rest_at(int decay, int checked, const CellSet *cells) {
+  if(decay < LAYERS) cells_or(&s_rest[decay][checked], cells);
+}
+
+// 劣化 d で止まっている位置から 1 回振る。d+1 で GOAL に着ければ true
+static bool solve_layer(int d) {
+  // 振り出す地形ごとに目の上限が違うので分けて動かす（平地・山・川・座礁）
+  for(int k = 0; k < 4; k++) {
+    const CellSet *from = (k == 0) ? &s_plain : &s_hazard[k - 1];
+    TileType from_tile = (k == 0) ? TILE_EMPTY : (TileType)(TILE_MOUNTAIN + k - 1);
+
+    CellSet f[2];
+    bool any = false;
+    for(int c = 0; c < 2; c++) {
+      for(int y = 0; y < GEN_MAX_ROWS; y++) {
+        f[c].row[y] = s_rest[d][c].row[y] & from->row[y];
+      }
+      any |= cells_any(&f[c]);
+    }
+    if(!any) continue;
+
+    for(int step = 0; step < assumed_dice(from_tile); step++) {
+      // CHECK から出たら通過済み
+      for(int y = 0; y < GEN_MAX_ROWS; y++) {
+        f[1].row[y] |= f[0].row[y] & s_check.row[y];
+        f[0].row[y] &= ~s_check.row[y];
+      }
+
+      CellSet next[2];
+      for(int c = 0; c < 2; c++) {
+        CellSet moved;
+        cells_step(&moved, &f[c]);
+        for(int y = 0; y < GEN_MAX_ROWS; y++) next[c].row[y] = moved.row[y] & s_plain.row[y];
+
+        for(int h = 0; h < 3; h++) {
+          CellSet same, other, stop;
+          for(int y = 0; y < GEN_MAX_ROWS; y++) {
+            same.row[y] = f[c].row[y] & s_hazard[h].row[y];
+            other.row[y] = f[c].row[y] & ~s_hazard[h].row[y];
+          }
+          // 同じ地形の中は進める。別の地形から入ったら止まる（座礁地帯は劣化 +2）
+          cells_step(&moved, &same);
+          cells_step(&stop, &other);
+          for(int y = 0; y < GEN_MAX_ROWS; y++) {
+            next[c].row[y] |= moved.row[y] & s_hazard[h].row[y];
+            stop.row[y] &= s_hazard[h].row[y];
+          }
+          rest_at(d + 1 + (h == 2 ? 2 : 0), c, &stop);
+        }
+      }
+
+      for(int y = 0; y < GEN_MAX_ROWS; y++) {
+        if(next[1].row[y] & s_goal.row[y]) return true;
+      }
+      // ここで目が尽きてもよい
+      rest_at(d + 1, 0, &next[0]);
+      rest_at(d + 1, 1, &next[1]);
+      f[0] = next[0];
+      f[1] = next[1];
+    }
+  }
+  return false;
+}
+
+// ================================
+//  タイマー
+// ================================
+static void finish(int par_decay) {
+  s_phase = PHASE_IDLE;
+  s_timer = NULL;
+  if(s_handler) s_handler(&s_level, par_decay, s_context);
+}
+
+static void retry(void) {
+  s_attempt++;
+  if(s_attempt >= MAX_ATTEMPTS) s_attempt = MAX_ATTEMPTS - 1;   // 障害物なしは必ず通る
+  begin_attempt();
+}
+
+static void slice_handler(void *data) {
+  for(int i = 0; i < SLICE_STEPS; i++) {
+    switch(s_phase) {
+      case PHASE_FILL:
+        fill_row();
+        break;
+      case PHASE_PLACE:
+        place_marks();
+        if(level_validate(&s_level, sizeof(s_level.data))) {
+          begin_solve();
+        } else {
+          retry();   // 小さいマップで印が重なったとき
+        }
+        break;
+      case PHASE_SOLVE:
+        if(solve_layer(s_layer)) {
+          finish(s_layer + 1);
+          return;
+        }
+        if(++s_layer >= LAYERS) retry();
+        break;
+      default:
+        s_timer = NULL;
+        return;
+    }
+  }
+  s_timer = app_timer_register(SLICE_INTERVAL_MS, slice_handler, NULL);
+}
+
+void map_gen_start(uint32_t seed, MapGenHandler handler, void *context) {
+  map_gen_cancel();
+  s_handler = handler;
+  s_context = context;
+  s_rng = seed ? seed : 0x9e3779b9;
+  s_attempt = 0;
+  begin_attempt();
+  s_timer = app_timer_register(0, slice_handler, NULL);
+}
+
+void map_gen_cancel(void) {
+  if(s_timer) {
+    app_timer_cancel(s_timer);
+    s_timer = NULL;
+  }
+  s_phase = PHASE_IDLE;
+}
+
+bool map_gen_busy(void) {
+  return s_phase != PHASE_IDLE;
+}
+
+void map_gen_set_difficulty(MapGenDifficulty difficulty) {
+  if(difficulty >= 0 && difficulty < MAP_GEN_DIFFICULTY_COUNT) s_difficulty = difficulty;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <pebble.h>
+#include "rules.h"
+
+// ================================
+//  map_gen: シードからレベルを作る（エンドレスモード用）
+// ================================
+// app_timer の 1 回ごとに決まった量（1 行の生成、または検査の 1 段）だけ
+// 進めるので、生成中もイベントループは止まらない。
+// 作ったマップは本物のルール（地形が変わると停止、座礁地帯で劣化 +2、
+// CHECK を通ってからの GOAL、MAX_DECAY）でクリアできるかを調べ、
+// 通ったものだけを渡す。調べるときは「最大の目を一度も出さない」と仮定する。
+// 作業領域は静的に持ち、ヒープは使わない。
+//
+//   map_gen_start(seed, handler, NULL);   // 終わると handler が呼ばれる
+//   map_gen_cancel();                     // 画面を閉じるときなど
+//   map_gen_set_difficulty(MAP_GEN_HARD); // 次の map_gen_start から
+
+// level: 作ったレベル（呼び出しの間だけ有効なのでコピーして使う）
+// par_decay: 検査で見つかった一番少ない劣化でのクリア
+// 難しさ：最初に置く障害物の割合（やさしい 30% / ふつう 42% / むずかしい 54%）
+typedef enum {
+  MAP_GEN_EASY,
+  MAP_GEN_NORMAL,
+  MAP_GEN_HARD,
+  MAP_GEN_DIFFICULTY_COUNT
+} MapGenDifficulty;
+
+typedef void (*MapGenHandler)(const Level *level, int par_decay, void *context);
+
+void map_gen_start(uint32_t seed, MapGenHandler handler, void *context);
+void map_gen_cancel(void);
+bool map_gen_busy(void);
+void map_gen_set_difficulty(MapGenDifficulty difficulty);
@@ -0,0 +1,61 @@
+#include "policy.h"
+#include "rules.h"
+
+// ================================
+//  状態管理
+// ================================
+// ヘッダと、最後に引いたレベルの表の位置だけ覚えておく
+static ResHandle s_policy;
+static int s_count = -1;
+static int s_cached_level = -1;
+static uint32_t s_cached_offset;
+
+static bool policy_open(void) {
+  if(s_count >= 0) return s_count > 0;
+
+  s_count = 0;
+  s_policy = resource_get_handle(RESOURCE_ID_POLICY);
+  uint8_t header[POLICY_HEADER_SIZE];
+  if(!s_policy || resource_load_byte_range(s_policy, 0, header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  if(memcmp(header, POLICY_MAGIC, 4) != 0 || header[4] != POLICY_VERSION) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "policy: bad header");
+    return false;
+  }
+  s_count = header[5];
+  return s_count > 0;
+}
+
+static bool table_offset(int level_index, uint32_t *offset) {
+  if(level_index == s_cached_level) {
+    *offset = s_cached_offset;
+    return true;
+  }
+  uint8_t le[4];
+  if(resource_load_byte_range(s_policy, POLICY_HEADER_SIZE + level_index * 4, le, 4) != 4) {
+    return false;
+  }
+  s_cached_level = level_index;
+  s_cached_offset = le[0] | (le[1] << 8) | (le[2] << 16) | ((uint32_t)le[3] << 24);
+  *offset = s_cached_offset;
+  return true;
+}
+
+// ================================
+//  引く
+// ================================
+int policy_hint(int level_index, int cols, int rows, int x, int y, int decay, bool checked,
+                int dice_left) {
+  if(!policy_open() || level_index < 0 || level_index >= s_count) return -1;
+  if(decay < 0 || decay >= MAX_DECAY || dice_left < 1 || dice_left > POLICY_MAX_DICE) return -1;
+
+  uint32_t offset;
+  if(!table_offset(level_index, &offset) || offset == 0) return -1;
+
+  uint32_t index = ((uint32_t)((checked ? MAX_DECAY : 0) + decay) * POLICY_MAX_DICE +
+                    (dice_left - 1)) * (cols * rows) + y * cols + x;
+  uint8_t b;
+  if(resource_load_byte_range(s_policy, offset + index / 4, &b, 1) != 1) return -1;
+  return (b >> ((index & 3) * 2)) & 3;
+}
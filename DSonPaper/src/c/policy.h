@@ -0,0 +1,25 @@
+#pragma once
+#include <pebble.h>
+
+// ================================
+//  policy: レベルパックの各レベルの最善手（ヒント用）
+// ================================
+// tools/policy_gen.py がビルド時に解いた表（resources/data/policy.bin）を
+// 引くだけ。移動中の状態 1 つにつき 2bit で、方向は move_dir と同じ
+// （0=上, 1=左, 2=下, 3=右）。
+//
+//   "DSPT" version(1) count(1) offset[count](uint32 LE) 表…
+//
+//   表の位置 = ((checked * MAX_DECAY + decay) * 4 + 残りの目-1) * cols*rows + y*cols + x
+//   1 バイトに 4 状態、下位ビットから。offset 0 はそのレベルの表なし（大きいマップ）
+//
+// 引くたびに 1 バイトだけ resource_load_byte_range で読む。
+
+#define POLICY_MAGIC "DSPT"
+#define POLICY_VERSION 1
+#define POLICY_HEADER_SIZE 6
+#define POLICY_MAX_DICE 4
+
+// レベル index の状態での最善の方向。表がなければ -1
+int policy_hint(int level_index, int cols, int rows, int x, int y, int decay, bool checked,
+                int dice_left);
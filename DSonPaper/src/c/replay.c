@@ -0,0 +1,184 @@
+#include "replay.h"
+
+// ================================
+//  定義
+// ================================
+#define REPLAY_VERSION 1
+
+// フラッシュ上の形（新しい順）
+typedef struct __attribute__((__packed__)) {
+  uint8_t version;
+  uint8_t count;
+  ReplayRecord records[REPLAY_SLOTS];
+} ReplayTable;
+
+// ================================
+//  状態管理
+// ================================
+static ReplayTable s_table;
+static bool s_dirty;
+static bool s_live;    // 0 番が今遊んでいるゲーム
+
+// ================================
+//  乱数（xorshift32）
+// ================================
+static uint32_t next_random(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+// 0..n-1 を一様に（掛けて上位を取り、端数の分だけ引き直す。% n の偏りがない）
+static int random_below(uint32_t *state, uint32_t n) {
+  uint64_t m = (uint64_t)next_random(state) * n;
+  if((uint32_t)m < n) {
+    uint32_t threshold = -n % n;
+    while((uint32_t)m < threshold) m = (uint64_t)next_random(state) * n;
+  }
+  return (int)(m >> 32);
+}
+
+static int dice(uint32_t *state, int max) {
+  return max > 1 ? random_below(state, max) + 1 : 1;   // 1 固定のときは乱数を進めない
+}
+
+// 時刻からシード（近い時刻でも離れた値にする。0 は xorshift が止まるので避ける）
+static uint32_t new_seed(void) {
+  static uint32_t s_counter;
+  time_t t;
+  uint16_t ms = time_ms(&t, NULL);
+  uint32_t x = (uint32_t)t * 1000 + ms + 0x9e3779b9 * ++s_counter;
+  x ^= x >> 16;
+  x *= 0x85ebca6b;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35;
+  x ^= x >> 16;
+  return x ? x : 0x9e3779b9;
+}
+
+// ================================
+//  記録
+// ================================
+static ReplayRecord *live(void) {
+  return s_live ? &s_table.records[0] : NULL;
+}
+
+void replay_init(void) {
+  if(persist_read_data(REPLAY_KEY, &s_table, sizeof(s_table)) != sizeof(s_table) ||
+     s_table.version != REPLAY_VERSION || s_table.count > REPLAY_SLOTS) {
+    memset(&s_table, 0, sizeof(s_table));
+    s_table.version = REPLAY_VERSION;
+  }
+  s_live = false;
+}
+
+void replay_begin(ReplaySource source, int level_index, uint32_t map_seed, int difficulty) {
+  ReplayRecord *r = &s_table.records[0];
+  // 一度も振っていない今のゲームは残さない
+  bool keep = s_table.count > 0 && !(s_live && r->rolls == 0);
+  if(keep) {
+    memmove(&s_table.records[1], &s_table.records[0],
+            sizeof(ReplayRecord) * (REPLAY_SLOTS - 1));
+    if(s_table.count < REPLAY_SLOTS) s_table.count++;
+  } else if(s_table.count == 0) {
+    s_table.count = 1;
+  }
+
+  memset(r, 0, sizeof(*r));
+  r->seed = r->rng = new_seed();
+  r->map_seed = source == REPLAY_ENDLESS ? map_seed : 0;
+  r->level_index = source == REPLAY_PACK ? level_index : 0;
+  r->flags = (source & 3) | ((difficulty & 3) << 2);
+  s_live = true;
+  s_dirty = true;
+}
+
+bool replay_resume(ReplaySource source, int level_index, uint32_t map_seed) {
+  const ReplayRecord *r = &s_table.records[0];
+  s_live = s_table.count > 0 && replay_source(r) == source &&
+           !(r->flags & (REPLAY_FLAG_CLEAR | REPLAY_FLAG_OVER)) &&
+           (source != REPLAY_PACK || r->level_index == level_index) &&
+           (source != REPLAY_ENDLESS || r->map_seed == map_seed);
+  return s_live;
+}
+
+int replay_roll(int max) {
+  ReplayRecord *r = live();
+  if(!r) {
+    // 記録していないとき（再生中など）は別の乱数で
+    static uint32_t s_spare;
+    if(!s_spare) s_spare = new_seed();
+    return dice(&s_spare, max);
+  }
+  if(r->rolls < UINT8_MAX) r->rolls++;
+  s_dirty = true;
+  uint32_t rng = r->rng;   // packed なので直接は渡さない
+  int roll = dice(&rng, max);
+  r->rng = rng;
+  return roll;
+}
+
+void replay_record_step(int dir) {
+  ReplayRecord *r = live();
+  if(!r) return;
+  if(r->steps >= REPLAY_MAX_STEPS) {
+    r->flags |= REPLAY_FLAG_TRUNCATED;
+    return;
+  }
+  r->dirs[r->steps / 4] |= (dir & 3) << ((r->steps % 4) * 2);
+  r->steps++;
+  s_dirty = true;
+}
+
+void replay_finish(bool clear) {
+  ReplayRecord *r = live();
+  if(!r) return;
+  uint8_t flag = clear ? REPLAY_FLAG_CLEAR : REPLAY_FLAG_OVER;
+  if(r->flags & flag) return;
+  r->flags |= flag;
+  s_dirty = true;
+}
+
+// ================================
+//  書き込み
+// ================================
+void replay_flush(void) {
+  if(!s_dirty) return;
+  persist_write_data(REPLAY_KEY, &s_table, sizeof(s_table));
+  s_dirty = false;
+}
+
+int replay_count(void) {
+  return s_table.count;
+}
+
+const ReplayRecord *replay_get(int index) {
+  return index >= 0 && index < s_table.count ? &s_table.records[index] : NULL;
+}
+
+// ================================
+//  再生
+// ================================
+void replay_player_start(ReplayPlayer *p, const ReplayRecord *record, GameState *g,
+                         const Level *level) {
+  *p = (ReplayPlayer){ .record = record, .rng = record->seed };
+  rules_reset(g, level);
+}
+
+bool replay_player_next(ReplayPlayer *p, GameState *g, const Level *level) {
+  const ReplayRecord *r = p->record;
+  if(g->over || g->clear) return false;
+  if(!g->moving) {
+    if(p->rolls >= r->rolls) return false;
+    p->rolls++;
+    rules_roll(g, level, dice(&p->rng, rules_dice_max(rules_tile(g, level))));
+  } else {
+    if(p->steps >= r->steps) return false;
+    g->dir = (r->dirs[p->steps / 4] >> ((p->steps % 4) * 2)) & 3;
+    p->steps++;
+    rules_step(g, level);
+  }
+  return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <pebble.h>
+#include "rules.h"
+
+// ================================
+//  replay: ダイスの乱数と、1 ゲームぶんの記録（リプレイ）
+// ================================
+// ダイスはゲームごとのシードから xorshift32 で振る（rand() は使わない）。
+// 目はシードと「いつ振ったか」で決まるので、記録するのはシードと、1 歩ごとの
+// 向き（2 bit）だけでよい。振った回数も持つ（最後の 1 回で GAME OVER になることがある）。
+// 1 ゲームは最大 MAX_DECAY 回振って 1 回 4 歩までなので、1 件 32 バイトに収まる。
+//
+// 最近の REPLAY_SLOTS ゲームを persist のキー 1 つに持つ（新しい順。0 番が今のゲーム）。
+// save と同じく、フラッシュには replay_flush のときにまとめて書く。
+//
+//   replay_init();                                  // init() で 1 回
+//   replay_begin(REPLAY_PACK, index, 0, 0);         // rules_reset のたび
+//   rules_roll(&g, &level, replay_roll(max));       // ダイス
+//   replay_record_step(g.dir); rules_step(&g, &level);
+//   replay_finish(g.clear);                         // CLEAR / GAME OVER
+//   replay_flush();
+//
+// 再生は ReplayPlayer で 1 手ずつ（ルールは rules.c をそのまま使う）:
+//   replay_player_start(&p, replay_get(i), &g, &level);
+//   while(replay_player_next(&p, &g, &level)) { 描く }
+
+// persist のキー（1・2: save、3・4: 設定、5〜69: level_upload）
+#define REPLAY_KEY 70
+#define REPLAY_SLOTS 7
+#define REPLAY_MAX_STEPS (MAX_DECAY * 4 + 4)
+
+// 遊んだマップ
+typedef enum {
+  REPLAY_PACK,       // パックのレベル（level_index）
+  REPLAY_ENDLESS,    // map_gen で作ったマップ（map_seed と difficulty から作り直す）
+  REPLAY_UPLOADED,   // 電話から送られたマップ（今 persist にあるもの）
+} ReplaySource;
+
+typedef struct __attribute__((__packed__)) {
+  uint32_t seed;        // ダイスのシード
+  uint32_t rng;         // 今のダイスの状態（遊びかけを続けるとき）
+  uint32_t map_seed;    // REPLAY_ENDLESS のとき
+  uint8_t level_index;  // REPLAY_PACK のとき
+  uint8_t flags;        // 下位 2 bit: ReplaySource、次の 2 bit: 難しさ、REPLAY_FLAG_*
+  uint8_t rolls;        // 振った回数
+  uint8_t steps;        // 歩いた回数
+  uint8_t dirs[REPLAY_MAX_STEPS / 4];   // 1 歩 2 bit（rules の dir）
+} ReplayRecord;
+
+#define REPLAY_FLAG_CLEAR    (1 << 4)
+#define REPLAY_FLAG_OVER     (1 << 5)
+#define REPLAY_FLAG_TRUNCATED (1 << 6)   // 歩数が入りきらなかった（再生は途中まで）
+
+static inline ReplaySource replay_source(const ReplayRecord *r) {
+  return (ReplaySource)(r->flags & 3);
+}
+static inline int replay_difficulty(const ReplayRecord *r) {
+  return (r->flags >> 2) & 3;
+}
+
+void replay_init(void);
+// 新しいゲームを 0 番に始める（前のゲームは 1 つ後ろへ。何もしていなければ上書き）
+void replay_begin(ReplaySource source, int level_index, uint32_t map_seed, int difficulty);
+// 遊びかけを続ける：0 番が同じマップの終わっていないゲームなら true
+bool replay_resume(ReplaySource source, int level_index, uint32_t map_seed);
+// 今のゲームのダイスを振る（1..max。max が 1 のときは乱数を進めない）
+int replay_roll(int max);
+void replay_record_step(int dir);
+void replay_finish(bool clear);
+void replay_flush(void);
+
+int replay_count(void);
+const ReplayRecord *replay_get(int index);
+
+// ================================
+//  再生
+// ================================
+typedef struct {
+  const ReplayRecord *record;
+  uint32_t rng;
+  int rolls;
+  int steps;
+} ReplayPlayer;
+
+// g を START に戻して、記録の最初から
+void replay_player_start(ReplayPlayer *p, const ReplayRecord *record, GameState *g,
+                         const Level *level);
+// 1 手（振る / 1 歩）進める。記録が終わっていれば false
+bool replay_player_next(ReplayPlayer *p, GameState *g, const Level *level);
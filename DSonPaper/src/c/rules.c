@@ -0,0 +1,235 @@
+#include <string.h>
+#include "rules.h"
+
+// ================================
+//  定数・参照
+// ================================
+int rules_dice_max(TileType tile) {
+  switch(tile) {
+    case TILE_MOUNTAIN: return 2;
+    case TILE_RIVER: return 3;
+    case TILE_STRANDED: return 1;
+    default: return 4;
+  }
+}
+
+Rank rules_rank(int decay) {
+  if(decay <= 8) return RANK_EXCELLENT;
+  if(decay <= 11) return RANK_GOOD;
+  return RANK_SO_SO;
+}
+
+const char *rules_rank_text(Rank rank) {
+  switch(rank) {
+    case RANK_EXCELLENT: return "EXCELLENT!!";
+    case RANK_GOOD: return "GOOD!";
+    default: return "SO SO";
+  }
+}
+
+bool rules_in_level(const Level *level, int x, int y) {
+  return x >= 0 && x < level_cols(level) && y >= 0 && y < level_rows(level);
+}
+
+TileType rules_tile(const GameState *g, const Level *level) {
+  return level_tile(level, g->x, g->y);
+}
+
+void rules_cursor(const GameState *g, int *x, int *y) {
+  *x = g->x;
+  *y = g->y;
+  switch(g->dir) {
+    case 0: *y -= 1; break;
+    case 1: *x -= 1; break;
+    case 2: *y += 1; break;
+    case 3: *x += 1; break;
+  }
+}
+
+// ================================
+//  状態遷移
+// ================================
+void rules_reset(GameState *g, const Level *level) {
+  memset(g, 0, sizeof(*g));
+  g->x = level_start_x(level);
+  g->y = level_start_y(level);
+}
+
+uint8_t rules_dir_mask(const Level *level, int x, int y) {
+  return (y > 0 ? 1 << 0 : 0) | (x > 0 ? 1 << 1 : 0) |
+         (y < level_rows(level) - 1 ? 1 << 2 : 0) | (x < level_cols(level) - 1 ? 1 << 3 : 0);
+}
+
+// dir から delta ずつ回して、mask にある最初の方向（dir 自身は最後に見る）
+static int next_dir(uint8_t mask, int dir, int delta) {
+  for(int i = 1; i <= 4; i++) {
+    int d = (dir + delta * i + 8) % 4;
+    if(mask & (1 << d)) return d;
+  }
+  return dir;
+}
+
+// 今の向きがマップの外なら、delta ずつ回してマップの中を向く最初の方向にする
+static void face_inside(GameState *g, const Level *level, int delta) {
+  uint8_t mask = rules_dir_mask(level, g->x, g->y);
+  if(!(mask & (1 << g->dir))) g->dir = next_dir(mask, g->dir, delta);
+}
+
+void rules_roll(GameState *g, const Level *level, int roll) {
+  if(g->over || g->clear || g->moving) return;
+
+  g->decay++;
+  if(g->decay >= MAX_DECAY) g->over = true;
+
+  g->dice = roll;
+  g->dir = 0;
+  g->moving = true;
+  face_inside(g, level, 1);
+}
+
+void rules_step(GameState *g, const Level *level) {
+  if(g->over || g->clear || !g->moving) return;
+
+  int cx, cy;
+  rules_cursor(g, &cx, &cy);
+  if(!rules_in_level(level, cx, cy)) return;
+
+  TileType before = rules_tile(g, level);
+  TileType after = level_tile(level, cx, cy);
+
+  // CHECK は出るときに通過（立ち止まる必要なし）
+  if(before == TILE_CHECK) g->passed_check = true;
+
+  // 座礁地帯に入ったら劣化 +2
+  if(after == TILE_STRANDED && before != TILE_STRANDED) {
+    g->decay += 2;
+    if(g->decay >= MAX_DECAY) g->over = true;
+    if(g->decay > MAX_DECAY) g->decay = MAX_DECAY;
+  }
+
+  g->x = cx;
+  g->y = cy;
+
+  // 山・川・座礁地帯に別の地形から入ったら止まる
+  bool stop = (after == TILE_MOUNTAIN || after == TILE_RIVER || after == TILE_STRANDED) &&
+              before != after;
+
+  // ゴールは CHECK を通過していれば
+  if(after == TILE_GOAL && g->passed_check) {
+    g->clear = true;
+    g->moving = false;
+  }
+
+  if(stop) {
+    g->dice = 0;
+    g->moving = false;
+  } else {
+    g->dice--;
+    if(g->dice == 0) {
+      g->moving = false;
+    } else if(g->moving) {
+      face_inside(g, level, 1);
+    }
+  }
+}
+
+void rules_turn(GameState *g, const Level *level, int delta) {
+  if(!g->moving) return;
+  g->dir = next_dir(rules_dir_mask(level, g->x, g->y), g->dir, delta);
+}
+
+// ================================
+//  行き先の先読み
+// ================================
+#define REACH_ALL ((1u << RULES_REACH_SIZE) - 1)
+
+// 窓の地形（行ごとのビット列）
+typedef struct {
+  uint16_t inside[RULES_REACH_SIZE];
+  uint16_t stop[3][RULES_REACH_SIZE];   // 山・川・座礁（別の地形から入ると止まる）
+  uint16_t check[RULES_REACH_SIZE];
+  uint16_t goal[RULES_REACH_SIZE];
+} ReachTerrain;
+
+static void reach_terrain(const RulesReach *r, const Level *level, ReachTerrain *t) {
+  memset(t, 0, sizeof(*t));
+  for(int j = 0; j < RULES_REACH_SIZE; j++) {
+    int y = r->y0 + j;
+    for(int i = 0; i < RULES_REACH_SIZE; i++) {
+      int x = r->x0 + i;
+      if(!rules_in_level(level, x, y)) continue;
+      uint16_t bit = 1u << i;
+      t->inside[j] |= bit;
+      switch(level_tile(level, x, y)) {
+        case TILE_MOUNTAIN: t->stop[0][j] |= bit; break;
+        case TILE_RIVER: t->stop[1][j] |= bit; break;
+        case TILE_STRANDED: t->stop[2][j] |= bit; break;
+        case TILE_CHECK: t->check[j] |= bit; break;
+        case TILE_GOAL: t->goal[j] |= bit; break;
+        default: break;
+      }
+    }
+  }
+}
+
+// from のどれかから 1 歩で行ける窓の中のマス
+static void reach_spread(const uint16_t *from, const uint16_t *inside, uint16_t *out) {
+  for(int j = 0; j < RULES_REACH_SIZE; j++) {
+    uint16_t v = (from[j] << 1) | (from[j] >> 1);
+    if(j > 0) v |= from[j - 1];
+    if(j < RULES_REACH_SIZE - 1) v |= from[j + 1];
+    out[j] = v & inside[j] & REACH_ALL;
+  }
+}
+
+void rules_reach(const GameState *g, const Level *level, RulesReach *out) {
+  memset(out, 0, sizeof(*out));
+  out->x0 = g->x - RULES_MAX_ROLL;
+  out->y0 = g->y - RULES_MAX_ROLL;
+  if(!g->moving || g->over || g->clear || g->dice == 0) return;
+
+  ReachTerrain t;
+  reach_terrain(out, level, &t);
+
+  // CHECK を通ったかどうかで 2 つに分けて広げる（通ったあとの GOAL で終わる）
+  uint16_t front[2][RULES_REACH_SIZE] = { { 0 } };
+  front[g->passed_check][RULES_MAX_ROLL] = 1u << RULES_MAX_ROLL;
+
+  for(int step = 0; step < g->dice && step < RULES_MAX_ROLL; step++) {
+    uint16_t from[2][RULES_REACH_SIZE], next[2][RULES_REACH_SIZE] = { { 0 } };
+    // CHECK から出たら通過
+    for(int j = 0; j < RULES_REACH_SIZE; j++) {
+      from[0][j] = front[0][j] & ~t.check[j];
+      from[1][j] = front[1][j] | (front[0][j] & t.check[j]);
+    }
+
+    for(int p = 0; p < 2; p++) {
+      uint16_t any[RULES_REACH_SIZE], moved[RULES_REACH_SIZE];
+      reach_spread(from[p], t.inside, any);
+      for(int j = 0; j < RULES_REACH_SIZE; j++) {
+        uint16_t stops = t.stop[0][j] | t.stop[1][j] | t.stop[2][j];
+        next[p][j] = any[j] & ~stops;   // 止まらない地形へはそのまま
+      }
+      // 止まる地形：同じ地形からなら続けて、別の地形からなら止まる
+      for(int k = 0; k < 3; k++) {
+        uint16_t same[RULES_REACH_SIZE], other[RULES_REACH_SIZE];
+        for(int j = 0; j < RULES_REACH_SIZE; j++) {
+          same[j] = from[p][j] & t.stop[k][j];
+          other[j] = from[p][j] & ~t.stop[k][j];
+        }
+        reach_spread(same, t.inside, moved);
+        for(int j = 0; j < RULES_REACH_SIZE; j++) next[p][j] |= moved[j] & t.stop[k][j];
+        reach_spread(other, t.inside, moved);
+        for(int j = 0; j < RULES_REACH_SIZE; j++) out->rows[j] |= moved[j] & t.stop[k][j];
+      }
+    }
+    // CHECK を通ってからの GOAL はそこで終わる
+    for(int j = 0; j < RULES_REACH_SIZE; j++) {
+      out->rows[j] |= next[1][j] & t.goal[j];
+      next[1][j] &= ~t.goal[j];
+    }
+    memcpy(front, next, sizeof(front));
+  }
+  // 目を使い切ったところ
+  for(int j = 0; j < RULES_REACH_SIZE; j++) out->rows[j] |= front[0][j] | front[1][j];
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "level.h"
+
+// ================================
+//  rules: ゲームのルール（画面・ボタン・乱数から切り離した状態遷移）
+// ================================
+// ウォッチでは click handler がこれを呼んで描き直すだけ。
+// SDK に依存しないので、ホストのバランス確認（tools/balance.c）も同じものを使う。
+// ダイスの目は呼ぶ側が振って渡す（rules_dice_max の範囲で一様）。
+//
+//   rules_reset(&g, &level);
+//   rules_roll(&g, &level, replay_roll(rules_dice_max(rules_tile(&g, &level))));
+//   rules_turn(&g, &level, +1);   // UP / DOWN
+//   rules_step(&g, &level);       // 移動中の SELECT
+
+// 荷物の劣化がこれに達したら GAME OVER
+#define MAX_DECAY 15
+
+// 1 回の移動で行ける範囲（ダイスの最大の目）。rules_reach の窓はこの半径
+#define RULES_MAX_ROLL 4
+#define RULES_REACH_SIZE (RULES_MAX_ROLL * 2 + 1)
+
+typedef struct {
+  int8_t x, y;
+  int8_t dir;          // 0=上, 1=左, 2=下, 3=右
+  uint8_t decay;       // 0〜MAX_DECAY
+  uint8_t dice;        // 残りの目
+  bool moving;         // true=移動待ち（目が残っている）
+  bool passed_check;
+  bool clear;
+  bool over;
+} GameState;
+
+typedef enum {
+  RANK_SO_SO,
+  RANK_GOOD,
+  RANK_EXCELLENT,
+  RANK_COUNT
+} Rank;
+
+// 地形ごとのダイスの最大の目（山 2、川 3、座礁 1、それ以外 4）
+int rules_dice_max(TileType tile);
+Rank rules_rank(int decay);
+const char *rules_rank_text(Rank rank);
+
+bool rules_in_level(const Level *level, int x, int y);
+TileType rules_tile(const GameState *g, const Level *level);
+void rules_cursor(const GameState *g, int *x, int *y);
+
+// (x, y) からマップの中を向く方向（bit d が dir d）。マップは長方形なので端かどうかで決まる
+uint8_t rules_dir_mask(const Level *level, int x, int y);
+
+void rules_reset(GameState *g, const Level *level);
+// 止まっているとき：劣化 +1 して roll 歩の移動を始める
+void rules_roll(GameState *g, const Level *level, int roll);
+// 移動中：カーソルの向きに 1 歩
+void rules_step(GameState *g, const Level *level);
+// 移動中：delta（+1 / -1）ずつ回して、マップの中を向く方向にする
+void rules_turn(GameState *g, const Level *level, int delta);
+
+// ================================
+//  行き先の先読み
+// ================================
+// 移動中の g から、残りの目（g->dice）で移動が終わりうるマスをすべて求める。
+// 1 歩ごとにどの向きも選べるとして、止まる地形・座礁地帯・CHECK を通ってからの GOAL を
+// rules_step と同じに扱う（目を使い切る前に止まるマスも入る）。
+// 行けるのはプレイヤーを中心にした RULES_REACH_SIZE 四方だけなので、その窓の
+// 地形を 1 行 1 語のビット列にして、4 方向へのシフトで 1 歩ずつ広げる（ヒープなし）。
+typedef struct {
+  int16_t x0, y0;                       // 窓の左上（マップの座標）
+  uint16_t rows[RULES_REACH_SIZE];      // bit i が (x0 + i, y0 + 行)
+} RulesReach;
+
+// 移動中でなければ空
+void rules_reach(const GameState *g, const Level *level, RulesReach *out);
+
+static inline bool rules_reach_has(const RulesReach *r, int x, int y) {
+  int i = x - r->x0, j = y - r->y0;
+  return i >= 0 && i < RULES_REACH_SIZE && j >= 0 && j < RULES_REACH_SIZE &&
+         (r->rows[j] >> i & 1);
+}
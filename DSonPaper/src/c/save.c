@@ -0,0 +1,153 @@
+#include "save.h"
+
+// ================================
+//  定義
+// ================================
+#define SAVE_VERSION 2  // 2: マップをチャンク順で持つ
+
+// フラッシュ上の形。マップは endless のときだけ後ろに付ける
+typedef struct __attribute__((__packed__)) {
+  uint8_t version;
+  uint8_t flags;
+  uint8_t level_index;
+  uint16_t endless_count;
+  uint32_t endless_seed;
+  int8_t x, y, dir;
+  uint8_t decay;
+  uint8_t dice;
+  uint8_t level[LEVEL_MAX_BYTES];
+} SaveBlob;
+
+#define FLAG_ENDLESS      (1 << 0)
+#define FLAG_MOVING       (1 << 1)
+#define FLAG_PASSED_CHECK (1 << 2)
+#define FLAG_CLEAR        (1 << 3)
+#define FLAG_OVER         (1 << 4)
+
+#define BLOB_HEADER_SIZE (sizeof(SaveBlob) - LEVEL_MAX_BYTES)
+
+// ベスト：レベルごとに 劣化+1（0 はまだクリアしていない）
+typedef struct {
+  uint8_t version;
+  uint8_t decay_plus_one[SAVE_BEST_LEVELS];
+} BestTable;
+
+// ================================
+//  状態管理
+// ================================
+// 書く予定の内容と、最後にフラッシュにあった内容
+static SaveBlob s_blob;
+static int s_blob_size;
+static SaveBlob s_written;
+static int s_written_size;
+
+// ベストは使うときに読む（起動を遅くしない）
+static BestTable s_best;
+static bool s_best_loaded;
+static bool s_best_dirty;
+
+// ----------------------------------------------------------
+// 遊びかけのゲーム
+// ----------------------------------------------------------
+static int blob_size(const SaveBlob *blob) {
+  return BLOB_HEADER_SIZE + ((blob->flags & FLAG_ENDLESS) ? LEVEL_MAX_BYTES : 0);
+}
+
+bool save_load(SaveState *out) {
+  int size = persist_read_data(SAVE_GAME_KEY, &s_written, sizeof(s_written));
+  if(size < (int)BLOB_HEADER_SIZE || s_written.version != SAVE_VERSION ||
+     size != blob_size(&s_written)) {
+    s_written_size = 0;
+    return false;
+  }
+  s_written_size = size;
+  s_blob = s_written;
+  s_blob_size = size;
+
+  memset(out, 0, sizeof(*out));
+  const SaveBlob *b = &s_written;
+  out->endless = b->flags & FLAG_ENDLESS;
+  out->level_index = b->level_index;
+  out->endless_count = b->endless_count;
+  out->endless_seed = b->endless_seed;
+  out->game = (GameState){
+    .x = b->x,
+    .y = b->y,
+    .dir = b->dir,
+    .decay = b->decay,
+    .dice = b->dice,
+    .moving = b->flags & FLAG_MOVING,
+    .passed_check = b->flags & FLAG_PASSED_CHECK,
+    .clear = b->flags & FLAG_CLEAR,
+    .over = b->flags & FLAG_OVER,
+  };
+  if(out->endless) {
+    memcpy(out->level.data, b->level, LEVEL_MAX_BYTES);
+    if(!level_validate(&out->level, LEVEL_MAX_BYTES)) return false;
+  }
+  return true;
+}
+
+void save_store(const SaveState *state) {
+  const GameState *g = &state->game;
+  memset(&s_blob, 0, sizeof(s_blob));
+  s_blob.version = SAVE_VERSION;
+  s_blob.flags = (state->endless ? FLAG_ENDLESS : 0) | (g->moving ? FLAG_MOVING : 0) |
+                 (g->passed_check ? FLAG_PASSED_CHECK : 0) | (g->clear ? FLAG_CLEAR : 0) |
+                 (g->over ? FLAG_OVER : 0);
+  s_blob.level_index = state->level_index;
+  s_blob.endless_count = state->endless_count;
+  s_blob.endless_seed = state->endless_seed;
+  s_blob.x = g->x;
+  s_blob.y = g->y;
+  s_blob.dir = g->dir;
+  s_blob.decay = g->decay;
+  s_blob.dice = g->dice;
+  if(state->endless) memcpy(s_blob.level, state->level.data, LEVEL_MAX_BYTES);
+  s_blob_size = blob_size(&s_blob);
+}
+
+// ----------------------------------------------------------
+// ベスト
+// ----------------------------------------------------------
+static void best_load(void) {
+  if(s_best_loaded) return;
+  s_best_loaded = true;
+  if(persist_read_data(SAVE_BEST_KEY, &s_best, sizeof(s_best)) != sizeof(s_best) ||
+     s_best.version != SAVE_VERSION) {
+    memset(&s_best, 0, sizeof(s_best));
+    s_best.version = SAVE_VERSION;
+  }
+}
+
+void save_record_clear(int level_index, int decay) {
+  if(level_index < 0 || level_index >= SAVE_BEST_LEVELS) return;
+  best_load();
+  uint8_t *best = &s_best.decay_plus_one[level_index];
+  if(*best == 0 || decay + 1 < *best) {
+    *best = decay + 1;
+    s_best_dirty = true;
+  }
+}
+
+int save_best_decay(int level_index) {
+  if(level_index < 0 || level_index >= SAVE_BEST_LEVELS) return -1;
+  best_load();
+  return s_best.decay_plus_one[level_index] - 1;
+}
+
+// ================================
+//  書き込み
+// ================================
+void save_flush(void) {
+  if(s_blob_size && (s_blob_size != s_written_size ||
+                     memcmp(&s_blob, &s_written, s_blob_size) != 0)) {
+    persist_write_data(SAVE_GAME_KEY, &s_blob, s_blob_size);
+    s_written = s_blob;
+    s_written_size = s_blob_size;
+  }
+  if(s_best_dirty) {
+    persist_write_data(SAVE_BEST_KEY, &s_best, sizeof(s_best));
+    s_best_dirty = false;
+  }
+}
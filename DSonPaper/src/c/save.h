@@ -0,0 +1,35 @@
+#pragma once
+#include <pebble.h>
+#include "rules.h"
+
+// ================================
+//  save: 遊びかけのゲームとレベルごとのベストの保存
+// ================================
+// save_store / save_record_clear はメモリ上で覚えるだけで、フラッシュには
+// save_flush のときにまとめて書く（前に書いた内容と同じなら書かない）。
+// save_flush はウィンドウを閉じるときとフォーカスを失うときに呼ぶ。
+//
+//   if(save_load(&state)) { ... }         // init() で 1 回
+//   save_store(&state);                   // 保存したい時点の状態
+//   save_record_clear(level, decay);      // パックのレベルをクリアしたとき
+//   save_flush();
+
+#define SAVE_GAME_KEY 1
+#define SAVE_BEST_KEY 2
+#define SAVE_BEST_LEVELS 32   // ベストを覚えるのはパックの先頭からこの数まで
+
+typedef struct {
+  GameState game;
+  bool endless;
+  uint8_t level_index;     // パックのレベル（endless でないとき）
+  uint16_t endless_count;
+  uint32_t endless_seed;   // 次に作るマップのシード
+  Level level;             // endless のときの今のマップ
+} SaveState;
+
+bool save_load(SaveState *out);
+void save_store(const SaveState *state);
+void save_record_clear(int level_index, int decay);
+// そのレベルの一番少ない劣化でのクリア。なければ -1
+int save_best_decay(int level_index);
+void save_flush(void);
@@ -1,5 +1,14 @@
-Pebble.addEventListener("ready",
-    function(e) {
-        console.log("Hello world! - Sent from your javascript application.");
-    }
-);
+// 設定画面とウォッチへの同期（アプリ間で共有。wscript が一緒に同梱する）
+var settings = require('../../../common/pkjs/settings_sync');
+// マップの送信（src/pkjs/level_upload.js）
+var upload = require('./level_upload');
+
+// fallback は src/c/DSonPaper.c の SETTINGS と同じ値
+settings.init('DSonPaper', [
+  { key: 'difficulty', label: 'Endless difficulty (0 easy, 1 normal, 2 hard)', min: 0, max: 2,
+    fallback: 1 },
+  { key: 'hint', label: 'Hints', type: 'toggle', fallback: 0 },
+  { key: 'level_text', label: 'Map to play (levels/*.txt format)', type: 'text' }
+], function(result) {
+  if (result.level_text && result.level_text.trim()) upload.send(result.level_text);
+});
@@ -0,0 +1,162 @@
+// ================================
+//  level_upload: マップをウォッチへ送る
+// ================================
+// ウォッチ側は src/c/level_upload.h（形式と返事の意味はそちら）。
+// テキストは levels/*.txt と同じ書き方。パック形式（src/c/level.h）にして RLE で縮め、
+// CHUNK バイトずつ送る。次の 1 通は前の 1 通の ACK が返ってから送り、
+// 届かなければ間を空けて同じ 1 通を送り直す。
+// ウォッチが抜けに気づいたら（RESEND）、返ってきた位置から送り直す。
+//
+//   var upload = require('./level_upload');
+//   upload.send(text);
+//
+// tools/level_upload.py は同じ手順でホストの --inbox 引数を作る。
+
+var CHUNK = 120;          // src/c/level_upload.h の LEVEL_UPLOAD_CHUNK
+var MAX_RETRIES = 3;      // 同じ 1 通を送り直す回数（NACK・タイムアウト）
+var RETRY_MS = 1000;
+var MAX_RESENDS = 3;      // ウォッチから RESEND が来たときにやり直す回数
+
+var STATUS_DONE = 0;
+var STATUS_RESEND = 1;
+var STATUS_STORAGE = 4;
+
+var TILE_CODES = { '.': 0, '^': 1, '~': 2, '#': 3, 'S': 4, 'C': 5, 'G': 6 };
+var CHUNK_SIZE = 8;
+var MAX_SIZE = 255;
+
+// ------------------------------
+// パック形式（tools/level_pack.py の pack_level と同じ）
+// ------------------------------
+function pack(text) {
+  var rows = text.split(/\r?\n/).filter(function(line) {
+    return line.trim() && line.charAt(0) !== ';';
+  });
+  if (!rows.length || rows.length > MAX_SIZE) throw new Error('1..255 rows');
+  var cols = rows[0].length;
+  if (cols < 1 || cols > MAX_SIZE) throw new Error('1..255 columns');
+
+  var marks = {};
+  var tiles = [];
+  rows.forEach(function(row, y) {
+    if (row.length !== cols) throw new Error('row ' + (y + 1) + ': width differs');
+    for (var x = 0; x < cols; x++) {
+      var ch = row.charAt(x);
+      if (!(ch in TILE_CODES)) throw new Error('row ' + (y + 1) + ': unknown tile ' + ch);
+      if ('SCG'.indexOf(ch) >= 0) {
+        if (ch in marks) throw new Error('more than one ' + ch);
+        marks[ch] = [x, y];
+      }
+      tiles.push(TILE_CODES[ch]);
+    }
+  });
+  'SCG'.split('').forEach(function(ch) {
+    if (!(ch in marks)) throw new Error('missing ' + ch);
+  });
+
+  var out = [cols, rows.length].concat(marks.S, marks.C, marks.G);
+  var chunked = [];
+  for (var cy = 0; cy < rows.length; cy += CHUNK_SIZE) {
+    for (var cx = 0; cx < cols; cx += CHUNK_SIZE) {
+      for (var y = cy; y < cy + CHUNK_SIZE; y++) {
+        for (var x = cx; x < cx + CHUNK_SIZE; x++) {
+          chunked.push(x < cols && y < rows.length ? tiles[y * cols + x] : 0);
+        }
+      }
+    }
+  }
+  for (var i = 0; i < chunked.length; i += 2) out.push((chunked[i] << 4) | chunked[i + 1]);
+  return out;
+}
+
+// ------------------------------
+// RLE（3 バイト以上続く値はまとめ、残りはそのまま最大 128 バイトずつ）
+// ------------------------------
+function rle(data) {
+  var out = [];
+  var i = 0;
+  while (i < data.length) {
+    var run = 1;
+    while (i + run < data.length && data[i + run] === data[i] && run < 130) run++;
+    if (run >= 3) {
+      out.push(0x80 + run - 3, data[i]);
+      i += run;
+      continue;
+    }
+    var start = i;
+    while (i < data.length && i - start < 128 &&
+           !(i + 2 < data.length && data[i] === data[i + 1] && data[i] === data[i + 2])) {
+      i++;
+    }
+    out.push(i - start - 1);
+    out.push.apply(out, data.slice(start, i));
+  }
+  return out;
+}
+
+// ------------------------------
+// 送信
+// ------------------------------
+var s_transfer = null;
+
+function finish(message) {
+  console.log('level_upload: ' + message);
+  s_transfer = null;
+}
+
+function sendNext(transfer) {
+  if (transfer !== s_transfer || transfer.inFlight) return;
+  if (transfer.offset >= transfer.data.length) return;   // 返事（DONE）を待つ
+
+  var offset = transfer.offset;
+  var part = transfer.data.slice(offset, offset + CHUNK);
+  var message = { level_offset: offset, level_data: part };
+  if (offset === 0) message.level_size = transfer.data.length;
+
+  transfer.inFlight = true;
+  Pebble.sendAppMessage(message, function() {
+    transfer.inFlight = false;
+    transfer.retries = 0;
+    // RESEND で位置が戻っていたら、そちらを優先する
+    if (transfer.offset === offset) transfer.offset = offset + part.length;
+    sendNext(transfer);
+  }, function() {
+    transfer.inFlight = false;
+    if (++transfer.retries > MAX_RETRIES) {
+      finish('gave up at ' + offset + '/' + transfer.data.length);
+      return;
+    }
+    setTimeout(function() { sendNext(transfer); }, RETRY_MS * transfer.retries);
+  });
+}
+
+Pebble.addEventListener('appmessage', function(e) {
+  var transfer = s_transfer;
+  if (!transfer || !('level_status' in e.payload)) return;
+  var status = e.payload.level_status;
+  if (status === STATUS_DONE) {
+    finish('sent ' + transfer.data.length + ' bytes in ' +
+           Math.ceil(transfer.data.length / CHUNK) + ' messages');
+  } else if (status === STATUS_RESEND && ++transfer.resends <= MAX_RESENDS) {
+    transfer.offset = e.payload.level_offset | 0;
+    sendNext(transfer);
+  } else if (status === STATUS_STORAGE) {
+    finish('watch storage is full (the previous map is kept)');
+  } else {
+    finish('rejected by the watch (status ' + status + ')');
+  }
+});
+
+exports.send = function(text) {
+  var data;
+  try {
+    data = rle(pack(text));
+  } catch (err) {
+    console.log('level_upload: ' + err.message);
+    return false;
+  }
+  // 前の送信は捨てる（ウォッチは offset 0 と level_size で最初からやり直す）
+  s_transfer = { data: data, offset: 0, inFlight: false, retries: 0, resends: 0 };
+  sendNext(s_transfer);
+  return true;
+};
@@ -0,0 +1,359 @@
+// ================================
+//  DSonPaper バランス確認
+// ================================
+// src/c/rules.c をそのまま使って、レベルパックの各レベルを
+// 戦略ごとに大量に遊ばせ、クリア率・最後の劣化・ランクの分布を出す。
+// 全コアで回す（スレッドごとに乱数と集計を持ち、最後に足す）。
+//
+//   make -C host balance                     （パックと表を作ってから流す）
+//   （rules.c と level.c だけをリンクする。どちらも SDK に依存しない）
+//   dsonpaper_balance [--games N] [--threads N] [--strategy NAME] [--level K]
+//                     [--seed S] levels.bin [policy.bin]
+//
+// 戦略は STRATEGIES[] に足せば選べるようになる。
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rules.h"
+
+#define MAX_LEVELS 255
+#define MAX_THREADS 64
+#define MAX_DICE 4
+
+// ------------------------------
+// 乱数（xorshift64*。スレッドごとに持つ）
+// ------------------------------
+typedef struct {
+  uint64_t s;
+} Rng;
+
+static uint32_t rng_next(Rng *r) {
+  r->s ^= r->s >> 12;
+  r->s ^= r->s << 25;
+  r->s ^= r->s >> 27;
+  return (uint32_t)((r->s * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static int rng_below(Rng *r, int n) {
+  return (int)(((uint64_t)rng_next(r) * (uint32_t)n) >> 32);
+}
+
+// ------------------------------
+// レベルと戦略
+// ------------------------------
+typedef struct {
+  Level level;
+  int index;
+  const uint8_t *policy;     // policy.bin のこのレベルの表（なければ NULL）
+  uint16_t *to_check;        // CHECK / GOAL までの歩数（地形は見ない。cols*rows 個）
+  uint16_t *to_goal;
+} Board;
+
+// 移動中に向く方向（マップの中を向くこと）
+typedef int (*StrategyFn)(const Board *board, const GameState *g, Rng *rng);
+
+typedef struct {
+  const char *name;
+  StrategyFn choose;
+  bool needs_policy;
+} Strategy;
+
+static bool dir_valid(const Board *board, const GameState *g, int dir) {
+  return rules_dir_mask(&board->level, g->x, g->y) & (1 << dir);
+}
+
+static int choose_random(const Board *board, const GameState *g, Rng *rng) {
+  int dirs[4], n = 0;
+  for(int d = 0; d < 4; d++) {
+    if(dir_valid(board, g, d)) dirs[n++] = d;
+  }
+  return dirs[rng_below(rng, n)];
+}
+
+// CHECK（通過後は GOAL）に一番近づく方向。同じなら乱数
+static int choose_greedy(const Board *board, const GameState *g, Rng *rng) {
+  const uint16_t *dist = g->passed_check ? board->to_goal : board->to_check;
+  int cols = level_cols(&board->level);
+  int best = -1, best_dist = 0, ties = 0;
+  for(int d = 0; d < 4; d++) {
+    if(!dir_valid(board, g, d)) continue;
+    GameState probe = *g;
+    probe.dir = d;
+    int x, y;
+    rules_cursor(&probe, &x, &y);
+    int nd = dist[y * cols + x];
+    if(best < 0 || nd < best_dist) {
+      best = d;
+      best_dist = nd;
+      ties = 1;
+    } else if(nd == best_dist && rng_below(rng, ++ties) == 0) {
+      best = d;
+    }
+  }
+  return best;
+}
+
+// tools/policy_gen.py の表（src/c/policy.c と同じ引き方）
+static int choose_policy(const Board *board, const GameState *g, Rng *rng) {
+  int cols = level_cols(&board->level);
+  int cells = cols * level_rows(&board->level);
+  int decay = g->decay < MAX_DECAY ? g->decay : MAX_DECAY - 1;
+  uint32_t index = ((uint32_t)((g->passed_check ? MAX_DECAY : 0) + decay) * MAX_DICE +
+                    (g->dice - 1)) * cells + g->y * cols + g->x;
+  int dir = (board->policy[index / 4] >> ((index & 3) * 2)) & 3;
+  return dir_valid(board, g, dir) ? dir : choose_random(board, g, rng);
+}
+
+static const Strategy STRATEGIES[] = {
+  { "random", choose_random, false },
+  { "greedy", choose_greedy, false },
+  { "policy", choose_policy, true },
+};
+#define STRATEGY_COUNT ((int)(sizeof(STRATEGIES) / sizeof(STRATEGIES[0])))
+
+// 幅優先で target からの歩数
+static uint16_t *distance_map(const Level *level, int tx, int ty) {
+  int cols = level_cols(level);
+  int cells = cols * level_rows(level);
+  uint16_t *dist = malloc(cells * sizeof(*dist));
+  int *queue = malloc(cells * sizeof(*queue)), head = 0, tail = 0;
+  memset(dist, 0xff, cells * sizeof(*dist));
+  dist[ty * cols + tx] = 0;
+  queue[tail++] = ty * cols + tx;
+  while(head < tail) {
+    int i = queue[head++];
+    int x = i % cols, y = i / cols;
+    static const int DX[] = { 0, -1, 0, 1 }, DY[] = { -1, 0, 1, 0 };
+    for(int d = 0; d < 4; d++) {
+      int nx = x + DX[d], ny = y + DY[d];
+      if(!rules_in_level(level, nx, ny) || dist[ny * cols + nx] != 0xffff) continue;
+      dist[ny * cols + nx] = dist[i] + 1;
+      queue[tail++] = ny * cols + nx;
+    }
+  }
+  free(queue);
+  return dist;
+}
+
+// ------------------------------
+// 集計
+// ------------------------------
+typedef struct {
+  uint64_t games;
+  uint64_t clears;
+  uint64_t rolls;
+  uint64_t decay[MAX_DECAY + 1];   // 最後の劣化（全ゲーム）
+  uint64_t rank[RANK_COUNT];       // クリアしたときのランク
+} Stats;
+
+static void play_one(const Board *board, const Strategy *strategy, Rng *rng, Stats *stats) {
+  const Level *level = &board->level;
+  GameState g;
+  rules_reset(&g, level);
+
+  // 振るたびに劣化が 1 増えるので、MAX_DECAY 回で必ず終わる
+  while(!g.over && !g.clear) {
+    if(!g.moving) {
+      rules_roll(&g, level, 1 + rng_below(rng, rules_dice_max(rules_tile(&g, level))));
+      stats->rolls++;
+    } else {
+      g.dir = strategy->choose(board, &g, rng);
+      rules_step(&g, level);
+    }
+  }
+
+  stats->games++;
+  stats->decay[g.decay]++;
+  if(g.clear && !g.over) {
+    stats->clears++;
+    stats->rank[rules_rank(g.decay)]++;
+  }
+}
+
+typedef struct {
+  const Board *board;
+  const Strategy *strategy;
+  uint64_t games;
+  uint64_t seed;
+  Stats stats;
+} Job;
+
+static void *run_job(void *arg) {
+  Job *job = arg;
+  Rng rng = { job->seed | 1 };
+  for(uint64_t i = 0; i < job->games; i++) {
+    play_one(job->board, job->strategy, &rng, &job->stats);
+  }
+  return NULL;
+}
+
+static Stats run_parallel(const Board *board, const Strategy *strategy, uint64_t games,
+                          int threads, uint64_t seed) {
+  Job jobs[MAX_THREADS];
+  pthread_t tids[MAX_THREADS];
+  for(int t = 0; t < threads; t++) {
+    jobs[t] = (Job){
+      .board = board,
+      .strategy = strategy,
+      .games = games / threads + (t < (int)(games % threads) ? 1 : 0),
+      .seed = seed ^ ((uint64_t)(t + 1) * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)board->index << 48),
+    };
+    pthread_create(&tids[t], NULL, run_job, &jobs[t]);
+  }
+
+  Stats total = { 0 };
+  for(int t = 0; t < threads; t++) {
+    pthread_join(tids[t], NULL);
+    const Stats *s = &jobs[t].stats;
+    total.games += s->games;
+    total.clears += s->clears;
+    total.rolls += s->rolls;
+    for(int i = 0; i <= MAX_DECAY; i++) total.decay[i] += s->decay[i];
+    for(int i = 0; i < RANK_COUNT; i++) total.rank[i] += s->rank[i];
+  }
+  return total;
+}
+
+static void report(const Board *board, const Strategy *strategy, const Stats *s) {
+  double n = s->games ? (double)s->games : 1;
+  printf("level %d (%dx%d)  %-7s games %llu  clear %6.2f%%  rolls %.2f\n",
+         board->index + 1, level_cols(&board->level), level_rows(&board->level), strategy->name,
+         (unsigned long long)s->games, 100.0 * s->clears / n, s->rolls / n);
+  printf("  rank  %s %5.1f%%  %s %5.1f%%  %s %5.1f%%  (of all games)\n",
+         rules_rank_text(RANK_EXCELLENT), 100.0 * s->rank[RANK_EXCELLENT] / n,
+         rules_rank_text(RANK_GOOD), 100.0 * s->rank[RANK_GOOD] / n,
+         rules_rank_text(RANK_SO_SO), 100.0 * s->rank[RANK_SO_SO] / n);
+  printf("  decay");
+  for(int i = 0; i <= MAX_DECAY; i++) printf(" %d:%.1f", i, 100.0 * s->decay[i] / n);
+  printf("\n");
+}
+
+// ------------------------------
+// 読み込み
+// ------------------------------
+static uint8_t *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if(!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  *size = (size_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = malloc(*size ? *size : 1);
+  if(fread(data, 1, *size, f) != *size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  return data;
+}
+
+// レベルパック（src/c/level.h）を Board に展開する。
+// 大きいマップはタイルをパックのデータから直接引く（キャッシュを共有しないのでスレッドから安全）。
+// そのためパックのデータは最後まで持ったまま
+static int load_pack(const char *path, Board *boards) {
+  size_t size;
+  uint8_t *data = read_file(path, &size);
+  if(!data || size < LEVEL_PACK_HEADER_SIZE || memcmp(data, LEVEL_PACK_MAGIC, 4) != 0 ||
+     data[4] != LEVEL_PACK_VERSION) {
+    fprintf(stderr, "%s: not a level pack\n", path);
+    free(data);
+    return 0;
+  }
+  int count = data[5];
+  for(int i = 0; i < count; i++) {
+    const uint8_t *le = data + LEVEL_PACK_HEADER_SIZE + i * 4;
+    size_t offset = le[0] | (le[1] << 8) | (le[2] << 16) | ((uint32_t)le[3] << 24);
+    Board *b = &boards[i];
+    memset(b, 0, sizeof(*b));
+    b->index = i;
+    size_t len = offset < size ? size - offset : 0;
+    if(len > LEVEL_MAX_BYTES) len = LEVEL_MAX_BYTES;
+    memcpy(b->level.data, data + offset, len);
+    if(len >= LEVEL_HEADER_SIZE && !level_resident(&b->level)) {
+      if(size - offset < LEVEL_HEADER_SIZE + LEVEL_TILE_BYTES(level_cols(&b->level),
+                                                             level_rows(&b->level))) {
+        len = 0;
+      }
+      b->level.tiles = data + offset + LEVEL_HEADER_SIZE;
+    }
+    if(!level_validate(&b->level, (int)len)) {
+      fprintf(stderr, "%s: level %d is broken\n", path, i + 1);
+      free(data);
+      return 0;
+    }
+    b->to_check = distance_map(&b->level, level_check_x(&b->level), level_check_y(&b->level));
+    b->to_goal = distance_map(&b->level, level_goal_x(&b->level), level_goal_y(&b->level));
+  }
+  return count;
+}
+
+// policy.bin（src/c/policy.h）。データは最後まで持ったまま
+static void attach_policy(const char *path, Board *boards, int count) {
+  size_t size;
+  uint8_t *data = read_file(path, &size);
+  if(!data || size < 6 || memcmp(data, "DSPT", 4) != 0 || data[5] != count) {
+    fprintf(stderr, "%s: no policy table for this pack\n", path);
+    free(data);
+    return;
+  }
+  for(int i = 0; i < count; i++) {
+    // 0 は表なし（大きすぎるマップ）
+    const uint8_t *le = data + 6 + i * 4;
+    uint32_t offset = le[0] | (le[1] << 8) | (le[2] << 16) | ((uint32_t)le[3] << 24);
+    boards[i].policy = offset ? data + offset : NULL;
+  }
+}
+
+int main(int argc, char **argv) {
+  uint64_t games = 1000000;
+  int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  const char *strategy_name = NULL;
+  int only_level = 0;
+  uint64_t seed = 1;
+
+  static const struct option OPTIONS[] = {
+    { "games", required_argument, NULL, 'g' },
+    { "threads", required_argument, NULL, 't' },
+    { "strategy", required_argument, NULL, 's' },
+    { "level", required_argument, NULL, 'l' },
+    { "seed", required_argument, NULL, 'r' },
+    { NULL, 0, NULL, 0 },
+  };
+  int opt;
+  while((opt = getopt_long(argc, argv, "", OPTIONS, NULL)) != -1) {
+    switch(opt) {
+      case 'g': games = strtoull(optarg, NULL, 10); break;
+      case 't': threads = atoi(optarg); break;
+      case 's': strategy_name = optarg; break;
+      case 'l': only_level = atoi(optarg); break;
+      case 'r': seed = strtoull(optarg, NULL, 10); break;
+      default: return 2;
+    }
+  }
+  if(optind >= argc) {
+    fprintf(stderr, "usage: %s [--games N] [--threads N] [--strategy NAME] [--level K] "
+                    "[--seed S] levels.bin [policy.bin]\n", argv[0]);
+    return 2;
+  }
+  if(threads < 1) threads = 1;
+  if(threads > MAX_THREADS) threads = MAX_THREADS;
+
+  static Board boards[MAX_LEVELS];
+  int count = load_pack(argv[optind], boards);
+  if(!count) return 1;
+  if(optind + 1 < argc) attach_policy(argv[optind + 1], boards, count);
+
+  for(int i = 0; i < count; i++) {
+    if(only_level && only_level != i + 1) continue;
+    for(int k = 0; k < STRATEGY_COUNT; k++) {
+      const Strategy *strategy = &STRATEGIES[k];
+      if(strategy_name && strcmp(strategy_name, strategy->name) != 0) continue;
+      if(strategy->needs_policy && !boards[i].policy) continue;
+      Stats stats = run_parallel(&boards[i], strategy, games, threads, seed);
+      report(&boards[i], strategy, &stats);
+    }
+  }
+  return 0;
+}
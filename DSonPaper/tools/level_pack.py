@@ -0,0 +1,111 @@
+#
+# DSonPaper のマップ（levels/*.txt）を 1 つのレベルパックにまとめる。
+# 形式は src/c/level.h を参照。
+#
+# wscript の build() から呼ばれる。単体でも
+#   python tools/level_pack.py levels resources/data/levels.bin
+# で実行できる。
+#
+# マップのテキスト:
+#   . 平地  ^ 山  ~ 川  # 座礁地帯  S START  C CHECK  G GOAL
+#   ; で始まる行はコメント
+#
+import os
+import struct
+import sys
+
+TILE_CODES = {
+    '.': 0,  # TILE_EMPTY
+    '^': 1,  # TILE_MOUNTAIN
+    '~': 2,  # TILE_RIVER
+    '#': 3,  # TILE_STRANDED
+    'S': 4,  # TILE_START
+    'C': 5,  # TILE_CHECK
+    'G': 6,  # TILE_GOAL
+}
+
+MAX_SIZE = 255
+CHUNK = 8
+MAGIC = b'DSLP'
+VERSION = 2
+
+
+def parse_level(path):
+    with open(path, encoding='utf-8') as f:
+        rows = [line.rstrip('\n') for line in f
+                if line.strip() and not line.startswith(';')]
+
+    if not rows or len(rows) > MAX_SIZE:
+        raise ValueError('{}: {} rows (1..{})'.format(path, len(rows), MAX_SIZE))
+    cols = len(rows[0])
+    if cols < 1 or cols > MAX_SIZE or any(len(r) != cols for r in rows):
+        raise ValueError('{}: every row must have the same width (1..{})'.format(path, MAX_SIZE))
+
+    tiles = []
+    marks = {}
+    for y, row in enumerate(rows):
+        for x, ch in enumerate(row):
+            if ch not in TILE_CODES:
+                raise ValueError('{}:{}:{}: unknown tile {!r}'.format(path, y + 1, x + 1, ch))
+            if ch in 'SCG':
+                if ch in marks:
+                    raise ValueError('{}: more than one {!r}'.format(path, ch))
+                marks[ch] = (x, y)
+            tiles.append(TILE_CODES[ch])
+
+    for ch in 'SCG':
+        if ch not in marks:
+            raise ValueError('{}: missing {!r}'.format(path, ch))
+    return cols, len(rows), marks, tiles
+
+
+def pack_level(cols, rows, marks, tiles):
+    """tiles は行の順。8x8 のチャンクごとに並べ替えて詰める（はみ出しは 0）。"""
+    header = bytes([cols, rows, *marks['S'], *marks['C'], *marks['G']])
+    chunked = []
+    for cy in range(0, rows, CHUNK):
+        for cx in range(0, cols, CHUNK):
+            for y in range(cy, cy + CHUNK):
+                for x in range(cx, cx + CHUNK):
+                    chunked.append(tiles[y * cols + x] if x < cols and y < rows else 0)
+    body = bytes((chunked[i] << 4) | chunked[i + 1] for i in range(0, len(chunked), 2))
+    return header + body
+
+
+def level_names(level_dir):
+    """パックに入る順（ファイル名順）。"""
+    names = sorted(n for n in os.listdir(level_dir) if n.endswith('.txt'))
+    if not names or len(names) > 255:
+        raise ValueError('{}: need 1..255 levels'.format(level_dir))
+    return names
+
+
+def build_pack(level_dir):
+    levels = [pack_level(*parse_level(os.path.join(level_dir, n))) for n in level_names(level_dir)]
+
+    offset = len(MAGIC) + 2 + 4 * len(levels)
+    offsets = []
+    for level in levels:
+        offsets.append(offset)
+        offset += len(level)
+
+    return (MAGIC + bytes([VERSION, len(levels)]) +
+            b''.join(struct.pack('<I', o) for o in offsets) +
+            b''.join(levels))
+
+
+def write_pack(level_dir, pack_path):
+    data = build_pack(level_dir)
+
+    # 内容が同じなら書かない（リソースの作り直しを避ける）
+    if os.path.exists(pack_path):
+        with open(pack_path, 'rb') as f:
+            if f.read() == data:
+                return
+    os.makedirs(os.path.dirname(pack_path) or '.', exist_ok=True)
+    with open(pack_path, 'wb') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    write_pack(sys.argv[1], sys.argv[2])
@@ -0,0 +1,57 @@
+#
+# マップ 1 枚を電話からの送信（src/pkjs/level_upload.js）と同じ形に分け、
+# ホストの --inbox 引数として出す。形式は src/c/level_upload.h を参照。
+#
+#   python tools/level_upload.py levels/04_long_haul.txt
+#   ./host/build/basalt/DSonPaper $(python DSonPaper/tools/level_upload.py map.txt --at 1000)
+#
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from level_pack import pack_level, parse_level  # noqa: E402
+
+CHUNK = 120  # LEVEL_UPLOAD_CHUNK
+
+
+def rle(data):
+    """3 バイト以上続く値はまとめ、残りはそのまま最大 128 バイトずつ。"""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 130:
+            run += 1
+        if run >= 3:
+            out += bytes([0x80 + run - 3, data[i]])
+            i += run
+            continue
+        start = i
+        while (i < len(data) and i - start < 128 and
+               not (i + 2 < len(data) and data[i] == data[i + 1] == data[i + 2])):
+            i += 1
+        out.append(i - start - 1)
+        out += data[start:i]
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('level')
+    parser.add_argument('--at', type=int, default=1000, help='最初の 1 通の時刻 (ms)')
+    parser.add_argument('--gap', type=int, default=200, help='1 通ごとの間隔 (ms)')
+    args = parser.parse_args()
+
+    data = rle(pack_level(*parse_level(args.level)))
+    inbox = []
+    for n, offset in enumerate(range(0, len(data), CHUNK)):
+        spec = 'level_offset={},level_data=[{}]'.format(offset, data[offset:offset + CHUNK].hex())
+        if offset == 0:
+            spec = 'level_size={},{}'.format(len(data), spec)
+        inbox += ['--inbox', '{}@{}'.format(spec, args.at + n * args.gap)]
+    print(' '.join(inbox))
+
+
+if __name__ == '__main__':
+    main()
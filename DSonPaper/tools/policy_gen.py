@@ -0,0 +1,161 @@
+#
+# レベルパックの各レベルについて、移動中の各状態で一番よい方向を
+# 後ろ向き帰納で求め、2bit ずつ詰めた表（resources/data/policy.bin）にする。
+# 形式は src/c/policy.h を参照。
+#
+# wscript の build() から level_pack.py の後に呼ばれる。単体でも
+#   python tools/policy_gen.py levels resources/data/policy.bin
+# で実行できる。
+#
+# 状態は 位置 × 劣化 × CHECK 済み × 残りの目。ルールは src/c/rules.c の
+# rules_step と同じ（地形が変わると停止、座礁地帯で劣化 +2、
+# CHECK を出てからの GOAL、劣化が MAX_DECAY に達したら失敗）。
+# 目標はクリアする確率で、同じならランクの期待値が高いほう。
+# 表はマスの数に比例して大きくなるので、MAX_CELLS を超えるマップには作らない
+# （オフセット 0。ヒントは出ない）。
+#
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from level_pack import level_names, parse_level  # noqa: E402
+
+EMPTY, MOUNTAIN, RIVER, STRANDED, START, CHECK, GOAL = range(7)
+HAZARDS = (MOUNTAIN, RIVER, STRANDED)
+
+# src/c/rules.h / rules.c と同じ
+MAX_DECAY = 15
+DICE_MAX = {MOUNTAIN: 2, RIVER: 3, STRANDED: 1}
+MAX_DICE = 4
+
+# move_dir と同じ順（0=上, 1=左, 2=下, 3=右）
+DIRECTIONS = ((0, -1), (-1, 0), (0, 1), (1, 0))
+
+MAGIC = b'DSPT'
+VERSION = 1
+MAX_CELLS = 1024
+
+FAIL = (0.0, 0.0)
+
+
+def rank_points(decay):
+    """rules_rank と同じ区切り。EXCELLENT 3、GOOD 2、SO SO 1。"""
+    return 3 if decay <= 8 else 2 if decay <= 11 else 1
+
+
+def solve(cols, rows, tiles):
+    """各状態の (クリア確率, ランクの期待値) と最善の方向を返す。"""
+    cells = cols * rows
+    tile = lambda i: tiles[i]
+
+    def neighbors(i):
+        x, y = i % cols, i // cols
+        for d, (dx, dy) in enumerate(DIRECTIONS):
+            nx, ny = x + dx, y + dy
+            if 0 <= nx < cols and 0 <= ny < rows:
+                yield d, ny * cols + nx
+
+    # rest[d][c][i]: 手番の始め。move[d][c][r][i]: 残り r 歩
+    rest = [[[FAIL] * cells for _ in range(2)] for _ in range(MAX_DECAY + 2)]
+    move = [[[[FAIL] * cells for _ in range(MAX_DICE + 1)] for _ in range(2)]
+            for _ in range(MAX_DECAY + 2)]
+    best = [[[[0] * cells for _ in range(MAX_DICE + 1)] for _ in range(2)]
+            for _ in range(MAX_DECAY)]
+
+    def step(i, d, c, r, n):
+        before, after = tile(i), tile(n)
+        checked = c or before == CHECK
+        decay = d
+        if after == STRANDED and before != STRANDED:
+            decay += 2
+        if decay >= MAX_DECAY:
+            return FAIL
+        if after == GOAL and checked:
+            return (1.0, float(rank_points(decay)))
+        if (after in HAZARDS and before != after) or r == 1:
+            return rest[decay][checked][n]
+        return move[decay][checked][r - 1][n]
+
+    # 劣化は減らないので大きいほうから。同じ劣化の中では rest → 残り 1 歩 → 2 歩 …
+    for d in range(MAX_DECAY - 1, -1, -1):
+        for c in (1, 0):
+            for i in range(cells):
+                if d + 1 >= MAX_DECAY:
+                    continue
+                faces = DICE_MAX.get(tile(i), MAX_DICE)
+                total = [0.0, 0.0]
+                for r in range(1, faces + 1):
+                    p, score = move[d + 1][c][r][i]
+                    total[0] += p / faces
+                    total[1] += score / faces
+                rest[d][c][i] = tuple(total)
+        for r in range(1, MAX_DICE + 1):
+            for c in (1, 0):
+                for i in range(cells):
+                    choice, value = 0, None
+                    for dir_, n in neighbors(i):
+                        v = step(i, d, c, r, n)
+                        if value is None or v[0] > value[0] + 1e-12 or \
+                                (abs(v[0] - value[0]) <= 1e-12 and v[1] > value[1] + 1e-12):
+                            choice, value = dir_, v
+                    move[d][c][r][i] = value or FAIL
+                    best[d][c][r][i] = choice
+    return rest, best
+
+
+def pack_policy(cols, rows, best):
+    """index = ((checked * MAX_DECAY + decay) * MAX_DICE + 残り-1) * cells + マス"""
+    cells = cols * rows
+    bits = []
+    for c in range(2):
+        for d in range(MAX_DECAY):
+            for r in range(1, MAX_DICE + 1):
+                bits.extend(best[d][c][r][:cells])
+    while len(bits) % 4:
+        bits.append(0)
+    return bytes(bits[i] | bits[i + 1] << 2 | bits[i + 2] << 4 | bits[i + 3] << 6
+                 for i in range(0, len(bits), 4))
+
+
+def build_policy(level_dir, report=None):
+    tables = []
+    for name in level_names(level_dir):
+        cols, rows, marks, tiles = parse_level(os.path.join(level_dir, name))
+        if cols * rows > MAX_CELLS:
+            if report:
+                report('{}: {}x{}, no table'.format(name, cols, rows))
+            tables.append(None)
+            continue
+        rest, best = solve(cols, rows, tiles)
+        sx, sy = marks['S']
+        if report:
+            p, score = rest[0][0][sy * cols + sx]
+            report('{}: clear {:.1%}, rank {:.2f}'.format(name, p, score))
+        tables.append(pack_policy(cols, rows, best))
+
+    offset = len(MAGIC) + 2 + 4 * len(tables)
+    offsets = []
+    for table in tables:
+        offsets.append(offset if table else 0)
+        offset += len(table or b'')
+    return (MAGIC + bytes([VERSION, len(tables)]) +
+            b''.join(struct.pack('<I', o) for o in offsets) +
+            b''.join(t for t in tables if t))
+
+
+def write_policy(level_dir, policy_path, report=None):
+    data = build_policy(level_dir, report)
+
+    # 内容が同じなら書かない（リソースの作り直しを避ける）
+    if os.path.exists(policy_path):
+        with open(policy_path, 'rb') as f:
+            if f.read() == data:
+                return
+    os.makedirs(os.path.dirname(policy_path) or '.', exist_ok=True)
+    with open(policy_path, 'wb') as f:
+        f.write(data)
+
+
+if __name__ == '__main__':
+    write_policy(sys.argv[1], sys.argv[2], report=print)
@@ -0,0 +1,158 @@
+// ================================
+//  DSonPaper rules_reach の確認
+// ================================
+// rules_reach（ビットで広げる）が、rules_step で全部の道順をたどった結果と
+// 同じマスを返すかを、ランダムなマップと状態でたしかめる。
+// 食い違ったら最初のいくつかを出して 1 で終わる。
+//
+//   make -C host check                       （make check の中で流れる）
+//   （rules.c と level.c だけをリンクする。どちらも SDK に依存しない）
+//   dsonpaper_reach_check [--cases N] [--seed S]
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rules.h"
+
+// Level に丸ごと持てる大きさまで（LEVEL_RESIDENT_CHUNKS）
+#define MIN_SIZE 3
+#define MAX_SIZE 16
+#define MAX_REPORTS 5
+
+// ------------------------------
+// 乱数（xorshift64*）
+// ------------------------------
+typedef struct {
+  uint64_t s;
+} Rng;
+
+static uint32_t rng_next(Rng *r) {
+  r->s ^= r->s >> 12;
+  r->s ^= r->s << 25;
+  r->s ^= r->s >> 27;
+  return (uint32_t)((r->s * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static int rng_below(Rng *r, int n) {
+  return (int)(((uint64_t)rng_next(r) * (uint32_t)n) >> 32);
+}
+
+// ------------------------------
+// ランダムなマップと状態
+// ------------------------------
+static void random_level(Rng *r, Level *level) {
+  static const TileType TERRAIN[] = {
+    TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_EMPTY, TILE_MOUNTAIN, TILE_MOUNTAIN,
+    TILE_RIVER, TILE_RIVER, TILE_STRANDED, TILE_STRANDED,
+  };
+  int cols = MIN_SIZE + rng_below(r, MAX_SIZE - MIN_SIZE + 1);
+  int rows = MIN_SIZE + rng_below(r, MAX_SIZE - MIN_SIZE + 1);
+  memset(level, 0, sizeof(*level));
+  level->data[0] = cols;
+  level->data[1] = rows;
+  for(int y = 0; y < rows; y++) {
+    for(int x = 0; x < cols; x++) {
+      level_set_tile(level, x, y, TERRAIN[rng_below(r, sizeof(TERRAIN) / sizeof(TERRAIN[0]))]);
+    }
+  }
+
+  // START・CHECK・GOAL は別々のマスに（ヘッダの位置も合わせる）
+  static const TileType MARKS[] = { TILE_START, TILE_CHECK, TILE_GOAL };
+  int placed[3];
+  for(int m = 0; m < 3; m++) {
+    int i;
+    bool taken;
+    do {
+      i = rng_below(r, cols * rows);
+      taken = false;
+      for(int k = 0; k < m; k++) taken |= placed[k] == i;
+    } while(taken);
+    placed[m] = i;
+    level->data[2 + m * 2] = i % cols;
+    level->data[3 + m * 2] = i / cols;
+    level_set_tile(level, i % cols, i / cols, MARKS[m]);
+  }
+}
+
+static void random_state(Rng *r, const Level *level, GameState *g) {
+  memset(g, 0, sizeof(*g));
+  g->x = rng_below(r, level_cols(level));
+  g->y = rng_below(r, level_rows(level));
+  g->moving = true;
+  g->dice = 1 + rng_below(r, RULES_MAX_ROLL);
+  g->passed_check = rng_below(r, 2);
+  g->decay = rng_below(r, MAX_DECAY);
+}
+
+// ------------------------------
+// 全部の道順（rules_step で 1 歩ずつ）
+// ------------------------------
+static void walk(const Level *level, GameState g, uint8_t *hit) {
+  if(!g.moving || g.over || g.clear) {
+    hit[g.y * MAX_SIZE + g.x] = 1;
+    return;
+  }
+  uint8_t mask = rules_dir_mask(level, g.x, g.y);
+  for(int dir = 0; dir < 4; dir++) {
+    if(!(mask & (1 << dir))) continue;
+    GameState next = g;
+    next.dir = dir;
+    rules_step(&next, level);
+    if(next.x == g.x && next.y == g.y) continue;   // 進めない向き
+    walk(level, next, hit);
+  }
+}
+
+// ------------------------------
+// main
+// ------------------------------
+int main(int argc, char **argv) {
+  long cases = 20000;
+  uint64_t seed = 7;
+
+  static const struct option OPTIONS[] = {
+    { "cases", required_argument, NULL, 'c' },
+    { "seed", required_argument, NULL, 'r' },
+    { NULL, 0, NULL, 0 },
+  };
+  int opt;
+  while((opt = getopt_long(argc, argv, "", OPTIONS, NULL)) != -1) {
+    switch(opt) {
+      case 'c': cases = atol(optarg); break;
+      case 'r': seed = strtoull(optarg, NULL, 10); break;
+      default:
+        fprintf(stderr, "usage: %s [--cases N] [--seed S]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  Rng rng = { seed * 0x9E3779B97F4A7C15ULL | 1 };
+  long cells = 0, bad = 0;
+  for(long c = 0; c < cases; c++) {
+    Level level;
+    GameState g;
+    random_level(&rng, &level);
+    random_state(&rng, &level, &g);
+
+    uint8_t hit[MAX_SIZE * MAX_SIZE] = { 0 };
+    walk(&level, g, hit);
+    RulesReach reach;
+    rules_reach(&g, &level, &reach);
+
+    for(int y = 0; y < level_rows(&level); y++) {
+      for(int x = 0; x < level_cols(&level); x++) {
+        cells++;
+        bool expected = hit[y * MAX_SIZE + x];
+        if(expected == rules_reach_has(&reach, x, y)) continue;
+        if(bad++ < MAX_REPORTS) {
+          printf("case %ld: %dx%d from (%d,%d) dice %d check %d: (%d,%d) walk %d reach %d\n",
+                 c, level_cols(&level), level_rows(&level), g.x, g.y, g.dice,
+                 g.passed_check, x, y, expected, !expected);
+        }
+      }
+    }
+  }
+
+  printf("reach_check: %ld cases, %ld cells, %ld mismatches\n", cases, cells, bad);
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+#include "battery_ledger.h"
+
+// ================================
+//  定義
+// ================================
+#define LEDGER_VERSION 1
+#define RING_SIZE 40
+
+// 公称の電池容量（mAh）。残量 % を mAh に換算するためだけに使う
+#if defined(PBL_PLATFORM_EMERY)
+#define BATTERY_CAPACITY_MAH 150
+#else
+#define BATTERY_CAPACITY_MAH 130
+#endif
+
+// 残量の変化 1 件（6 バイト）。mode の最上位ビットは充電中
+typedef struct __attribute__((__packed__)) {
+  uint32_t time;
+  uint8_t percent;
+  uint8_t mode;
+} LedgerEntry;
+
+#define ENTRY_CHARGING 0x80
+
+typedef struct {
+  uint8_t version;
+  uint8_t head;       // 次に書く位置
+  uint8_t count;
+  LedgerEntry entries[RING_SIZE];
+} LedgerRing;
+
+// モードごとの合計：振り分けた消費（0.01% 単位）と、その区間の長さ（秒）
+typedef struct {
+  uint8_t version;
+  uint32_t drain_cpct[BATTERY_LEDGER_MAX_MODES];
+  uint32_t seconds[BATTERY_LEDGER_MAX_MODES];
+} LedgerTotals;
+
+// ================================
+//  状態管理
+// ================================
+static const char *const *s_mode_names;
+static int s_mode_count;
+static int s_mode;
+static time_t s_mode_since;
+
+// 前回の残量から今までに各モードにいた秒数
+static uint32_t s_pending[BATTERY_LEDGER_MAX_MODES];
+static int s_last_percent = -1;
+
+static LedgerRing s_ring;
+static LedgerTotals s_totals;
+
+static Window *s_window;
+static TextLayer *s_text_layer;
+static char s_text[160];
+
+// ----------------------------------------------------------
+// 保存
+// ----------------------------------------------------------
+static void load(void) {
+  if(persist_read_data(BATTERY_LEDGER_RING_KEY, &s_ring, sizeof(s_ring)) != sizeof(s_ring) ||
+     s_ring.version != LEDGER_VERSION) {
+    memset(&s_ring, 0, sizeof(s_ring));
+    s_ring.version = LEDGER_VERSION;
+  }
+  if(persist_read_data(BATTERY_LEDGER_TOTALS_KEY, &s_totals, sizeof(s_totals)) != sizeof(s_totals) ||
+     s_totals.version != LEDGER_VERSION) {
+    memset(&s_totals, 0, sizeof(s_totals));
+    s_totals.version = LEDGER_VERSION;
+  }
+}
+
+static void ring_append(time_t now, BatteryChargeState charge) {
+  uint8_t mode = (uint8_t)s_mode | (charge.is_charging || charge.is_plugged ? ENTRY_CHARGING : 0);
+
+  // 起動のたびに同じ残量を書かない（フラッシュの書き込みを減らす）
+  if(s_ring.count) {
+    const LedgerEntry *last = &s_ring.entries[(s_ring.head + RING_SIZE - 1) % RING_SIZE];
+    if(last->percent == charge.charge_percent &&
+       (last->mode & ENTRY_CHARGING) == (mode & ENTRY_CHARGING)) return;
+  }
+
+  LedgerEntry *entry = &s_ring.entries[s_ring.head];
+  entry->time = (uint32_t)now;
+  entry->percent = charge.charge_percent;
+  entry->mode = mode;
+  s_ring.head = (s_ring.head + 1) % RING_SIZE;
+  if(s_ring.count < RING_SIZE) s_ring.count++;
+  persist_write_data(BATTERY_LEDGER_RING_KEY, &s_ring, sizeof(s_ring));
+}
+
+// ----------------------------------------------------------
+// 振り分け
+// ----------------------------------------------------------
+static void account_mode_time(time_t now) {
+  if(now > s_mode_since) s_pending[s_mode] += (uint32_t)(now - s_mode_since);
+  s_mode_since = now;
+}
+
+// 減った分を、前回の記録から各モードにいた時間の比で振り分ける
+static void attribute_drop(int drop_percent) {
+  uint32_t total = 0;
+  for(int i = 0; i < s_mode_count; i++) total += s_pending[i];
+  if(total == 0) return;
+
+  uint32_t drop_cpct = (uint32_t)drop_percent * 100;
+  uint32_t given = 0;
+  int largest = 0;
+  for(int i = 0; i < s_mode_count; i++) {
+    uint32_t share = (uint32_t)((uint64_t)drop_cpct * s_pending[i] / total);
+    s_totals.drain_cpct[i] += share;
+    s_totals.seconds[i] += s_pending[i];
+    given += share;
+    if(s_pending[i] > s_pending[largest]) largest = i;
+  }
+  // 端数は一番長くいたモードへ
+  s_totals.drain_cpct[largest] += drop_cpct - given;
+  persist_write_data(BATTERY_LEDGER_TOTALS_KEY, &s_totals, sizeof(s_totals));
+}
+
+static void battery_handler(BatteryChargeState charge) {
+  time_t now = time(NULL);
+  if(s_last_percent == charge.charge_percent && !charge.is_charging) return;
+
+  account_mode_time(now);
+  bool charging = charge.is_charging || charge.is_plugged;
+  if(!charging && s_last_percent > charge.charge_percent) {
+    attribute_drop(s_last_percent - charge.charge_percent);
+  }
+  // 充電・増加・初回はそこから数え直す
+  memset(s_pending, 0, sizeof(s_pending));
+  s_last_percent = charging ? -1 : charge.charge_percent;
+  ring_append(now, charge);
+}
+
+void battery_ledger_set_mode(int mode) {
+  if(mode < 0 || mode >= s_mode_count || mode == s_mode) return;
+  account_mode_time(time(NULL));
+  s_mode = mode;
+}
+
+// ================================
+//  ウィンドウ
+// ================================
+static void format_text(void) {
+  int len = snprintf(s_text, sizeof(s_text), "mAh/h (%dmAh)\n", BATTERY_CAPACITY_MAH);
+  for(int i = 0; i < s_mode_count && len < (int)sizeof(s_text); i++) {
+    uint32_t seconds = s_totals.seconds[i];
+    // 0.01% × 容量 → 0.01mAh、それを 1 時間あたりに
+    uint32_t per_hour_x100 = seconds
+        ? (uint32_t)((uint64_t)s_totals.drain_cpct[i] * BATTERY_CAPACITY_MAH * 3600 /
+                     100 / seconds)
+        : 0;
+    uint32_t hours_x10 = seconds / 360;
+    len += snprintf(s_text + len, sizeof(s_text) - len, "%s %lu.%02lu (%lu.%luh)\n",
+                    s_mode_names[i], (unsigned long)(per_hour_x100 / 100),
+                    (unsigned long)(per_hour_x100 % 100), (unsigned long)(hours_x10 / 10),
+                    (unsigned long)(hours_x10 % 10));
+  }
+  if(s_ring.count && len < (int)sizeof(s_text)) {
+    const LedgerEntry *last = &s_ring.entries[(s_ring.head + RING_SIZE - 1) % RING_SIZE];
+    time_t when = last->time;
+    struct tm *t = localtime(&when);
+    snprintf(s_text + len, sizeof(s_text) - len, "last %d%% %02d/%02d %02d:%02d",
+             last->percent, t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min);
+  }
+}
+
+// SELECT 長押しで記録を消す
+static void reset_long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  memset(&s_totals, 0, sizeof(s_totals));
+  s_totals.version = LEDGER_VERSION;
+  memset(&s_ring, 0, sizeof(s_ring));
+  s_ring.version = LEDGER_VERSION;
+  persist_delete(BATTERY_LEDGER_TOTALS_KEY);
+  persist_delete(BATTERY_LEDGER_RING_KEY);
+  format_text();
+  text_layer_set_text(s_text_layer, s_text);
+}
+
+static void window_click_config_provider(void *context) {
+  window_long_click_subscribe(BUTTON_ID_SELECT, 0, reset_long_click_handler, NULL);
+}
+
+static void window_load(Window *window) {
+  Layer *root = window_get_root_layer(window);
+  GRect bounds = layer_get_bounds(root);
+  int inset = PBL_IF_ROUND_ELSE(20, 4);
+
+  s_text_layer = text_layer_create(GRect(inset, inset, bounds.size.w - inset * 2,
+                                         bounds.size.h - inset * 2));
+  text_layer_set_font(s_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_alignment(s_text_layer, PBL_IF_ROUND_ELSE(GTextAlignmentCenter, GTextAlignmentLeft));
+  format_text();
+  text_layer_set_text(s_text_layer, s_text);
+  layer_add_child(root, text_layer_get_layer(s_text_layer));
+}
+
+static void window_unload(Window *window) {
+  text_layer_destroy(s_text_layer);
+  s_text_layer = NULL;
+}
+
+void battery_ledger_window_push(void) {
+  if(!s_window) {
+    s_window = window_create();
+    window_set_click_config_provider(s_window, window_click_config_provider);
+    window_set_window_handlers(s_window, (WindowHandlers){
+      .load = window_load,
+      .unload = window_unload,
+    });
+  }
+  window_stack_push(s_window, true);
+}
+
+static void long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  battery_ledger_window_push();
+}
+
+void battery_ledger_long_click_subscribe(ButtonId button) {
+  window_long_click_subscribe(button, 0, long_click_handler, NULL);
+}
+
+// ================================
+//  init / deinit
+// ================================
+void battery_ledger_init(const char *const *mode_names, int mode_count) {
+  s_mode_names = mode_names;
+  s_mode_count = MIN(mode_count, BATTERY_LEDGER_MAX_MODES);
+  s_mode = 0;
+  s_mode_since = time(NULL);
+  s_last_percent = -1;
+  memset(s_pending, 0, sizeof(s_pending));
+  load();
+
+  // 起動時の残量を基準にする
+  battery_handler(battery_state_service_peek());
+  battery_state_service_subscribe(battery_handler);
+}
+
+void battery_ledger_deinit(void) {
+  battery_state_service_unsubscribe();
+  if(s_window) {
+    window_destroy(s_window);
+    s_window = NULL;
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <pebble.h>
+
+// ================================
+//  battery_ledger: モードごとの電池消費の記録
+// ================================
+// battery_state_service の残量の変化を時刻つきで記録し、その間に
+// アプリが各モードにいた時間の割合で減った分を振り分ける。
+// 変化の記録は persist のリングに、モードごとの合計は別キーに保存する。
+// 長押しで開くウィンドウに、モードごとの 1 時間あたりの消費（mAh 換算）を出す。
+//
+//   static const char *const MODES[] = { "minute", "second" };
+//   battery_ledger_init(MODES, ARRAY_LENGTH(MODES));   // init()
+//   battery_ledger_set_mode(1);                         // モードが変わるたび
+//   battery_ledger_long_click_subscribe(BUTTON_ID_UP);  // click_config_provider
+//   battery_ledger_deinit();                            // deinit()
+//
+// 残量は 10% 刻みでしか届かない機種が多いので、数字が落ち着くには
+// 何日か使い続ける必要がある。充電中の区間は数えない。
+
+// persist のキー（アプリ側のキーと重ならない番号）
+#define BATTERY_LEDGER_RING_KEY 1100
+#define BATTERY_LEDGER_TOTALS_KEY 1101
+
+#define BATTERY_LEDGER_MAX_MODES 4
+
+void battery_ledger_init(const char *const *mode_names, int mode_count);
+void battery_ledger_deinit(void);
+void battery_ledger_set_mode(int mode);
+void battery_ledger_long_click_subscribe(ButtonId button);
+void battery_ledger_window_push(void);
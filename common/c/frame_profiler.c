@@ -0,0 +1,259 @@
+#include "frame_profiler.h"
+
+#ifdef FRAME_PROFILER
+
+// ================================
+//  定義
+// ================================
+#define MAX_ATTACHED 4
+#define PROFILER_VERSION 1
+
+// 各区間の上限（ミリ秒、この値を含む）。最後は上限なし
+static const uint16_t BUCKET_LIMITS[FRAME_PROFILER_BUCKETS - 1] = {
+  1, 2, 4, 8, 12, 16, 24, 33, 50, 66, 100
+};
+static const char *const BUCKET_LABELS[FRAME_PROFILER_BUCKETS] = {
+  "1", "2", "4", "8", "12", "16", "24", "33", "50", "66", "100", "+"
+};
+
+typedef struct {
+  uint16_t ms;
+  uint32_t when;      // 計測した時刻（UNIX 秒）
+} WorstFrame;
+
+// persist にそのまま書く合計（PERSIST_DATA_MAX_LENGTH に収まる大きさ）
+typedef struct {
+  uint8_t version;
+  uint32_t frames;
+  uint32_t total_ms;
+  uint32_t hist[FRAME_PROFILER_BUCKETS];
+  WorstFrame worst[FRAME_PROFILER_WORST];
+} ProfilerTotals;
+
+// ================================
+//  状態管理
+// ================================
+static const char *s_app_name;
+static ProfilerTotals s_totals;
+static uint32_t s_session_frames;
+
+typedef struct {
+  Layer *layer;
+  LayerUpdateProc update_proc;
+} Attached;
+
+static Attached s_attached[MAX_ATTACHED];
+
+static Window *s_window;
+static Layer *s_view_layer;
+
+// ----------------------------------------------------------
+// 計測
+// ----------------------------------------------------------
+static uint32_t now_ms(void) {
+  time_t sec;
+  uint16_t ms;
+  time_ms(&sec, &ms);
+  return (uint32_t)sec * 1000 + ms;
+}
+
+static int bucket_for(uint32_t ms) {
+  for(int i = 0; i < FRAME_PROFILER_BUCKETS - 1; i++) {
+    if(ms <= BUCKET_LIMITS[i]) return i;
+  }
+  return FRAME_PROFILER_BUCKETS - 1;
+}
+
+// ワースト N 件：一番小さい記録より遅ければ置き換える
+static void record_worst(uint16_t ms) {
+  int slot = 0;
+  for(int i = 1; i < FRAME_PROFILER_WORST; i++) {
+    if(s_totals.worst[i].ms < s_totals.worst[slot].ms) slot = i;
+  }
+  if(ms <= s_totals.worst[slot].ms) return;
+  s_totals.worst[slot].ms = ms;
+  s_totals.worst[slot].when = (uint32_t)time(NULL);
+}
+
+static void record_frame(uint32_t ms) {
+  s_totals.frames++;
+  s_totals.total_ms += ms;
+  s_totals.hist[bucket_for(ms)]++;
+  record_worst(ms > UINT16_MAX ? UINT16_MAX : (uint16_t)ms);
+  s_session_frames++;
+}
+
+// 包んだレイヤー共通の update proc
+static void profiled_update_proc(Layer *layer, GContext *ctx) {
+  for(int i = 0; i < MAX_ATTACHED; i++) {
+    if(s_attached[i].layer != layer) continue;
+    uint32_t start = now_ms();
+    s_attached[i].update_proc(layer, ctx);
+    record_frame(now_ms() - start);
+    return;
+  }
+}
+
+void frame_profiler_attach(Layer *layer, LayerUpdateProc update_proc) {
+  for(int i = 0; i < MAX_ATTACHED; i++) {
+    if(s_attached[i].layer == layer || !s_attached[i].layer) {
+      s_attached[i].layer = layer;
+      s_attached[i].update_proc = update_proc;
+      layer_set_update_proc(layer, profiled_update_proc);
+      return;
+    }
+  }
+  // 枠がなければ計測せずにそのまま描く
+  layer_set_update_proc(layer, update_proc);
+}
+
+// ----------------------------------------------------------
+// 保存
+// ----------------------------------------------------------
+static void load_totals(void) {
+  memset(&s_totals, 0, sizeof(s_totals));
+  if(persist_read_data(FRAME_PROFILER_PERSIST_KEY, &s_totals, sizeof(s_totals)) != sizeof(s_totals) ||
+     s_totals.version != PROFILER_VERSION) {
+    memset(&s_totals, 0, sizeof(s_totals));
+  }
+  s_totals.version = PROFILER_VERSION;
+}
+
+static void save_totals(void) {
+  if(s_session_frames == 0) return;
+  persist_write_data(FRAME_PROFILER_PERSIST_KEY, &s_totals, sizeof(s_totals));
+  s_session_frames = 0;
+}
+
+// ================================
+//  デバッグウィンドウ
+// ================================
+static void view_update_proc(Layer *layer, GContext *ctx) {
+  GRect bounds = layer_get_bounds(layer);
+  int inset = PBL_IF_ROUND_ELSE(24, 4);
+  int w = bounds.size.w - inset * 2;
+  GFont font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  graphics_context_set_text_color(ctx, GColorWhite);
+
+  // 見出し：フレーム数・平均・最大
+  uint32_t avg = s_totals.frames ? s_totals.total_ms / s_totals.frames : 0;
+  uint16_t max = 0;
+  for(int i = 0; i < FRAME_PROFILER_WORST; i++) {
+    if(s_totals.worst[i].ms > max) max = s_totals.worst[i].ms;
+  }
+  static char header[64];
+  snprintf(header, sizeof(header), "%s\n%lu frames avg %lums max %ums",
+           s_app_name ? s_app_name : "", (unsigned long)s_totals.frames,
+           (unsigned long)avg, max);
+  graphics_draw_text(ctx, header, font, GRect(inset, PBL_IF_ROUND_ELSE(18, 0), w, 34),
+                     GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+
+  // ヒストグラム（最多の区間を高さいっぱいにする）
+  int chart_top = PBL_IF_ROUND_ELSE(56, 38);
+  int chart_h = bounds.size.h / 3;
+  int bar_w = w / FRAME_PROFILER_BUCKETS;
+  uint32_t peak = 1;
+  for(int i = 0; i < FRAME_PROFILER_BUCKETS; i++) {
+    if(s_totals.hist[i] > peak) peak = s_totals.hist[i];
+  }
+  graphics_context_set_fill_color(ctx, PBL_IF_COLOR_ELSE(GColorGreen, GColorWhite));
+  for(int i = 0; i < FRAME_PROFILER_BUCKETS; i++) {
+    int h = (int)((uint64_t)s_totals.hist[i] * chart_h / peak);
+    if(s_totals.hist[i] && h == 0) h = 1;
+    graphics_fill_rect(ctx, GRect(inset + i * bar_w, chart_top + chart_h - h, bar_w - 1, h),
+                       0, GCornerNone);
+  }
+  // 区間ラベルは 1 つおき
+  for(int i = 0; i < FRAME_PROFILER_BUCKETS; i += 2) {
+    graphics_draw_text(ctx, BUCKET_LABELS[i], font,
+                       GRect(inset + i * bar_w - 4, chart_top + chart_h, bar_w * 2, 16),
+                       GTextOverflowModeFill, GTextAlignmentLeft, NULL);
+  }
+
+  // ワースト N 件（遅い順）
+  static char worst[96];
+  int len = snprintf(worst, sizeof(worst), "worst:");
+  bool used[FRAME_PROFILER_WORST] = { false };
+  for(int n = 0; n < FRAME_PROFILER_WORST; n++) {
+    int best = -1;
+    for(int i = 0; i < FRAME_PROFILER_WORST; i++) {
+      if(!used[i] && s_totals.worst[i].ms &&
+         (best < 0 || s_totals.worst[i].ms > s_totals.worst[best].ms)) best = i;
+    }
+    if(best < 0) break;
+    used[best] = true;
+    len += snprintf(worst + len, sizeof(worst) - len, " %u", s_totals.worst[best].ms);
+  }
+  graphics_draw_text(ctx, worst, font,
+                     GRect(inset, chart_top + chart_h + 16, w, 34),
+                     GTextOverflowModeWordWrap, PBL_IF_ROUND_ELSE(GTextAlignmentCenter, GTextAlignmentLeft), NULL);
+}
+
+// SELECT 長押しで合計をリセット
+static void reset_long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  memset(&s_totals, 0, sizeof(s_totals));
+  s_totals.version = PROFILER_VERSION;
+  persist_delete(FRAME_PROFILER_PERSIST_KEY);
+  layer_mark_dirty(s_view_layer);
+}
+
+static void window_click_config_provider(void *context) {
+  window_long_click_subscribe(BUTTON_ID_SELECT, 0, reset_long_click_handler, NULL);
+}
+
+static void window_load(Window *window) {
+  Layer *root = window_get_root_layer(window);
+  s_view_layer = layer_create(layer_get_bounds(root));
+  layer_set_update_proc(s_view_layer, view_update_proc);
+  layer_add_child(root, s_view_layer);
+}
+
+static void window_unload(Window *window) {
+  layer_destroy(s_view_layer);
+  s_view_layer = NULL;
+}
+
+void frame_profiler_window_push(void) {
+  if(!s_window) {
+    s_window = window_create();
+    window_set_click_config_provider(s_window, window_click_config_provider);
+    window_set_window_handlers(s_window, (WindowHandlers){
+      .load = window_load,
+      .unload = window_unload,
+    });
+  }
+  // 開くたびに保存しておく（電池切れでも直近まで残る）
+  save_totals();
+  window_stack_push(s_window, true);
+}
+
+static void long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  frame_profiler_window_push();
+}
+
+void frame_profiler_long_click_subscribe(ButtonId button) {
+  window_long_click_subscribe(button, 0, long_click_handler, NULL);
+}
+
+// ================================
+//  init / deinit
+// ================================
+void frame_profiler_init(const char *app_name) {
+  s_app_name = app_name;
+  s_session_frames = 0;
+  load_totals();
+}
+
+void frame_profiler_deinit(void) {
+  save_totals();
+  if(s_window) {
+    window_destroy(s_window);
+    s_window = NULL;
+  }
+  memset(s_attached, 0, sizeof(s_attached));
+}
+
+#endif
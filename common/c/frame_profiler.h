@@ -0,0 +1,42 @@
+#pragma once
+#include <pebble.h>
+
+// ================================
+//  frame_profiler: 描画時間の計測（ビルドフラグ FRAME_PROFILER のときだけ有効）
+// ================================
+// レイヤーの update proc を包んで 1 フレームごとの時間を time_ms() で測り、
+// 静的メモリのヒストグラムとワースト N 件に積む。合計は persist に保存するので
+// 再起動しても消えない。長押しでデバッグウィンドウを開いて確認する。
+//
+//   frame_profiler_init("9blocks");                    // init() の先頭
+//   frame_profiler_attach(s_layer, layer_update_proc); // layer_set_update_proc の代わり
+//   frame_profiler_long_click_subscribe(BUTTON_ID_DOWN); // click_config_provider の中
+//   frame_profiler_deinit();                           // deinit() の最後（合計を保存）
+//
+// FRAME_PROFILER を定義しないビルドでは全部マクロで消え、
+// frame_profiler_attach は layer_set_update_proc そのものになる。
+
+// persist のキー（アプリ側のキーと重ならない番号）
+#define FRAME_PROFILER_PERSIST_KEY 1000
+
+// ヒストグラムの区間数とワーストの件数
+#define FRAME_PROFILER_BUCKETS 12
+#define FRAME_PROFILER_WORST 5
+
+#ifdef FRAME_PROFILER
+
+void frame_profiler_init(const char *app_name);
+void frame_profiler_deinit(void);
+void frame_profiler_attach(Layer *layer, LayerUpdateProc update_proc);
+void frame_profiler_long_click_subscribe(ButtonId button);
+void frame_profiler_window_push(void);
+
+#else
+
+#define frame_profiler_init(app_name)
+#define frame_profiler_deinit()
+#define frame_profiler_attach(layer, update_proc) layer_set_update_proc(layer, update_proc)
+#define frame_profiler_long_click_subscribe(button)
+#define frame_profiler_window_push()
+
+#endif
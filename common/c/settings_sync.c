@@ -0,0 +1,190 @@
+#include "settings_sync.h"
+
+// ================================
+//  定義
+// ================================
+// 辞書 1 件は key(4) + type(1) + length(2) + 値。値はすべて int32（dict_calc_buffer_size と同じ数え方）
+#define TUPLE_BYTES (7 + sizeof(int32_t))
+#define DICT_BYTES(n) (1 + (n) * TUPLE_BYTES)
+
+// 電話とのやりとりの settings_revision（正の値は電話の版）
+#define REVISION_REQUEST_FULL 0   // ウォッチ → 電話: 全部送って
+#define REVISION_WATCH_CHANGE -1  // ウォッチ → 電話: ウォッチ側で変えた値
+
+// ================================
+//  状態管理
+// ================================
+static const uint32_t *s_revision_key;
+static const SettingDef *s_defs;
+static int32_t *s_values;
+static int s_count;
+static SettingsChangedHandler s_handler;
+
+// ウォッチ側で変えて、まだ電話に届いていない設定
+static uint32_t s_unsent;
+static bool s_in_flight;            // 送信中（結果待ち）
+static uint32_t s_in_flight_bits;   // そのうち、送ってから変わっていないもの
+static bool s_report_paused;   // 届かなかった：次に変えるか、次の起動まで送らない
+
+// settings_sync_share
+static SettingsSyncShare s_other;
+
+static int32_t clamp(const SettingDef *def, int32_t value) {
+  return value < def->min ? def->min : value > def->max ? def->max : value;
+}
+
+// 値を入れて、変わっていれば残す
+static bool apply(int index, int32_t value) {
+  value = clamp(&s_defs[index], value);
+  if(value == s_values[index]) return false;
+  s_values[index] = value;
+  persist_write_int(s_defs[index].persist_key, value);
+  return true;
+}
+
+// ================================
+//  受信
+// ================================
+static int32_t tuple_int(const Tuple *t) {
+  switch(t->length) {
+    case 1: return t->type == TUPLE_INT ? t->value->int8 : t->value->uint8;
+    case 2: return t->type == TUPLE_INT ? t->value->int16 : t->value->uint16;
+    default: return t->value->int32;
+  }
+}
+
+static void inbox_received(DictionaryIterator *iter, void *context) {
+  if(!dict_find(iter, *s_revision_key)) {
+    if(s_other.received) s_other.received(iter, context);
+    return;
+  }
+
+  uint32_t changed = 0;
+  for(Tuple *t = dict_read_first(iter); t; t = dict_read_next(iter)) {
+    if(t->type != TUPLE_INT && t->type != TUPLE_UINT) continue;
+    if(t->key == *s_revision_key) {
+      int32_t revision = tuple_int(t);
+      if(persist_read_int(SETTINGS_SYNC_REVISION_KEY) != revision) {
+        persist_write_int(SETTINGS_SYNC_REVISION_KEY, revision);
+      }
+      continue;
+    }
+    for(int i = 0; i < s_count; i++) {
+      if(*s_defs[i].message_key == t->key) {
+        if(apply(i, tuple_int(t))) changed |= 1u << i;
+        break;
+      }
+    }
+  }
+  if(changed && s_handler) s_handler(changed);
+}
+
+// ================================
+//  送信
+// ================================
+static void save_unsent(void) {
+  if(s_unsent) {
+    persist_write_int(SETTINGS_SYNC_UNSENT_KEY, s_unsent);
+  } else if(persist_exists(SETTINGS_SYNC_UNSENT_KEY)) {
+    persist_delete(SETTINGS_SYNC_UNSENT_KEY);
+  }
+}
+
+// ウォッチ側で変えた値をまとめて 1 通（送信箱が空いていなければ、次に空いたとき）
+static void send_unsent(void) {
+  if(!s_unsent || s_in_flight || s_report_paused) return;
+  DictionaryIterator *iter;
+  if(app_message_outbox_begin(&iter) != APP_MSG_OK) return;
+  dict_write_int32(iter, *s_revision_key, REVISION_WATCH_CHANGE);
+  for(int i = 0; i < s_count; i++) {
+    if(s_unsent & (1u << i)) dict_write_int32(iter, *s_defs[i].message_key, s_values[i]);
+  }
+  if(app_message_outbox_send() == APP_MSG_OK) {
+    s_in_flight = true;
+    s_in_flight_bits = s_unsent;
+  }
+}
+
+static bool is_report(DictionaryIterator *iter) {
+  Tuple *t = iter ? dict_find(iter, *s_revision_key) : NULL;
+  return t && tuple_int(t) == REVISION_WATCH_CHANGE;
+}
+
+static void outbox_sent(DictionaryIterator *iter, void *context) {
+  if(s_in_flight && is_report(iter)) {
+    // 送っている間にまた変わった設定は残る（s_in_flight_bits から外してある）
+    s_unsent &= ~s_in_flight_bits;
+    s_in_flight = false;
+    save_unsent();
+  }
+  if(s_other.sent) s_other.sent(iter, context);
+  send_unsent();
+}
+
+static void outbox_failed(DictionaryIterator *iter, AppMessageResult reason, void *context) {
+  if(s_in_flight && is_report(iter)) {
+    s_in_flight = false;
+    s_report_paused = true;   // 電話が繋がっていない：persist に残して次の起動で
+  }
+  if(s_other.failed) s_other.failed(iter, reason, context);
+  send_unsent();
+}
+
+// 入れたばかりで一度も受け取っていない：全部を 1 回だけ頼む
+static void request_full(void) {
+  DictionaryIterator *iter;
+  if(app_message_outbox_begin(&iter) != APP_MSG_OK) return;
+  dict_write_int32(iter, *s_revision_key, REVISION_REQUEST_FULL);
+  app_message_outbox_send();
+}
+
+// ================================
+//  公開関数
+// ================================
+void settings_sync_init(const uint32_t *revision_key, const SettingDef *defs, int32_t *values,
+                        int count, SettingsChangedHandler handler) {
+  s_revision_key = revision_key;
+  s_defs = defs;
+  s_values = values;
+  s_count = count < SETTINGS_SYNC_MAX ? count : SETTINGS_SYNC_MAX;
+  s_handler = handler;
+
+  for(int i = 0; i < s_count; i++) {
+    values[i] = persist_exists(defs[i].persist_key)
+              ? clamp(&defs[i], persist_read_int(defs[i].persist_key))
+              : defs[i].fallback;
+  }
+
+  s_unsent = persist_read_int(SETTINGS_SYNC_UNSENT_KEY) & ((1u << s_count) - 1);
+  s_in_flight = false;
+  s_report_paused = false;
+
+  // どちらの向きも全部の設定が 1 通に入る大きさ
+  app_message_register_inbox_received(inbox_received);
+  app_message_register_outbox_sent(outbox_sent);
+  app_message_register_outbox_failed(outbox_failed);
+  uint32_t size = DICT_BYTES(s_count + 1);
+  app_message_open(size > s_other.inbox_size ? size : s_other.inbox_size,
+                   size > s_other.outbox_size ? size : s_other.outbox_size);
+
+  if(!persist_exists(SETTINGS_SYNC_REVISION_KEY)) request_full();
+  send_unsent();   // 前回届かなかった分（送信箱が空いていなければ結果のあとで）
+}
+
+void settings_sync_deinit(void) {
+  app_message_deregister_callbacks();
+}
+
+void settings_sync_share(const SettingsSyncShare *share) {
+  s_other = *share;
+}
+
+bool settings_sync_set(int index, int32_t value) {
+  if(index < 0 || index >= s_count || !apply(index, value)) return false;
+  s_unsent |= 1u << index;
+  s_in_flight_bits &= ~(1u << index);
+  save_unsent();
+  s_report_paused = false;
+  send_unsent();
+  return true;
+}
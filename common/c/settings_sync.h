@@ -0,0 +1,66 @@
+#pragma once
+#include <pebble.h>
+
+// ================================
+//  settings_sync: 電話（pkjs）からの設定を受け取って persist に残す
+// ================================
+// 正本は電話側（common/pkjs/settings_sync.js）。電話は前回届いた値との差分だけを
+// 1 通の AppMessage にまとめて送り、変わっていなければ何も送らない
+// （1 通ごとに両方の無線が起きる）。ウォッチは届いた値を範囲に収めて反映し、
+// 値が変わったキーだけ persist_write_int する。
+// 一度も受け取っていない（入れたばかり）ときだけ、ウォッチから全部を 1 回頼む。
+// ウォッチ側で変えた値（settings_sync_set）は settings_revision = -1 と一緒に電話へ知らせ、
+// 電話の正本も書き換える。届くまではキーのビットを persist に残し、次の起動でも送り直す。
+//
+//   static int32_t s_values[SETTING_COUNT];
+//   static const SettingDef SETTINGS[SETTING_COUNT] = {
+//     [SETTING_INVERT] = { &MESSAGE_KEY_invert_colors, 1, 0, 1, 0 },
+//   };
+//   settings_sync_init(&MESSAGE_KEY_settings_revision, SETTINGS, s_values, SETTING_COUNT,
+//                      settings_changed);          // init()
+//   settings_sync_set(SETTING_INVERT, 1);      // ウォッチ側で変えたとき
+//   settings_sync_deinit();                    // deinit()
+//
+// package.json の messageKeys には settings_revision と各設定の名前を並べる。
+
+// persist のキー（アプリ側のキーと重ならない番号）
+#define SETTINGS_SYNC_REVISION_KEY 1200
+#define SETTINGS_SYNC_UNSENT_KEY 1201     // 電話へまだ届いていない設定のビット
+
+// 1 アプリの設定の上限（変わったものをビットで知らせる）
+#define SETTINGS_SYNC_MAX 16
+
+typedef struct {
+  const uint32_t *message_key;  // &MESSAGE_KEY_xxx（SDK が生成する変数）
+  uint32_t persist_key;
+  int32_t min;
+  int32_t max;
+  int32_t fallback;             // まだ何も届いていないときの値
+} SettingDef;
+
+// changed: 値が変わった設定のビット（1 << index）。1 通につき 1 回呼ぶ
+typedef void (*SettingsChangedHandler)(uint32_t changed);
+
+// persist から values に読み、AppMessage を開く（受信箱は全部の設定が 1 通に入る大きさ）。
+// revision_key は &MESSAGE_KEY_settings_revision（common/c はアプリごとのキーを知らない）
+void settings_sync_init(const uint32_t *revision_key, const SettingDef *defs, int32_t *values,
+                        int count, SettingsChangedHandler handler);
+void settings_sync_deinit(void);
+
+// 設定でないメッセージ（settings_revision を含まないもの）も同じ AppMessage でやりとりするとき、
+// settings_sync_init の前に呼ぶ（AppMessage のコールバックは 1 組しか登録できない）。
+// received には設定でない受信だけ、sent / failed には送信の結果をすべて渡す
+// （自分のメッセージかどうかは iterator のキーで見分ける）。
+// 大きさはそのメッセージに要る分（設定の分と大きい方で開く）
+typedef struct {
+  AppMessageInboxReceived received;
+  AppMessageOutboxSent sent;
+  AppMessageOutboxFailed failed;
+  uint32_t inbox_size;
+  uint32_t outbox_size;
+} SettingsSyncShare;
+
+void settings_sync_share(const SettingsSyncShare *share);
+
+// ウォッチ側で変えた値を反映して残し、電話へ知らせる（変わらなければ何もしない）。変わったら true
+bool settings_sync_set(int index, int32_t value);
@@ -0,0 +1,173 @@
+#include "span_fill.h"
+
+// 直接書いた画素の累計（同じ画素を 2 回塗れば 2 と数える）
+static uint32_t s_pixels_written;
+
+// ------------------------------
+// 形式チェック
+// ------------------------------
+static bool format_supported(GBitmapFormat format) {
+  switch(format) {
+    case GBitmapFormat1Bit:
+    case GBitmapFormat8Bit:
+    case GBitmapFormat8BitCircular:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static GBitmap *capture(GContext *ctx) {
+#ifdef SPAN_FILL_USE_SDK
+  return NULL;
+#else
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if(fb && !format_supported(gbitmap_get_format(fb))) {
+    graphics_release_frame_buffer(ctx, fb);
+    fb = NULL;
+  }
+  return fb;
+#endif
+}
+
+// ------------------------------
+// スパン書き込み
+// ------------------------------
+
+// 8bit: 先頭と末尾はバイト、間は 32bit ワードで埋める
+static void fill_span_8bit(uint8_t *p, int n, uint8_t value) {
+  while(n > 0 && ((uintptr_t)p & 3)) {
+    *p++ = value;
+    n--;
+  }
+  uint32_t word = value * 0x01010101u;
+  uint32_t *w = (uint32_t *)p;
+  for(; n >= 4; n -= 4) {
+    *w++ = word;
+  }
+  p = (uint8_t *)w;
+  while(n-- > 0) {
+    *p++ = value;
+  }
+}
+
+// 1bit: 行は 32bit 境界から始まり、画素 x はワード x/32 のビット x%32（LSB が左）
+static void fill_span_1bit(uint8_t *row, int x0, int x1, bool set) {
+  uint32_t *words = (uint32_t *)row;
+  int first = x0 >> 5;
+  int last = x1 >> 5;
+  uint32_t head = ~0u << (x0 & 31);
+  uint32_t tail = ~0u >> (31 - (x1 & 31));
+
+  if(first == last) {
+    uint32_t mask = head & tail;
+    words[first] = set ? (words[first] | mask) : (words[first] & ~mask);
+    return;
+  }
+
+  words[first] = set ? (words[first] | head) : (words[first] & ~head);
+  for(int i = first + 1; i < last; i++) {
+    words[i] = set ? ~0u : 0;
+  }
+  words[last] = set ? (words[last] | tail) : (words[last] & ~tail);
+}
+
+// 直接塗れない色は一度フレームバッファを返して SDK で塗る
+static void fill_with_sdk(SpanFill *fill, GRect rect, GColor color) {
+  if(fill->fb) {
+    graphics_release_frame_buffer(fill->ctx, fill->fb);
+  }
+  graphics_context_set_fill_color(fill->ctx, color);
+  graphics_fill_rect(fill->ctx, rect, 0, GCornerNone);
+  if(fill->fb) {
+    fill->fb = capture(fill->ctx);
+  }
+}
+
+// ------------------------------
+// 公開関数
+// ------------------------------
+// レイヤーの frame を画面座標で（layer_convert_point_to_screen は bounds の原点を含む）
+static GRect frame_on_screen(const Layer *layer) {
+  GRect bounds = layer_get_bounds(layer);
+  GRect frame = layer_get_frame(layer);
+  frame.origin = layer_convert_point_to_screen(layer,
+                                               GPoint(-bounds.origin.x, -bounds.origin.y));
+  return frame;
+}
+
+void span_fill_begin(SpanFill *fill, GContext *ctx, const Layer *layer) {
+  fill->ctx = ctx;
+  fill->origin = layer_convert_point_to_screen(layer, GPointZero);
+  fill->clip = frame_on_screen(layer);
+  Window *window = layer_get_window(layer);
+  if(window) {
+    GRect root = frame_on_screen(window_get_root_layer(window));
+    grect_clip(&fill->clip, &root);
+  }
+  fill->fb = capture(ctx);
+  if(fill->fb) {
+    GRect fb_bounds = gbitmap_get_bounds(fill->fb);
+    grect_clip(&fill->clip, &fb_bounds);
+  }
+}
+
+void span_fill_clip(SpanFill *fill, GRect rect) {
+  rect.origin.x += fill->origin.x;
+  rect.origin.y += fill->origin.y;
+  grect_clip(&fill->clip, &rect);
+}
+
+void span_fill_rect(SpanFill *fill, GRect rect, GColor color) {
+  if(color.a == 0) return;  // GColorClear
+
+  bool bw = gcolor_equal(color, GColorBlack) || gcolor_equal(color, GColorWhite);
+  if(!fill->fb || color.a != 3 ||
+     (gbitmap_get_format(fill->fb) == GBitmapFormat1Bit && !bw)) {
+    fill_with_sdk(fill, rect, color);
+    return;
+  }
+
+  rect.origin.x += fill->origin.x;
+  rect.origin.y += fill->origin.y;
+  grect_clip(&rect, &fill->clip);
+  if(rect.size.w <= 0 || rect.size.h <= 0) return;
+
+  int x0 = rect.origin.x;
+  int x1 = rect.origin.x + rect.size.w - 1;
+  int y_end = rect.origin.y + rect.size.h;
+  bool one_bit = (gbitmap_get_format(fill->fb) == GBitmapFormat1Bit);
+  bool white = gcolor_equal(color, GColorWhite);
+
+  for(int y = rect.origin.y; y < y_end; y++) {
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(fill->fb, y);
+    // 丸型は行ごとに描画可能な範囲が違う
+    int sx0 = MAX(x0, row.min_x);
+    int sx1 = MIN(x1, row.max_x);
+    if(sx0 > sx1) continue;
+    s_pixels_written += sx1 - sx0 + 1;
+
+    if(one_bit) {
+      fill_span_1bit(row.data, sx0, sx1, white);
+    } else {
+      fill_span_8bit(row.data + sx0, sx1 - sx0 + 1, color.argb);
+    }
+  }
+}
+
+void span_fill_rects(SpanFill *fill, const GRect *rects, int count, GColor color) {
+  for(int i = 0; i < count; i++) {
+    span_fill_rect(fill, rects[i], color);
+  }
+}
+
+uint32_t span_fill_pixels_written(void) {
+  return s_pixels_written;
+}
+
+void span_fill_end(SpanFill *fill) {
+  if(fill->fb) {
+    graphics_release_frame_buffer(fill->ctx, fill->fb);
+    fill->fb = NULL;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <pebble.h>
+
+// ================================
+//  span_fill: 軸に平行な矩形をフレームバッファへ直接塗る
+// ================================
+// graphics_fill_rect を矩形ごとに呼ぶ代わりに、フレームバッファを1回だけ
+// キャプチャして行（スパン）単位でワード書き込みする。
+// 対応形式: GBitmapFormat1Bit（白黒のみ）/ 8Bit / 8BitCircular。
+// それ以外の形式・色は自動で SDK の graphics_fill_rect に落ちる。
+//
+//   SpanFill fill;
+//   span_fill_begin(&fill, ctx, layer);
+//   span_fill_rect(&fill, rect, color);   // 何回でも
+//   span_fill_end(&fill);                 // ここから先は通常の SDK 描画
+//
+// begin〜end の間は他の graphics_* を呼ばないこと（フレームバッファが
+// キャプチャ中のため）。SPAN_FILL_USE_SDK を定義すると常に SDK で塗る
+// （フレーム時間の比較用。host では make span_fill で両方を比べる）。
+// span_fill_pixels_written は直接書いた画素の累計（ハーネスがフレームごとに読む）。
+//
+// クリップは SDK と同じく、レイヤーの frame（bounds がずれていてもずれる前の位置）と
+// ウィンドウのルートレイヤーとフレームバッファの重なり。SDK は途中の親レイヤーの
+// クリップを取り出せないので、親が自分より狭いときは span_fill_clip で絞る。
+
+typedef struct {
+  GContext *ctx;
+  GBitmap *fb;      // キャプチャしたフレームバッファ（NULL = SDK で塗る）
+  GPoint origin;    // レイヤー座標 → 画面座標のオフセット
+  GRect clip;       // 画面座標でのクリップ範囲
+} SpanFill;
+
+void span_fill_begin(SpanFill *fill, GContext *ctx, const Layer *layer);
+// クリップをさらに rect（レイヤー座標）との重なりに絞る
+void span_fill_clip(SpanFill *fill, GRect rect);
+void span_fill_rect(SpanFill *fill, GRect rect, GColor color);
+void span_fill_rects(SpanFill *fill, const GRect *rects, int count, GColor color);
+void span_fill_end(SpanFill *fill);
+uint32_t span_fill_pixels_written(void);
@@ -0,0 +1,203 @@
+// ================================
+//  settings_sync: 設定の正本（電話側）と、ウォッチへの差分送信
+// ================================
+// ウォッチ側は common/c/settings_sync.h。各アプリの wscript がこのファイルをそのまま同梱する。
+//
+// 設定は localStorage に持ち、ウォッチへ最後に届いた値（synced）との差分だけを
+// settings_revision と一緒に 1 通で送る。差分がなければ何も送らない
+// （1 通ごとに電話とウォッチの両方の無線が起きる）。
+// ウォッチが何も持っていないとき（settings_revision = 0 が届く）は、
+// ウォッチの既定値からの差分を送り直す。ウォッチのボタンで変えた値は
+// settings_revision = -1 と一緒に届くので、正本（と synced）をその値にする。
+//
+//   var settings = require('../../../common/pkjs/settings_sync');   // src/pkjs/index.js から
+//   settings.init('9blocks', [
+//     { key: 'invert_colors', label: 'Invert colors', type: 'toggle', fallback: 0 },
+//     { key: 'second_window', label: 'Seconds after flick', min: 5, max: 120, fallback: 30 },
+//   ]);
+//
+// key は package.json の messageKeys、fallback はウォッチ側の SettingDef と同じ値にする。
+// options: [...] の欄は選択肢から選ぶ（ほかの値は一番近い選択肢にする。ウォッチ側が
+// 値を丸めるときは同じ選択肢にしておく。silentwatch の chime_interval）。
+// type: 'text' の欄は設定ではなく（保存も同期もしない）、入力をそのまま
+// init の 3 つ目の引数 onResult(result) に渡す（DSonPaper のマップの送信など）。
+
+var CONFIG_KEY = 'settings';
+var SYNCED_KEY = 'settings_synced';
+var REVISION_KEY = 'settings_revision';
+
+var REVISION_REQUEST_FULL = 0;    // common/c/settings_sync.c と同じ
+var REVISION_WATCH_CHANGE = -1;
+
+var s_title;
+var s_fields;
+var s_onResult;
+
+// 保存して同期する欄（text はその場で使うだけ）
+function settingFields() {
+  return s_fields.filter(function(field) { return field.type !== 'text'; });
+}
+
+function load(name, fallback) {
+  try {
+    return JSON.parse(localStorage.getItem(name)) || fallback;
+  } catch (e) {
+    return fallback;
+  }
+}
+
+function save(name, value) {
+  localStorage.setItem(name, JSON.stringify(value));
+}
+
+// ウォッチが何も受け取っていないときの値
+function fallbacks() {
+  var values = {};
+  settingFields().forEach(function(field) {
+    values[field.key] = field.fallback;
+  });
+  return values;
+}
+
+function clamp(field, value) {
+  value = Number(value) | 0;
+  if (field.options) {
+    return field.options.reduce(function(best, option) {
+      return Math.abs(option - value) < Math.abs(best - value) ? option : best;
+    });
+  }
+  var min = field.type === 'toggle' ? 0 : field.min;
+  var max = field.type === 'toggle' ? 1 : field.max;
+  return Math.min(Math.max(value, min), max);
+}
+
+// 正本（前の版の範囲で保存した値も今の範囲に直す。直した値は synced との差分として送る）
+function loadConfig() {
+  var config = load(CONFIG_KEY, fallbacks());
+  settingFields().forEach(function(field) {
+    if (field.key in config) config[field.key] = clamp(field, config[field.key]);
+  });
+  return config;
+}
+
+// ------------------------------
+// 送信
+// ------------------------------
+// force: 差分がなくても settings_revision だけは送る（ウォッチからの要求に答える）
+function sendDelta(force) {
+  var config = loadConfig();
+  var synced = load(SYNCED_KEY, fallbacks());
+  var message = {};
+  var changed = 0;
+  settingFields().forEach(function(field) {
+    if (field.key in config && config[field.key] !== synced[field.key]) {
+      message[field.key] = config[field.key];
+      changed++;
+    }
+  });
+  if (!changed && !force) return;
+
+  var revision = (load(REVISION_KEY, 0) | 0) + 1;
+  message.settings_revision = revision;
+  Pebble.sendAppMessage(message, function() {
+    Object.keys(message).forEach(function(key) {
+      if (key !== 'settings_revision') synced[key] = message[key];
+    });
+    save(SYNCED_KEY, synced);
+    save(REVISION_KEY, revision);
+  }, function(e) {
+    // synced は変えない：次の起動でもう一度差分になる
+    console.log('settings_sync: send failed ' + JSON.stringify(e));
+  });
+}
+
+// ------------------------------
+// 設定画面（data: URI のフォーム）
+// ------------------------------
+function escapeHtml(text) {
+  return String(text).replace(/&/g, '&amp;').replace(/</g, '&lt;').replace(/"/g, '&quot;');
+}
+
+function configPage() {
+  var config = loadConfig();
+  var rows = s_fields.map(function(field) {
+    var value = field.key in config ? config[field.key] : field.fallback;
+    var input = field.type === 'text'
+      ? '<br><textarea id="' + field.key + '" rows="10" cols="24"></textarea>'
+      : field.type === 'toggle'
+      ? '<input type="checkbox" id="' + field.key + '"' + (value ? ' checked' : '') + '>'
+      : field.options
+      ? '<select id="' + field.key + '">' + field.options.map(function(option) {
+          return '<option' + (option === value ? ' selected' : '') + '>' + option + '</option>';
+        }).join('') + '</select>'
+      : '<input type="number" id="' + field.key + '" min="' + field.min + '" max="' +
+        field.max + '" value="' + value + '">';
+    return '<p><label>' + escapeHtml(field.label) + ' ' + input + '</label></p>';
+  });
+  var keys = JSON.stringify(s_fields.map(function(field) { return field.key; }));
+  var html = '<!DOCTYPE html><html><head><meta name="viewport" content="width=device-width">' +
+    '<title>' + escapeHtml(s_title) + '</title></head><body>' +
+    '<h3>' + escapeHtml(s_title) + '</h3>' + rows.join('') +
+    '<button id="save">Save</button><script>' +
+    'document.getElementById("save").onclick=function(){var r={};' + keys +
+    '.forEach(function(k){var e=document.getElementById(k);' +
+    'r[k]=e.type==="checkbox"?(e.checked?1:0):' +
+    'e.tagName==="TEXTAREA"?e.value:Number(e.value);});' +
+    'location.href="pebblejs://close#"+encodeURIComponent(JSON.stringify(r));};' +
+    '</script></body></html>';
+  return 'data:text/html;charset=utf-8,' + encodeURIComponent(html);
+}
+
+// ================================
+//  公開
+// ================================
+exports.init = function(title, fields, onResult) {
+  s_title = title;
+  s_fields = fields;
+  s_onResult = onResult;
+
+  Pebble.addEventListener('ready', function() {
+    sendDelta(false);
+  });
+
+  Pebble.addEventListener('appmessage', function(e) {
+    var revision = e.payload.settings_revision;
+    if (revision === REVISION_REQUEST_FULL) {
+      // ウォッチが何も持っていない：ウォッチの既定値からの差分を送る
+      save(SYNCED_KEY, fallbacks());
+      sendDelta(true);
+    } else if (revision === REVISION_WATCH_CHANGE) {
+      // ウォッチで変えた：もうウォッチにある値なので送り返さない
+      var config = loadConfig();
+      var synced = load(SYNCED_KEY, fallbacks());
+      settingFields().forEach(function(field) {
+        if (field.key in e.payload) {
+          config[field.key] = synced[field.key] = clamp(field, e.payload[field.key]);
+        }
+      });
+      save(CONFIG_KEY, config);
+      save(SYNCED_KEY, synced);
+    }
+  });
+
+  Pebble.addEventListener('showConfiguration', function() {
+    Pebble.openURL(configPage());
+  });
+
+  Pebble.addEventListener('webviewclosed', function(e) {
+    if (!e.response) return;
+    var result;
+    try {
+      result = JSON.parse(decodeURIComponent(e.response));
+    } catch (err) {
+      return;
+    }
+    var config = loadConfig();
+    settingFields().forEach(function(field) {
+      if (field.key in result) config[field.key] = clamp(field, result[field.key]);
+    });
+    save(CONFIG_KEY, config);
+    sendDelta(false);
+    if (s_onResult) s_onResult(result);
+  });
+};
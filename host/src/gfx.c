@@ -0,0 +1,592 @@
+// ================================
+//  ソフトウェアレンダラ
+// ================================
+// GBitmap / GContext / graphics_* の実装。画素を書くたびに
+// g_host_frame に描画コール数と画素数を数える。
+#include "host.h"
+
+#include <math.h>
+#include <time.h>
+
+HostFrameStats g_host_frame;
+
+static GBitmap *s_fb;
+static GContext s_ctx;
+static uint8_t *s_capture_snapshot;
+
+void host_count_draw_call(void) {
+  g_host_frame.draw_calls++;
+}
+
+// 描画にかかった CPU 時間（仮想時計ではなく、このスレッドの実時間）
+uint64_t host_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// ------------------------------
+// 幾何
+// ------------------------------
+bool gpoint_equal(const GPoint *const a, const GPoint *const b) {
+  return a->x == b->x && a->y == b->y;
+}
+
+bool grect_equal(const GRect *const a, const GRect *const b) {
+  return gpoint_equal(&a->origin, &b->origin) && a->size.w == b->size.w &&
+         a->size.h == b->size.h;
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+  return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+         point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+void grect_clip(GRect *const rect, const GRect *const clipper) {
+  int x0 = MAX(rect->origin.x, clipper->origin.x);
+  int y0 = MAX(rect->origin.y, clipper->origin.y);
+  int x1 = MIN(rect->origin.x + rect->size.w, clipper->origin.x + clipper->size.w);
+  int y1 = MIN(rect->origin.y + rect->size.h, clipper->origin.y + clipper->size.h);
+  *rect = GRect(x0, y0, MAX(0, x1 - x0), MAX(0, y1 - y0));
+}
+
+GRect grect_crop(GRect rect, const int32_t crop) {
+  return GRect(rect.origin.x + crop, rect.origin.y + crop, rect.size.w - 2 * crop,
+               rect.size.h - 2 * crop);
+}
+
+GPoint grect_center_point(const GRect *rect) {
+  return GPoint(rect->origin.x + rect->size.w / 2, rect->origin.y + rect->size.h / 2);
+}
+
+// ------------------------------
+// 色
+// ------------------------------
+bool gcolor_equal(GColor8 x, GColor8 y) {
+  return x.argb == y.argb || (x.a == 0 && y.a == 0);
+}
+
+GColor8 gcolor_legible_over(GColor8 bg) {
+  return (bg.r + bg.g + bg.b) >= 5 ? GColorBlack : GColorWhite;
+}
+
+// ------------------------------
+// ビットマップ
+// ------------------------------
+static int format_bpp(GBitmapFormat format) {
+  switch(format) {
+    case GBitmapFormat1Bit:
+    case GBitmapFormat1BitPalette:
+      return 1;
+    case GBitmapFormat2BitPalette:
+      return 2;
+    case GBitmapFormat4BitPalette:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+static bool format_has_palette(GBitmapFormat format) {
+  return format == GBitmapFormat1BitPalette || format == GBitmapFormat2BitPalette ||
+         format == GBitmapFormat4BitPalette;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  if(!bitmap) return NULL;
+
+  int bpp = format_bpp(format);
+  if(format == GBitmapFormat1Bit) {
+    bitmap->row_size_bytes = ((size.w + 31) / 32) * 4;   // 1bit はワード境界
+  } else {
+    bitmap->row_size_bytes = (size.w * bpp + 7) / 8;
+  }
+  bitmap->format = format;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  bitmap->data = calloc(size.h ? size.h : 1, bitmap->row_size_bytes ? bitmap->row_size_bytes : 1);
+  bitmap->owns_data = true;
+  if(format_has_palette(format)) {
+    bitmap->palette = calloc(1u << bpp, sizeof(GColor));
+    bitmap->owns_palette = true;
+  }
+  return bitmap;
+}
+
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format,
+                                           GColor *palette, bool free_on_destroy) {
+  GBitmap *bitmap = gbitmap_create_blank(size, format);
+  if(bitmap) gbitmap_set_palette(bitmap, palette, free_on_destroy);
+  return bitmap;
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base, GRect sub_rect) {
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  if(!bitmap) return NULL;
+  *bitmap = *base;
+  grect_clip(&sub_rect, &base->bounds);
+  bitmap->bounds = sub_rect;
+  bitmap->owns_data = false;
+  bitmap->owns_palette = false;
+  return bitmap;
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  return NULL;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if(!bitmap) return;
+  if(bitmap->owns_data) free(bitmap->data);
+  if(bitmap->owns_palette) free(bitmap->palette);
+  free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) {
+  return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+  return bitmap->row_size_bytes;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+  return bitmap->format;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+  return bitmap->bounds;
+}
+
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds) {
+  bitmap->bounds = bounds;
+}
+
+GColor *gbitmap_get_palette(const GBitmap *bitmap) {
+  return bitmap->palette;
+}
+
+void gbitmap_set_palette(GBitmap *bitmap, GColor *palette, bool free_on_destroy) {
+  if(bitmap->owns_palette && bitmap->palette != palette) free(bitmap->palette);
+  bitmap->palette = palette;
+  bitmap->owns_palette = free_on_destroy;
+}
+
+// 丸型画面の各行で表示される範囲
+static void circular_span(int y, int16_t *min_x, int16_t *max_x) {
+  double r = HOST_SCREEN_W / 2.0;
+  double dy = y + 0.5 - HOST_SCREEN_H / 2.0;
+  double half = (r * r > dy * dy) ? sqrt(r * r - dy * dy) : 0;
+  *min_x = (int16_t)lround(HOST_SCREEN_W / 2.0 - half);
+  *max_x = (int16_t)(HOST_SCREEN_W - 1 - *min_x);
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y) {
+  GBitmapDataRowInfo info;
+  int row = bitmap->bounds.origin.y + y;
+  info.data = bitmap->data + row * bitmap->row_size_bytes;
+  info.min_x = 0;
+  info.max_x = bitmap->bounds.size.w - 1;
+  if(bitmap->format == GBitmapFormat8Bit || bitmap->format == GBitmapFormat8BitCircular) {
+    info.data += bitmap->bounds.origin.x;
+  }
+  if(bitmap->format == GBitmapFormat8BitCircular) {
+    circular_span(row, &info.min_x, &info.max_x);
+  }
+  return info;
+}
+
+// x, y は data 内の絶対座標
+GColor host_bitmap_get_pixel(const GBitmap *bitmap, int x, int y) {
+  const uint8_t *row = bitmap->data + y * bitmap->row_size_bytes;
+  switch(bitmap->format) {
+    case GBitmapFormat1Bit:
+      return ((row[x >> 3] >> (x & 7)) & 1) ? GColorWhite : GColorBlack;
+    case GBitmapFormat1BitPalette:
+      return bitmap->palette[(row[x >> 3] >> (7 - (x & 7))) & 1];
+    case GBitmapFormat2BitPalette:
+      return bitmap->palette[(row[x >> 2] >> (6 - 2 * (x & 3))) & 3];
+    case GBitmapFormat4BitPalette:
+      return bitmap->palette[(row[x >> 1] >> (4 - 4 * (x & 1))) & 0xF];
+    default:
+      return (GColor){ .argb = row[x] };
+  }
+}
+
+// ------------------------------
+// フレームバッファ
+// ------------------------------
+void host_graphics_init(void) {
+#if defined(PBL_PLATFORM_APLITE)
+  GBitmapFormat format = GBitmapFormat1Bit;
+#elif defined(PBL_ROUND)
+  GBitmapFormat format = GBitmapFormat8BitCircular;
+#else
+  GBitmapFormat format = GBitmapFormat8Bit;
+#endif
+  s_fb = gbitmap_create_blank(GSize(HOST_SCREEN_W, HOST_SCREEN_H), format);
+  s_ctx.fb = s_fb;
+  s_ctx.stroke_width = 1;
+}
+
+GContext *host_graphics_context(void) {
+  return &s_ctx;
+}
+
+GBitmap *host_frame_buffer(void) {
+  return s_fb;
+}
+
+uint32_t host_frame_hash(void) {
+  uint32_t hash = 2166136261u;
+  for(int y = 0; y < HOST_SCREEN_H; y++) {
+    const uint8_t *row = s_fb->data + y * s_fb->row_size_bytes;
+    for(int i = 0; i < s_fb->row_size_bytes; i++) {
+      hash = (hash ^ row[i]) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+  return graphics_capture_frame_buffer_format(ctx, ctx->fb->format);
+}
+
+GBitmap *graphics_capture_frame_buffer_format(GContext *ctx, GBitmapFormat format) {
+  if(ctx->captured || format != ctx->fb->format) return NULL;
+  uint64_t start = host_cpu_ns();
+  size_t size = (size_t)ctx->fb->row_size_bytes * HOST_SCREEN_H;
+  free(s_capture_snapshot);
+  s_capture_snapshot = malloc(size);
+  memcpy(s_capture_snapshot, ctx->fb->data, size);
+  ctx->captured = true;
+  g_host_frame.accounting_ns += host_cpu_ns() - start;
+  return ctx->fb;
+}
+
+// キャプチャ中に値が変わった画素を数える（書いた画素数は span_fill が数える）。
+// 比べる時間は描画時間に入れない
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  if(!ctx->captured || buffer != ctx->fb) return false;
+  uint64_t start = host_cpu_ns();
+  for(int y = 0; y < HOST_SCREEN_H; y++) {
+    for(int x = 0; x < HOST_SCREEN_W; x++) {
+      GColor before;
+      if(ctx->fb->format == GBitmapFormat1Bit) {
+        uint8_t b = s_capture_snapshot[y * ctx->fb->row_size_bytes + (x >> 3)];
+        before = ((b >> (x & 7)) & 1) ? GColorWhite : GColorBlack;
+      } else {
+        before.argb = s_capture_snapshot[y * ctx->fb->row_size_bytes + x];
+      }
+      if(before.argb != host_bitmap_get_pixel(ctx->fb, x, y).argb) {
+        g_host_frame.fb_direct_pixels++;
+      }
+    }
+  }
+  free(s_capture_snapshot);
+  s_capture_snapshot = NULL;
+  ctx->captured = false;
+  g_host_frame.accounting_ns += host_cpu_ns() - start;
+  return true;
+}
+
+// ------------------------------
+// 画素
+// ------------------------------
+static bool ctx_usable(GContext *ctx) {
+  if(ctx->captured) {
+    fprintf(stderr, "host: graphics call while frame buffer is captured\n");
+    return false;
+  }
+  host_count_draw_call();
+  return true;
+}
+
+// 画面座標で1画素書く（クリップ済みであること）
+static void put_screen_pixel(GContext *ctx, int x, int y, GColor color) {
+  GBitmap *fb = ctx->fb;
+  uint8_t *row = fb->data + y * fb->row_size_bytes;
+  if(fb->format == GBitmapFormat1Bit) {
+    bool white = (color.r + color.g + color.b) >= 6;
+    if(white) row[x >> 3] |= 1 << (x & 7);
+    else row[x >> 3] &= ~(1 << (x & 7));
+  } else {
+    if(fb->format == GBitmapFormat8BitCircular) {
+      int16_t min_x, max_x;
+      circular_span(y, &min_x, &max_x);
+      if(x < min_x || x > max_x) return;
+    }
+    row[x] = color.argb | 0xC0;
+  }
+  g_host_frame.pixels++;
+}
+
+// レイヤー座標で1画素書く
+static void put_pixel(GContext *ctx, int x, int y, GColor color) {
+  if(color.a == 0) return;
+  int sx = ctx->draw_box.origin.x + x;
+  int sy = ctx->draw_box.origin.y + y;
+  GPoint p = GPoint(sx, sy);
+  if(!grect_contains_point(&ctx->clip_box, &p)) return;
+  put_screen_pixel(ctx, sx, sy, color);
+}
+
+static void fill_span(GContext *ctx, int x0, int x1, int y, GColor color) {
+  for(int x = x0; x <= x1; x++) {
+    put_pixel(ctx, x, y, color);
+  }
+}
+
+// ------------------------------
+// 描画コンテキスト
+// ------------------------------
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_color = color;
+}
+
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width) {
+  ctx->stroke_width = stroke_width ? stroke_width : 1;
+}
+
+void graphics_context_set_antialiased(GContext *ctx, bool enable) {
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  ctx->comp_op = mode;
+}
+
+// ------------------------------
+// 図形
+// ------------------------------
+static bool outside_corner(GRect rect, int x, int y, int r, GCornerMask mask) {
+  if(r <= 0) return false;
+  int left = rect.origin.x + r, right = rect.origin.x + rect.size.w - 1 - r;
+  int top = rect.origin.y + r, bottom = rect.origin.y + rect.size.h - 1 - r;
+  int cx, cy;
+  if(x < left && y < top && (mask & GCornerTopLeft)) { cx = left; cy = top; }
+  else if(x > right && y < top && (mask & GCornerTopRight)) { cx = right; cy = top; }
+  else if(x < left && y > bottom && (mask & GCornerBottomLeft)) { cx = left; cy = bottom; }
+  else if(x > right && y > bottom && (mask & GCornerBottomRight)) { cx = right; cy = bottom; }
+  else return false;
+  return (x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius,
+                        GCornerMask corner_mask) {
+  if(!ctx_usable(ctx)) return;
+  for(int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+    for(int x = rect.origin.x; x < rect.origin.x + rect.size.w; x++) {
+      if(outside_corner(rect, x, y, corner_radius, corner_mask)) continue;
+      put_pixel(ctx, x, y, ctx->fill_color);
+    }
+  }
+}
+
+void graphics_draw_rect(GContext *ctx, GRect rect) {
+  if(!ctx_usable(ctx)) return;
+  int x1 = rect.origin.x + rect.size.w - 1, y1 = rect.origin.y + rect.size.h - 1;
+  fill_span(ctx, rect.origin.x, x1, rect.origin.y, ctx->stroke_color);
+  fill_span(ctx, rect.origin.x, x1, y1, ctx->stroke_color);
+  for(int y = rect.origin.y + 1; y < y1; y++) {
+    put_pixel(ctx, rect.origin.x, y, ctx->stroke_color);
+    put_pixel(ctx, x1, y, ctx->stroke_color);
+  }
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  if(!ctx_usable(ctx)) return;
+  int r = radius;
+  for(int dy = -r; dy <= r; dy++) {
+    for(int dx = -r; dx <= r; dx++) {
+      if(dx * dx + dy * dy <= r * r + r) put_pixel(ctx, p.x + dx, p.y + dy, ctx->fill_color);
+    }
+  }
+}
+
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  if(!ctx_usable(ctx)) return;
+  double half = ctx->stroke_width / 2.0;
+  int outer = radius + ctx->stroke_width;
+  for(int dy = -outer; dy <= outer; dy++) {
+    for(int dx = -outer; dx <= outer; dx++) {
+      double d = sqrt((double)(dx * dx + dy * dy));
+      if(fabs(d - radius) < half + 0.25) put_pixel(ctx, p.x + dx, p.y + dy, ctx->stroke_color);
+    }
+  }
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  if(!ctx_usable(ctx)) return;
+  int x = p0.x, y = p0.y;
+  int dx = abs(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+  int dy = -abs(p1.y - p0.y), sy = p0.y < p1.y ? 1 : -1;
+  int err = dx + dy;
+  for(;;) {
+    put_pixel(ctx, x, y, ctx->stroke_color);
+    if(x == p1.x && y == p1.y) break;
+    int e2 = 2 * err;
+    if(e2 >= dy) { err += dy; x += sx; }
+    if(e2 <= dx) { err += dx; y += sy; }
+  }
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  if(!ctx_usable(ctx)) return;
+  put_pixel(ctx, point.x, point.y, ctx->stroke_color);
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  if(!ctx_usable(ctx) || !bitmap) return;
+  GRect src = bitmap->bounds;
+  if(src.size.w <= 0 || src.size.h <= 0) return;
+  for(int y = 0; y < rect.size.h; y++) {
+    for(int x = 0; x < rect.size.w; x++) {
+      // 描画先が大きければタイル状に繰り返す（SDK と同じ）
+      GColor c = host_bitmap_get_pixel(bitmap, src.origin.x + x % src.size.w,
+                                       src.origin.y + y % src.size.h);
+      if(ctx->comp_op == GCompOpAssignInverted) {
+        c = gcolor_equal(c, GColorWhite) ? GColorBlack : GColorWhite;
+      } else if(ctx->comp_op == GCompOpSet && c.a == 0) {
+        continue;
+      }
+      put_pixel(ctx, rect.origin.x + x, rect.origin.y + y, (GColor){ .argb = c.argb | 0xC0 });
+    }
+  }
+}
+
+// ------------------------------
+// パス
+// ------------------------------
+GPath *gpath_create(const GPathInfo *init) {
+  GPath *path = calloc(1, sizeof(GPath));
+  if(!path) return NULL;
+  path->num_points = init->num_points;
+  path->points = init->points;
+  return path;
+}
+
+void gpath_destroy(GPath *gpath) {
+  free(gpath);
+}
+
+void gpath_move_to(GPath *path, GPoint point) {
+  path->offset = point;
+}
+
+void gpath_rotate_to(GPath *path, int32_t angle) {
+  path->rotation = angle;
+}
+
+static GPoint path_point(const GPath *path, uint32_t i) {
+  GPoint p = path->points[i];
+  if(path->rotation) {
+    double a = path->rotation * 2.0 * M_PI / 0x10000;
+    double x = p.x * cos(a) - p.y * sin(a);
+    double y = p.x * sin(a) + p.y * cos(a);
+    p = GPoint((int16_t)lround(x), (int16_t)lround(y));
+  }
+  return GPoint(p.x + path->offset.x, p.y + path->offset.y);
+}
+
+void gpath_draw_filled(GContext *ctx, GPath *path) {
+  if(!ctx_usable(ctx) || path->num_points < 3) return;
+  int min_y = INT16_MAX, max_y = INT16_MIN;
+  for(uint32_t i = 0; i < path->num_points; i++) {
+    GPoint p = path_point(path, i);
+    min_y = MIN(min_y, p.y);
+    max_y = MAX(max_y, p.y);
+  }
+  // 画素中心の走査線で交点を求め、偶奇規則で塗る
+  for(int y = min_y; y <= max_y; y++) {
+    double xs[16];
+    int n = 0;
+    double fy = y + 0.5;
+    for(uint32_t i = 0; i < path->num_points && n < 16; i++) {
+      GPoint a = path_point(path, i);
+      GPoint b = path_point(path, (i + 1) % path->num_points);
+      if((a.y <= fy && b.y > fy) || (b.y <= fy && a.y > fy)) {
+        xs[n++] = a.x + (fy - a.y) * (b.x - a.x) / (double)(b.y - a.y);
+      }
+    }
+    for(int i = 1; i < n; i++) {
+      for(int j = i; j > 0 && xs[j - 1] > xs[j]; j--) {
+        double t = xs[j]; xs[j] = xs[j - 1]; xs[j - 1] = t;
+      }
+    }
+    for(int i = 0; i + 1 < n; i += 2) {
+      fill_span(ctx, (int)ceil(xs[i] - 0.5), (int)floor(xs[i + 1] - 0.5), y, ctx->fill_color);
+    }
+  }
+}
+
+void gpath_draw_outline(GContext *ctx, GPath *path) {
+  for(uint32_t i = 0; i < path->num_points; i++) {
+    graphics_draw_line(ctx, path_point(path, i), path_point(path, (i + 1) % path->num_points));
+  }
+}
+
+// ------------------------------
+// テキスト（プレースホルダ）
+// ------------------------------
+// グリフは描かず、1文字ごとにフォントの大きさに合わせた箱を塗る。
+// レイアウトと描画コストの目安にはなる。
+static struct FontInfo s_fonts[] = {
+  { FONT_KEY_GOTHIC_14, 14 }, { FONT_KEY_GOTHIC_14_BOLD, 14 },
+  { FONT_KEY_GOTHIC_18, 18 }, { FONT_KEY_GOTHIC_18_BOLD, 18 },
+  { FONT_KEY_GOTHIC_24, 24 }, { FONT_KEY_GOTHIC_24_BOLD, 24 },
+  { FONT_KEY_GOTHIC_28, 28 }, { FONT_KEY_GOTHIC_28_BOLD, 28 },
+  { FONT_KEY_BITHAM_42_BOLD, 42 },
+};
+
+GFont fonts_get_system_font(const char *font_key) {
+  for(size_t i = 0; i < ARRAY_LENGTH(s_fonts); i++) {
+    if(strcmp(s_fonts[i].key, font_key) == 0) return &s_fonts[i];
+  }
+  return &s_fonts[0];
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, const GFont font, const GRect box,
+                        const GTextOverflowMode overflow_mode,
+                        const GTextAlignment alignment, GTextAttributes *attributes) {
+  if(!ctx_usable(ctx) || !text) return;
+  int size = font ? font->size : 14;
+  int advance = MAX(2, size * 9 / 20);
+  int glyph_w = advance - 1;
+  int glyph_h = size * 11 / 20;
+  int top = box.origin.y + size * 3 / 10;
+
+  // 改行ごとに1行
+  int line = 0;
+  const char *start = text;
+  while(*start) {
+    const char *end = strchr(start, '\n');
+    int len = end ? (int)(end - start) : (int)strlen(start);
+    int width = len * advance;
+    int x = box.origin.x;
+    if(alignment == GTextAlignmentCenter) x += (box.size.w - width) / 2;
+    else if(alignment == GTextAlignmentRight) x += box.size.w - width;
+    int y = top + line * (size + 2);
+
+    for(int i = 0; i < len; i++, x += advance) {
+      if(start[i] == ' ') continue;
+      for(int gy = y; gy < y + glyph_h && gy < box.origin.y + box.size.h; gy++) {
+        for(int gx = x; gx < x + glyph_w; gx++) {
+          if(gx >= box.origin.x && gx < box.origin.x + box.size.w) {
+            put_pixel(ctx, gx, gy, ctx->text_color);
+          }
+        }
+      }
+    }
+    line++;
+    if(!end) break;
+    start = end + 1;
+  }
+}
@@ -0,0 +1,501 @@
+// ================================
+//  ヘッドレス実行ハーネス
+// ================================
+// アプリの main() を -Dmain=pbl_app_main で改名してリンクし、
+// app_event_loop() の中で仮想時計を進めながら入力とサービスを流す。
+// 再描画のたびに描画統計とフレームハッシュを出し、終了時に合計を出す。
+#include "host.h"
+#include <getopt.h>
+#include <strings.h>
+
+#undef time
+#undef localtime
+#undef main
+
+int pbl_app_main(void);
+
+HostTotals g_host_totals;
+
+// ------------------------------
+// 入力スクリプト
+// ------------------------------
+typedef enum {
+  INPUT_PRESS,        // ボタンを押して離す
+  INPUT_HOLD,         // 押しっぱなし（展開して下の各種に分解する）
+  INPUT_CLICK,        // 展開済みのクリック（HostClickKind）
+  INPUT_REPEAT,       // 押している間のリピート
+  INPUT_TAP,
+  INPUT_BATTERY,
+  INPUT_FOCUS,
+  INPUT_INBOX,        // 電話からの AppMessage
+} InputKind;
+
+typedef struct {
+  int64_t at_ms;      // 開始からの相対時刻
+  InputKind kind;
+  ButtonId button;
+  int64_t duration_ms;
+  int value;
+  const char *text;   // INPUT_INBOX の "name=value,..."（argv を指す）
+  uint32_t seq;       // 同時刻の順序を保つ
+} InputEvent;
+
+#define MAX_INPUTS 4096
+
+static InputEvent s_inputs[MAX_INPUTS];
+static int s_input_count;
+static uint32_t s_input_seq;
+static int64_t s_start_ms;
+
+static int input_compare(const void *a, const void *b) {
+  const InputEvent *x = a, *y = b;
+  if(x->at_ms != y->at_ms) return x->at_ms < y->at_ms ? -1 : 1;
+  return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+static void input_add(InputEvent event) {
+  if(s_input_count == MAX_INPUTS) {
+    fprintf(stderr, "too many input events\n");
+    exit(2);
+  }
+  event.seq = s_input_seq++;
+  s_inputs[s_input_count++] = event;
+  qsort(s_inputs, s_input_count, sizeof(InputEvent), input_compare);
+}
+
+static InputEvent input_pop(void) {
+  InputEvent event = s_inputs[0];
+  memmove(&s_inputs[0], &s_inputs[1], (--s_input_count) * sizeof(InputEvent));
+  return event;
+}
+
+static bool parse_button(const char *name, ButtonId *out) {
+  static const char *const names[NUM_BUTTONS] = { "back", "up", "select", "down" };
+  for(int i = 0; i < NUM_BUTTONS; i++) {
+    if(strcasecmp(name, names[i]) == 0) {
+      *out = (ButtonId)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// "NAME@MS" / "NAME@MS+DUR" / "@MS" / "@MS+DUR" / "VALUE@MS"
+static bool parse_at(const char *arg, char *name, size_t name_size, int64_t *at_ms,
+                     int64_t *duration_ms) {
+  const char *at = strchr(arg, '@');
+  if(!at) return false;
+  size_t len = MIN((size_t)(at - arg), name_size - 1);
+  memcpy(name, arg, len);
+  name[len] = '\0';
+  char *end;
+  *at_ms = strtoll(at + 1, &end, 10);
+  *duration_ms = (*end == '+') ? strtoll(end + 1, &end, 10) : 0;
+  return *end == '\0';
+}
+
+// ボタンを押し続けたときの SDK の振る舞いを、押した瞬間の購読状態から組み立てる
+static void expand_hold(ButtonId button, int64_t at_ms, int64_t duration_ms) {
+  const HostButtonConfig *config = host_button_config(button);
+  InputEvent click = { .kind = INPUT_CLICK, .button = button };
+
+  if(config->raw_down) {
+    click.at_ms = at_ms;
+    click.value = HOST_CLICK_RAW_DOWN;
+    input_add(click);
+  }
+  if(config->long_down || config->long_up) {
+    if(duration_ms >= config->long_delay_ms) {
+      click.at_ms = at_ms + config->long_delay_ms;
+      click.value = HOST_CLICK_LONG_DOWN;
+      input_add(click);
+      click.at_ms = at_ms + duration_ms;
+      click.value = HOST_CLICK_LONG_UP;
+      input_add(click);
+    } else {
+      click.at_ms = at_ms + duration_ms;
+      click.value = HOST_CLICK_SINGLE;
+      input_add(click);
+    }
+  } else if(config->repeat_ms) {
+    // 押した瞬間に 1 回、その後は最初の 500ms 以降リピート間隔ごと
+    click.at_ms = at_ms;
+    click.value = HOST_CLICK_SINGLE;
+    input_add(click);
+    for(int64_t t = 500; t <= duration_ms; t += config->repeat_ms) {
+      click.at_ms = at_ms + t;
+      click.value = HOST_CLICK_REPEAT;
+      input_add(click);
+    }
+  } else {
+    click.at_ms = at_ms + duration_ms;
+    click.value = HOST_CLICK_SINGLE;
+    input_add(click);
+  }
+  if(config->raw_up) {
+    click.at_ms = at_ms + duration_ms;
+    click.value = HOST_CLICK_RAW_UP;
+    input_add(click);
+  }
+}
+
+static void dispatch_input(InputEvent event) {
+  switch(event.kind) {
+    case INPUT_PRESS:
+    case INPUT_HOLD:
+      expand_hold(event.button, event.at_ms, event.duration_ms);
+      break;
+    case INPUT_CLICK:
+    case INPUT_REPEAT:
+      g_host_totals.wakeups++;
+      g_host_totals.input_events++;
+      host_button_fire(event.button, (HostClickKind)event.value);
+      break;
+    case INPUT_TAP:
+      host_accel_tap();
+      break;
+    case INPUT_BATTERY:
+      host_set_battery((uint8_t)event.value, false);
+      break;
+    case INPUT_FOCUS:
+      host_set_focus(event.value != 0);
+      break;
+    case INPUT_INBOX:
+      if(!host_app_message_receive(event.text)) {
+        fprintf(stderr, "bad message (unknown key or value): %s\n", event.text);
+        exit(2);
+      }
+      break;
+  }
+}
+
+// ------------------------------
+// フレーム記録
+// ------------------------------
+static bool s_quiet;
+static const char *s_png_dir;
+static const char *s_golden_path;
+static bool s_golden_update;
+static FILE *s_golden_out;
+static FILE *s_golden_in;
+static int s_golden_mismatches;
+static uint32_t s_frame_index;
+
+static void record_frame(void) {
+  uint32_t hash = host_frame_hash();
+  int64_t t = g_host_now_ms - s_start_ms;
+
+  if(!s_quiet) {
+    printf("frame %u t=%lld draw_calls=%llu pixels=%llu fb_direct=%llu fb_written=%llu "
+           "render_us=%.1f hash=%08x\n",
+           s_frame_index, (long long)t, (unsigned long long)g_host_frame.draw_calls,
+           (unsigned long long)g_host_frame.pixels,
+           (unsigned long long)g_host_frame.fb_direct_pixels,
+           (unsigned long long)g_host_frame.fb_written_pixels,
+           g_host_frame.render_ns / 1e3, hash);
+  }
+  if(s_png_dir) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame_%05u.png", s_png_dir, s_frame_index);
+    if(!host_write_png(path, host_frame_buffer())) fprintf(stderr, "cannot write %s\n", path);
+  }
+  if(s_golden_out) fprintf(s_golden_out, "%lld %08x\n", (long long)t, hash);
+  if(s_golden_in) {
+    long long expected_t;
+    unsigned expected_hash;
+    if(fscanf(s_golden_in, "%lld %x", &expected_t, &expected_hash) != 2 ||
+       expected_t != t || expected_hash != hash) {
+      if(!s_golden_mismatches) {
+        fprintf(stderr, "golden mismatch at frame %u (t=%lld hash=%08x)\n", s_frame_index,
+                (long long)t, hash);
+      }
+      s_golden_mismatches++;
+    }
+  }
+  s_frame_index++;
+}
+
+// ------------------------------
+// イベントループ
+// ------------------------------
+void app_event_loop(void) {
+  if(host_render_if_dirty()) record_frame();
+
+  while(!g_host_exit && host_has_window()) {
+    int64_t next = host_next_service_event();
+    if(s_input_count && s_start_ms + s_inputs[0].at_ms < next) {
+      next = s_start_ms + s_inputs[0].at_ms;
+    }
+    if(next > g_host_end_ms) break;
+    if(next > g_host_now_ms) g_host_now_ms = next;
+
+    while(s_input_count && s_start_ms + s_inputs[0].at_ms <= g_host_now_ms && !g_host_exit) {
+      dispatch_input(input_pop());
+    }
+    host_dispatch_services();
+    if(host_render_if_dirty()) record_frame();
+  }
+  g_host_now_ms = MAX(g_host_now_ms, g_host_end_ms);
+}
+
+// ------------------------------
+// main
+// ------------------------------
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --start TIME          開始時刻 (YYYY-MM-DDTHH:MM:SS, UTC) 既定 2024-01-01T09:59:30\n"
+          "  --seconds N           N 秒ぶん実行 (既定 60)\n"
+          "  --simulate-24h        24 時間ぶん実行\n"
+          "  --press NAME@MS       ボタンを押して離す (back/up/select/down)\n"
+          "  --hold NAME@MS+DUR    DUR ミリ秒押し続ける\n"
+          "  --tap @MS             手首フリック\n"
+          "  --accel FILE          加速度データを FILE のトレース（t_ms x y z）から流す\n"
+          "  --launch REASON       起動理由 (user/wakeup/worker/phone/quick_launch) 既定 user\n"
+          "  --busy-wakeup @MS     ほかのアプリがその時刻に wakeup を予約している\n"
+          "  --battery PCT@MS      バッテリー残量の変化\n"
+          "  --notify @MS+DUR      通知でフォーカスを DUR ミリ秒失う\n"
+          "  --inbox K=V,...@MS    電話から AppMessage を 1 通受け取る（K は messageKeys の名前、\n"
+          "                        V は整数か [16 進のバイト列]）\n"
+          "  --phone               電話が繋がっている（送信は届く。既定は NOT_CONNECTED）\n"
+          "  --png DIR             フレームごとに PNG を書き出す\n"
+          "  --golden FILE         フレームハッシュを FILE と比較する\n"
+          "  --update-golden FILE  フレームハッシュを FILE に書く\n"
+          "  --persist FILE        永続化ストレージを FILE から読み、終了時に書く\n"
+          "  --quiet               フレームごとの行を出さない\n"
+          "  --verbose             APP_LOG とバイブを表示する\n",
+          argv0);
+}
+
+static bool parse_start(const char *arg, int64_t *out_ms) {
+  struct tm tm = { 0 };
+  const char *end = strptime(arg, "%Y-%m-%dT%H:%M:%S", &tm);
+  if(!end || *end) return false;
+  *out_ms = (int64_t)timegm(&tm) * 1000;
+  return true;
+}
+
+static bool parse_launch_reason(const char *arg) {
+  static const struct { const char *name; AppLaunchReason reason; } REASONS[] = {
+    { "user", APP_LAUNCH_USER },
+    { "wakeup", APP_LAUNCH_WAKEUP },
+    { "worker", APP_LAUNCH_WORKER },
+    { "phone", APP_LAUNCH_PHONE },
+    { "quick_launch", APP_LAUNCH_QUICK_LAUNCH },
+  };
+  for(size_t i = 0; i < sizeof(REASONS) / sizeof(REASONS[0]); i++) {
+    if(strcasecmp(arg, REASONS[i].name) == 0) {
+      host_set_launch_reason(REASONS[i].reason);
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  enum {
+    OPT_START = 256, OPT_SECONDS, OPT_24H, OPT_PRESS, OPT_HOLD, OPT_TAP, OPT_ACCEL, OPT_LAUNCH,
+    OPT_BUSY_WAKEUP, OPT_BATTERY, OPT_NOTIFY, OPT_INBOX, OPT_PHONE, OPT_PNG, OPT_GOLDEN,
+    OPT_UPDATE_GOLDEN, OPT_PERSIST, OPT_QUIET, OPT_VERBOSE,
+  };
+  static const struct option options[] = {
+    { "start", required_argument, NULL, OPT_START },
+    { "seconds", required_argument, NULL, OPT_SECONDS },
+    { "simulate-24h", no_argument, NULL, OPT_24H },
+    { "press", required_argument, NULL, OPT_PRESS },
+    { "hold", required_argument, NULL, OPT_HOLD },
+    { "tap", required_argument, NULL, OPT_TAP },
+    { "accel", required_argument, NULL, OPT_ACCEL },
+    { "launch", required_argument, NULL, OPT_LAUNCH },
+    { "busy-wakeup", required_argument, NULL, OPT_BUSY_WAKEUP },
+    { "battery", required_argument, NULL, OPT_BATTERY },
+    { "notify", required_argument, NULL, OPT_NOTIFY },
+    { "inbox", required_argument, NULL, OPT_INBOX },
+    { "phone", no_argument, NULL, OPT_PHONE },
+    { "png", required_argument, NULL, OPT_PNG },
+    { "golden", required_argument, NULL, OPT_GOLDEN },
+    { "update-golden", required_argument, NULL, OPT_UPDATE_GOLDEN },
+    { "persist", required_argument, NULL, OPT_PERSIST },
+    { "quiet", no_argument, NULL, OPT_QUIET },
+    { "verbose", no_argument, NULL, OPT_VERBOSE },
+    { NULL, 0, NULL, 0 },
+  };
+
+  setenv("TZ", "UTC", 1);
+  tzset();
+
+  int64_t start_ms = (int64_t)1704103170 * 1000;  // 2024-01-01T09:59:30Z
+  int64_t run_ms = 60 * 1000;
+  const char *persist_path = NULL;
+  const char *accel_path = NULL;
+  enum { MAX_BUSY_WAKEUPS = 8 };
+  int64_t busy_wakeups[MAX_BUSY_WAKEUPS];
+  int busy_wakeup_count = 0;
+  char name[32];
+  int64_t at_ms, duration_ms;
+  int opt;
+
+  while((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    InputEvent event = { 0 };
+    switch(opt) {
+      case OPT_START:
+        if(!parse_start(optarg, &start_ms)) goto bad_arg;
+        break;
+      case OPT_SECONDS:
+        run_ms = strtoll(optarg, NULL, 10) * 1000;
+        break;
+      case OPT_24H:
+        run_ms = (int64_t)24 * 60 * 60 * 1000;
+        break;
+      case OPT_PRESS:
+      case OPT_HOLD:
+        if(!parse_at(optarg, name, sizeof(name), &at_ms, &duration_ms)) goto bad_arg;
+        if(!parse_button(name, &event.button)) goto bad_arg;
+        event.kind = (opt == OPT_PRESS) ? INPUT_PRESS : INPUT_HOLD;
+        event.at_ms = at_ms;
+        event.duration_ms = duration_ms;
+        input_add(event);
+        break;
+      case OPT_TAP:
+        if(!parse_at(optarg, name, sizeof(name), &at_ms, &duration_ms)) goto bad_arg;
+        event.kind = INPUT_TAP;
+        event.at_ms = at_ms;
+        input_add(event);
+        break;
+      case OPT_ACCEL:
+        accel_path = optarg;
+        break;
+      case OPT_LAUNCH:
+        if(!parse_launch_reason(optarg)) goto bad_arg;
+        break;
+      case OPT_BUSY_WAKEUP:
+        if(!parse_at(optarg, name, sizeof(name), &at_ms, &duration_ms)) goto bad_arg;
+        if(busy_wakeup_count < MAX_BUSY_WAKEUPS) busy_wakeups[busy_wakeup_count++] = at_ms;
+        break;
+      case OPT_BATTERY:
+        if(!parse_at(optarg, name, sizeof(name), &at_ms, &duration_ms)) goto bad_arg;
+        event.kind = INPUT_BATTERY;
+        event.at_ms = at_ms;
+        event.value = atoi(name);
+        input_add(event);
+        break;
+      case OPT_NOTIFY:
+        if(!parse_at(optarg, name, sizeof(name), &at_ms, &duration_ms)) goto bad_arg;
+        event.kind = INPUT_FOCUS;
+        event.at_ms = at_ms;
+        event.value = 0;
+        input_add(event);
+        event.at_ms = at_ms + duration_ms;
+        event.value = 1;
+        input_add(event);
+        break;
+      case OPT_INBOX: {
+        // 中身は長くなるので parse_at を通さず、最後の '@' で分ける
+        char *at = strrchr(optarg, '@');
+        if(!at || at == optarg) goto bad_arg;
+        *at = '\0';
+        event.kind = INPUT_INBOX;
+        event.at_ms = strtoll(at + 1, NULL, 10);
+        event.text = optarg;
+        input_add(event);
+        break;
+      }
+      case OPT_PHONE:
+        g_host_phone_connected = true;
+        break;
+      case OPT_PNG:
+        s_png_dir = optarg;
+        break;
+      case OPT_GOLDEN:
+        s_golden_path = optarg;
+        s_golden_update = false;
+        break;
+      case OPT_UPDATE_GOLDEN:
+        s_golden_path = optarg;
+        s_golden_update = true;
+        break;
+      case OPT_PERSIST:
+        persist_path = optarg;
+        break;
+      case OPT_QUIET:
+        s_quiet = true;
+        break;
+      case OPT_VERBOSE:
+        g_host_verbose = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 2;
+    }
+    continue;
+bad_arg:
+    fprintf(stderr, "bad argument: %s\n", optarg);
+    return 2;
+  }
+
+  if(s_golden_path) {
+    s_golden_out = s_golden_update ? fopen(s_golden_path, "w") : NULL;
+    s_golden_in = s_golden_update ? NULL : fopen(s_golden_path, "r");
+    if(!s_golden_out && !s_golden_in) {
+      fprintf(stderr, "cannot open %s\n", s_golden_path);
+      return 2;
+    }
+  }
+  if(persist_path) host_persist_load(persist_path);
+
+  s_start_ms = start_ms;
+  g_host_now_ms = start_ms;
+  g_host_end_ms = start_ms + run_ms;
+  host_graphics_init();
+  host_register_resources();
+  for(int i = 0; i < busy_wakeup_count; i++) {
+    host_add_foreign_wakeup((time_t)((start_ms + busy_wakeups[i]) / 1000));
+  }
+  if(accel_path && !host_load_accel_trace(accel_path)) {
+    fprintf(stderr, "cannot open %s\n", accel_path);
+    return 2;
+  }
+
+  pbl_app_main();
+
+  if(persist_path) host_persist_save(persist_path);
+
+  if(s_golden_in) {
+    long long extra_t;
+    unsigned extra_hash;
+    if(fscanf(s_golden_in, "%lld %x", &extra_t, &extra_hash) == 2) s_golden_mismatches++;
+    fclose(s_golden_in);
+  }
+  if(s_golden_out) fclose(s_golden_out);
+
+  double hours = (double)run_ms / (60 * 60 * 1000);
+  printf("summary seconds=%lld frames=%u wakeups=%llu (%.1f/h) ticks=%llu timers=%llu "
+         "inputs=%llu accel=%llu anim_frames=%llu redraws=%llu draw_calls=%llu pixels=%llu "
+         "fb_direct=%llu fb_written=%llu render_ms=%.3f motor_on_ms=%llu persist_writes=%llu persist_bytes=%llu "
+         "messages_in=%llu messages_out=%llu\n",
+         (long long)(run_ms / 1000), s_frame_index,
+         (unsigned long long)g_host_totals.wakeups, g_host_totals.wakeups / hours,
+         (unsigned long long)g_host_totals.tick_events,
+         (unsigned long long)g_host_totals.timer_events,
+         (unsigned long long)g_host_totals.input_events,
+         (unsigned long long)g_host_totals.accel_events,
+         (unsigned long long)g_host_totals.animation_frames,
+         (unsigned long long)g_host_totals.redraws,
+         (unsigned long long)g_host_totals.draw_calls,
+         (unsigned long long)g_host_totals.pixels,
+         (unsigned long long)g_host_totals.fb_direct_pixels,
+         (unsigned long long)g_host_totals.fb_written_pixels,
+         g_host_totals.render_ns / 1e6,
+         (unsigned long long)g_host_totals.motor_on_ms,
+         (unsigned long long)g_host_totals.persist_writes,
+         (unsigned long long)g_host_totals.persist_bytes,
+         (unsigned long long)g_host_totals.messages_in,
+         (unsigned long long)g_host_totals.messages_out);
+
+  if(s_golden_mismatches) {
+    fprintf(stderr, "golden: %d frame(s) differ from %s\n", s_golden_mismatches,
+            s_golden_path);
+    return 1;
+  }
+  return 0;
+}
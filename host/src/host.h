@@ -0,0 +1,147 @@
+#pragma once
+// ================================
+//  ホストハーネス内部ヘッダ
+// ================================
+// pebble.h スタブの型の中身と、ハーネス各ファイルが共有する状態。
+// アプリのコードからは見えない。
+#include <pebble.h>
+
+// ------------------------------
+// 画面
+// ------------------------------
+#define HOST_SCREEN_W PBL_DISPLAY_WIDTH
+#define HOST_SCREEN_H PBL_DISPLAY_HEIGHT
+
+// ------------------------------
+// ビットマップ / 描画コンテキスト
+// ------------------------------
+struct GBitmap {
+  uint8_t *data;
+  uint16_t row_size_bytes;
+  GBitmapFormat format;
+  GRect bounds;           // data 内の有効範囲（サブビットマップ用）
+  GColor *palette;
+  bool owns_data;
+  bool owns_palette;
+};
+
+struct GContext {
+  GBitmap *fb;
+  GRect draw_box;         // 現在のレイヤーの描画原点（画面座標）と大きさ
+  GRect clip_box;         // 画面座標のクリップ
+  GColor fill_color;
+  GColor stroke_color;
+  GColor text_color;
+  uint8_t stroke_width;
+  GCompOp comp_op;
+  bool captured;
+};
+
+struct FontInfo {
+  const char *key;
+  int size;
+};
+
+GContext *host_graphics_context(void);
+GBitmap *host_frame_buffer(void);
+void host_graphics_init(void);
+GColor host_bitmap_get_pixel(const GBitmap *bitmap, int x, int y);
+uint32_t host_frame_hash(void);
+
+// ------------------------------
+// 統計
+// ------------------------------
+typedef struct {
+  uint64_t draw_calls;
+  uint64_t pixels;          // SDK 呼び出しで書いた画素
+  uint64_t fb_direct_pixels; // フレームバッファ直接書き込みで変わった画素
+  uint64_t fb_written_pixels; // span_fill が直接書いた画素（変わらなくても数える）
+  uint64_t render_ns;       // update proc の実時間（ホストの CPU。数えるための処理は除く）
+  uint64_t accounting_ns;   // そのうち fb_direct を数えるのに使った時間
+} HostFrameStats;
+
+typedef struct {
+  uint64_t wakeups;         // アプリに届いたイベント（tick/タイマー/ボタン/センサ…）
+  uint64_t tick_events;
+  uint64_t timer_events;
+  uint64_t input_events;
+  uint64_t accel_events;    // 加速度データのバッチ
+  uint64_t animation_frames;
+  uint64_t redraws;
+  uint64_t draw_calls;
+  uint64_t pixels;
+  uint64_t fb_direct_pixels;
+  uint64_t fb_written_pixels;
+  uint64_t render_ns;
+  uint64_t motor_on_ms;
+  uint64_t persist_writes;
+  uint64_t persist_bytes;
+  uint64_t messages_in;     // 電話から届いた AppMessage
+  uint64_t messages_out;    // 電話へ送ろうとした AppMessage
+} HostTotals;
+
+extern HostFrameStats g_host_frame;
+extern HostTotals g_host_totals;
+
+void host_count_draw_call(void);
+uint64_t host_cpu_ns(void);
+
+// ------------------------------
+// UI（ウィンドウ・レイヤー・ボタン）
+// ------------------------------
+typedef struct {
+  ClickHandler single;
+  uint16_t repeat_ms;        // 0 = リピートなし
+  ClickHandler multi;
+  ClickHandler long_down;
+  ClickHandler long_up;
+  uint16_t long_delay_ms;
+  ClickHandler raw_down;
+  ClickHandler raw_up;
+  void *raw_context;
+} HostButtonConfig;
+
+typedef enum {
+  HOST_CLICK_SINGLE,
+  HOST_CLICK_REPEAT,
+  HOST_CLICK_LONG_DOWN,
+  HOST_CLICK_LONG_UP,
+  HOST_CLICK_RAW_DOWN,
+  HOST_CLICK_RAW_UP,
+} HostClickKind;
+
+bool host_render_if_dirty(void);
+bool host_has_window(void);
+void host_mark_dirty(void);
+const HostButtonConfig *host_button_config(ButtonId button);
+void host_button_fire(ButtonId button, HostClickKind kind);
+
+// ------------------------------
+// 仮想クロックとイベント
+// ------------------------------
+extern int64_t g_host_now_ms;
+extern int64_t g_host_end_ms;
+extern bool g_host_exit;
+extern bool g_host_verbose;
+extern bool g_host_phone_connected;   // --phone: 送信が電話に届く
+
+int64_t host_next_service_event(void);
+void host_dispatch_services(void);
+void host_set_battery(uint8_t percent, bool charging);
+void host_set_focus(bool in_focus);
+void host_accel_tap(void);
+bool host_load_accel_trace(const char *path);
+void host_set_launch_reason(AppLaunchReason reason);
+void host_add_foreign_wakeup(time_t timestamp);
+bool host_persist_load(const char *path);
+bool host_persist_save(const char *path);
+void host_set_resource_file(uint32_t resource_id, const char *path);
+void host_set_message_key(const char *name, uint32_t key);
+bool host_app_message_receive(const char *spec);
+// アプリの package.json から生成した表（build/<platform>/gen/<app>/resources.auto.c）
+void host_register_resources(void);
+
+// ------------------------------
+// PNG
+// ------------------------------
+bool host_write_png(const char *path, const GBitmap *fb);
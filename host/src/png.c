@@ -0,0 +1,117 @@
+// ================================
+//  PNG 書き出し
+// ================================
+// 依存ライブラリなしで済むよう、無圧縮 deflate（stored ブロック）で
+// RGB の PNG を書く。スクリーンショット確認用なのでサイズは気にしない。
+#include "host.h"
+
+static uint32_t s_crc_table[256];
+
+static void crc_init(void) {
+  if(s_crc_table[1]) return;
+  for(uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for(int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    s_crc_table[n] = c;
+  }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t len) {
+  for(size_t i = 0; i < len; i++) crc = s_crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+static void put_be32(uint8_t *out, uint32_t value) {
+  out[0] = value >> 24;
+  out[1] = value >> 16;
+  out[2] = value >> 8;
+  out[3] = value;
+}
+
+static void write_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t len) {
+  uint8_t header[8];
+  put_be32(header, len);
+  memcpy(header + 4, type, 4);
+  fwrite(header, 1, 8, file);
+  if(len) fwrite(data, 1, len, file);
+
+  uint32_t crc = crc_update(0xffffffffu, (const uint8_t *)type, 4);
+  crc = crc_update(crc, data, len) ^ 0xffffffffu;
+  uint8_t trailer[4];
+  put_be32(trailer, crc);
+  fwrite(trailer, 1, 4, file);
+}
+
+bool host_write_png(const char *path, const GBitmap *fb) {
+  crc_init();
+  int w = fb->bounds.size.w;
+  int h = fb->bounds.size.h;
+
+  // フィルタバイト 0 + RGB の生データ
+  size_t raw_row = 1 + (size_t)w * 3;
+  size_t raw_size = raw_row * h;
+  uint8_t *raw = malloc(raw_size);
+  if(!raw) return false;
+  for(int y = 0; y < h; y++) {
+    uint8_t *row = raw + y * raw_row;
+    row[0] = 0;
+    for(int x = 0; x < w; x++) {
+      GColor c = host_bitmap_get_pixel(fb, x, y);
+      row[1 + x * 3 + 0] = c.r * 85;
+      row[1 + x * 3 + 1] = c.g * 85;
+      row[1 + x * 3 + 2] = c.b * 85;
+    }
+  }
+
+  // zlib ヘッダ + stored ブロック（最大 65535 バイトずつ）+ Adler-32
+  size_t blocks = (raw_size + 65534) / 65535;
+  size_t z_size = 2 + raw_size + blocks * 5 + 4;
+  uint8_t *z = malloc(z_size);
+  if(!z) {
+    free(raw);
+    return false;
+  }
+  size_t pos = 0;
+  z[pos++] = 0x78;
+  z[pos++] = 0x01;
+  uint32_t a = 1, b = 0;
+  for(size_t off = 0; off < raw_size; off += 65535) {
+    uint16_t len = (uint16_t)MIN(65535, raw_size - off);
+    z[pos++] = (off + len == raw_size) ? 1 : 0;
+    z[pos++] = len & 0xff;
+    z[pos++] = len >> 8;
+    z[pos++] = ~len & 0xff;
+    z[pos++] = (~len >> 8) & 0xff;
+    memcpy(z + pos, raw + off, len);
+    pos += len;
+    for(size_t i = 0; i < len; i++) {
+      a = (a + raw[off + i]) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+  put_be32(z + pos, (b << 16) | a);
+  pos += 4;
+
+  FILE *file = fopen(path, "wb");
+  if(!file) {
+    free(raw);
+    free(z);
+    return false;
+  }
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  fwrite(signature, 1, 8, file);
+  uint8_t ihdr[13];
+  put_be32(ihdr, w);
+  put_be32(ihdr + 4, h);
+  ihdr[8] = 8;   // ビット深度
+  ihdr[9] = 2;   // RGB
+  ihdr[10] = ihdr[11] = ihdr[12] = 0;
+  write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+  write_chunk(file, "IDAT", z, (uint32_t)pos);
+  write_chunk(file, "IEND", NULL, 0);
+  fclose(file);
+
+  free(raw);
+  free(z);
+  return true;
+}
@@ -0,0 +1,1170 @@
+// ================================
+//  仮想クロックとシステムサービス
+// ================================
+// 時刻はすべて g_host_now_ms（UNIX 時間のミリ秒）で進む。
+// tick / タイマー / アニメーション / バイブは次の発火時刻を
+// host_next_service_event() で返し、harness.c のループがそこまで時計を進める。
+#include "host.h"
+#include <ctype.h>
+#include <stdarg.h>
+
+#undef time
+#undef localtime
+
+int64_t g_host_now_ms;
+int64_t g_host_end_ms;
+bool g_host_exit;
+bool g_host_verbose;
+bool g_host_phone_connected;
+
+#define NO_EVENT INT64_MAX
+#define ANIMATION_FRAME_MS 33
+
+// ------------------------------
+// 時刻
+// ------------------------------
+time_t pbl_host_time(time_t *tloc) {
+  time_t now = (time_t)(g_host_now_ms / 1000);
+  if(tloc) *tloc = now;
+  return now;
+}
+
+struct tm *pbl_host_localtime(const time_t *timep) {
+  static struct tm s_tm;
+  localtime_r(timep, &s_tm);
+  return &s_tm;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  uint16_t ms = (uint16_t)(g_host_now_ms % 1000);
+  pbl_host_time(tloc);
+  if(out_ms) *out_ms = ms;
+  return ms;
+}
+
+bool clock_is_24h_style(void) {
+  return true;
+}
+
+void psleep(int millis) {
+  g_host_now_ms += millis;
+}
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number,
+             const char *fmt, ...) {
+  if(!g_host_verbose) return;
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "[%lld] %s:%d ", (long long)g_host_now_ms, src_filename, src_line_number);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+// ------------------------------
+// tick
+// ------------------------------
+static TickHandler s_tick_handler;
+static TimeUnits s_tick_units;
+static int64_t s_tick_next_ms = NO_EVENT;
+static struct tm s_tick_last;
+
+static int64_t next_second_boundary(int64_t now_ms) {
+  return (now_ms / 1000 + 1) * 1000;
+}
+
+static int64_t next_tick_ms(void) {
+  int64_t next = next_second_boundary(g_host_now_ms);
+  if(s_tick_units & SECOND_UNIT) return next;
+
+  // 秒以外は分境界ごとに調べれば十分（時・日…は分の繰り上がりで起きる）
+  return ((g_host_now_ms / 60000) + 1) * 60000;
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  s_tick_handler = handler;
+  s_tick_units = tick_units;
+  time_t now = pbl_host_time(NULL);
+  localtime_r(&now, &s_tick_last);
+  s_tick_next_ms = next_tick_ms();
+}
+
+void tick_timer_service_unsubscribe(void) {
+  s_tick_handler = NULL;
+  s_tick_units = 0;
+  s_tick_next_ms = NO_EVENT;
+}
+
+static void fire_tick(void) {
+  time_t now = pbl_host_time(NULL);
+  struct tm tick;
+  localtime_r(&now, &tick);
+
+  TimeUnits changed = 0;
+  if(tick.tm_sec != s_tick_last.tm_sec) changed |= SECOND_UNIT;
+  if(tick.tm_min != s_tick_last.tm_min) changed |= MINUTE_UNIT;
+  if(tick.tm_hour != s_tick_last.tm_hour) changed |= HOUR_UNIT;
+  if(tick.tm_mday != s_tick_last.tm_mday) changed |= DAY_UNIT;
+  if(tick.tm_mon != s_tick_last.tm_mon) changed |= MONTH_UNIT;
+  if(tick.tm_year != s_tick_last.tm_year) changed |= YEAR_UNIT;
+  s_tick_last = tick;
+  s_tick_next_ms = next_tick_ms();
+
+  if(!(changed & s_tick_units) || !s_tick_handler) return;
+  g_host_totals.wakeups++;
+  g_host_totals.tick_events++;
+  s_tick_handler(&tick, changed);
+}
+
+// ------------------------------
+// アプリタイマー
+// ------------------------------
+struct AppTimer {
+  int64_t due_ms;
+  AppTimerCallback callback;
+  void *data;
+  AppTimer *next;
+};
+
+static AppTimer *s_timers;
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback,
+                             void *callback_data) {
+  AppTimer *timer = calloc(1, sizeof(AppTimer));
+  if(!timer) return NULL;
+  timer->due_ms = g_host_now_ms + timeout_ms;
+  timer->callback = callback;
+  timer->data = callback_data;
+  timer->next = s_timers;
+  s_timers = timer;
+  return timer;
+}
+
+static bool timer_is_live(AppTimer *timer) {
+  for(AppTimer *t = s_timers; t; t = t->next) {
+    if(t == timer) return true;
+  }
+  return false;
+}
+
+bool app_timer_reschedule(AppTimer *timer, uint32_t new_timeout_ms) {
+  if(!timer_is_live(timer)) return false;
+  timer->due_ms = g_host_now_ms + new_timeout_ms;
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer) {
+  for(AppTimer **link = &s_timers; *link; link = &(*link)->next) {
+    if(*link == timer) {
+      *link = timer->next;
+      free(timer);
+      return;
+    }
+  }
+}
+
+static AppTimer *earliest_timer(void) {
+  AppTimer *best = NULL;
+  for(AppTimer *t = s_timers; t; t = t->next) {
+    if(!best || t->due_ms < best->due_ms) best = t;
+  }
+  return best;
+}
+
+static void fire_timer(AppTimer *timer) {
+  AppTimerCallback callback = timer->callback;
+  void *data = timer->data;
+  app_timer_cancel(timer);
+  g_host_totals.wakeups++;
+  g_host_totals.timer_events++;
+  callback(data);
+}
+
+// ------------------------------
+// バイブ
+// ------------------------------
+// モーターが回っている時間だけを数える（パターンの休止は含まない）
+static int64_t s_vibe_start_ms;
+static int64_t s_vibe_end_ms;
+static int64_t s_vibe_counted_ms;
+
+static void vibe_enqueue(const uint32_t *durations, uint32_t num_segments) {
+  vibes_cancel();
+  int64_t at = g_host_now_ms;
+  int64_t on_ms = 0;
+  for(uint32_t i = 0; i < num_segments; i++) {
+    if(i % 2 == 0) on_ms += durations[i];
+    at += durations[i];
+  }
+  s_vibe_start_ms = g_host_now_ms;
+  s_vibe_end_ms = at;
+  s_vibe_counted_ms = on_ms;
+  g_host_totals.motor_on_ms += on_ms;
+  if(g_host_verbose) {
+    fprintf(stderr, "[%lld] vibe %u segments, motor %lld ms\n", (long long)g_host_now_ms,
+            num_segments, (long long)on_ms);
+  }
+}
+
+void vibes_cancel(void) {
+  if(s_vibe_end_ms <= g_host_now_ms) return;
+  // 打ち切られた分は概算で差し戻す
+  int64_t remaining = s_vibe_end_ms - g_host_now_ms;
+  int64_t refund = MIN(remaining / 2, s_vibe_counted_ms);
+  g_host_totals.motor_on_ms -= refund;
+  s_vibe_end_ms = g_host_now_ms;
+}
+
+void vibes_short_pulse(void) {
+  static const uint32_t segments[] = { 100 };
+  vibe_enqueue(segments, 1);
+}
+
+void vibes_long_pulse(void) {
+  static const uint32_t segments[] = { 500 };
+  vibe_enqueue(segments, 1);
+}
+
+void vibes_double_pulse(void) {
+  static const uint32_t segments[] = { 100, 100, 100 };
+  vibe_enqueue(segments, 3);
+}
+
+void vibes_enqueue_custom_pattern(VibePattern pattern) {
+  vibe_enqueue(pattern.durations, pattern.num_segments);
+}
+
+// ------------------------------
+// 加速度センサ
+// ------------------------------
+// データはバッチの間隔ごとにまとめて届ける（1 バッチで 1 回起こす）。
+// --accel のトレースがあればその値を、なければ文字盤を上にして置いた値を返す
+static AccelTapHandler s_tap_handler;
+static AccelDataHandler s_data_handler;
+static uint32_t s_accel_batch = 25;
+static uint32_t s_accel_rate = ACCEL_SAMPLING_25HZ;
+static int64_t s_accel_next_ms = NO_EVENT;
+
+typedef struct {
+  int64_t t_ms;       // トレースの先頭からの時刻
+  int16_t x, y, z;
+} TraceSample;
+
+static TraceSample *s_trace;
+static int s_trace_count;
+static int64_t s_trace_origin_ms;
+
+#define MAX_ACCEL_BATCH 25   // SDK と同じ上限
+
+static void accel_schedule(void) {
+  s_accel_next_ms = s_data_handler
+                  ? g_host_now_ms + (int64_t)s_accel_batch * 1000 / s_accel_rate
+                  : NO_EVENT;
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  s_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  s_tap_handler = NULL;
+}
+
+void accel_data_service_subscribe(uint32_t samples_per_update, AccelDataHandler handler) {
+  s_data_handler = handler;
+  accel_service_set_samples_per_update(samples_per_update);
+}
+
+void accel_data_service_unsubscribe(void) {
+  s_data_handler = NULL;
+  accel_schedule();
+}
+
+int accel_service_set_sampling_rate(AccelSamplingRate rate) {
+  s_accel_rate = rate;
+  accel_schedule();
+  return 0;
+}
+
+int accel_service_set_samples_per_update(uint32_t num_samples) {
+  s_accel_batch = MAX(1, MIN(num_samples, MAX_ACCEL_BATCH));
+  accel_schedule();
+  return 0;
+}
+
+// 1 行に「t_ms x y z」（mg）。# で始まる行は読み飛ばす
+bool host_load_accel_trace(const char *path) {
+  FILE *f = fopen(path, "r");
+  if(!f) return false;
+  int capacity = 0;
+  char line[256];
+  while(fgets(line, sizeof(line), f)) {
+    long long t;
+    int x, y, z;
+    if(line[0] == '#' || sscanf(line, "%lld %d %d %d", &t, &x, &y, &z) != 4) continue;
+    if(s_trace_count == capacity) {
+      capacity = capacity ? capacity * 2 : 4096;
+      s_trace = realloc(s_trace, capacity * sizeof(*s_trace));
+    }
+    s_trace[s_trace_count++] = (TraceSample){ t, x, y, z };
+  }
+  fclose(f);
+  s_trace_origin_ms = g_host_now_ms;
+  return true;
+}
+
+// その時刻の直前のサンプル（トレースの外は最初・最後の値を保つ）
+static AccelData accel_sample_at(int64_t at_ms) {
+  AccelData d = { .x = 0, .y = 0, .z = -1000 };
+  if(s_trace_count) {
+    int64_t t = at_ms - s_trace_origin_ms;
+    int lo = 0, hi = s_trace_count - 1;
+    while(lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      if(s_trace[mid].t_ms <= t) lo = mid;
+      else hi = mid - 1;
+    }
+    d.x = s_trace[lo].x;
+    d.y = s_trace[lo].y;
+    d.z = s_trace[lo].z;
+  }
+  d.did_vibrate = at_ms >= s_vibe_start_ms && at_ms < s_vibe_end_ms;
+  d.timestamp = (uint64_t)at_ms;
+  return d;
+}
+
+static void fire_accel_data(void) {
+  static AccelData batch[MAX_ACCEL_BATCH];
+  int64_t at = s_accel_next_ms;
+  for(uint32_t i = 0; i < s_accel_batch; i++) {
+    batch[i] = accel_sample_at(at - (int64_t)(s_accel_batch - 1 - i) * 1000 / s_accel_rate);
+  }
+  s_accel_next_ms = at + (int64_t)s_accel_batch * 1000 / s_accel_rate;
+
+  g_host_totals.wakeups++;
+  g_host_totals.accel_events++;
+  s_data_handler(batch, s_accel_batch);
+}
+
+void host_accel_tap(void) {
+  if(!s_tap_handler) return;
+  g_host_totals.wakeups++;
+  g_host_totals.input_events++;
+  s_tap_handler(ACCEL_AXIS_Z, 1);
+}
+
+// ------------------------------
+// バッテリー / フォーカス
+// ------------------------------
+static BatteryChargeState s_battery = { .charge_percent = 100 };
+static BatteryStateHandler s_battery_handler;
+static AppFocusHandlers s_focus_handlers;
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+  s_battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+  return s_battery;
+}
+
+void host_set_battery(uint8_t percent, bool charging) {
+  s_battery.charge_percent = percent;
+  s_battery.is_charging = charging;
+  s_battery.is_plugged = charging;
+  if(!s_battery_handler) return;
+  g_host_totals.wakeups++;
+  s_battery_handler(s_battery);
+}
+
+void app_focus_service_subscribe_handlers(AppFocusHandlers handlers) {
+  s_focus_handlers = handlers;
+}
+
+void app_focus_service_subscribe(AppFocusHandler handler) {
+  s_focus_handlers = (AppFocusHandlers){ .did_focus = handler };
+}
+
+void app_focus_service_unsubscribe(void) {
+  s_focus_handlers = (AppFocusHandlers){ 0 };
+}
+
+void host_set_focus(bool in_focus) {
+  if(s_focus_handlers.will_focus) s_focus_handlers.will_focus(in_focus);
+  if(s_focus_handlers.did_focus) s_focus_handlers.did_focus(in_focus);
+  g_host_totals.wakeups++;
+}
+
+// ------------------------------
+// 永続化
+// ------------------------------
+#define MAX_PERSIST_KEYS 256
+
+typedef struct {
+  uint32_t key;
+  uint16_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+static PersistEntry s_persist[MAX_PERSIST_KEYS];
+static int s_persist_count;
+
+static PersistEntry *persist_find(uint32_t key) {
+  for(int i = 0; i < s_persist_count; i++) {
+    if(s_persist[i].key == key) return &s_persist[i];
+  }
+  return NULL;
+}
+
+bool persist_exists(const uint32_t key) {
+  return persist_find(key) != NULL;
+}
+
+int persist_get_size(const uint32_t key) {
+  PersistEntry *entry = persist_find(key);
+  return entry ? entry->size : -1;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  PersistEntry *entry = persist_find(key);
+  if(!entry) return -1;
+  size_t size = MIN(buffer_size, entry->size);
+  memcpy(buffer, entry->data, size);
+  return (int)size;
+}
+
+bool persist_read_bool(const uint32_t key) {
+  bool value = false;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size) {
+  if(!buffer_size) return 0;
+  int read = persist_read_data(key, buffer, buffer_size);
+  if(read < 0) return read;
+  buffer[MIN((size_t)read, buffer_size - 1)] = '\0';
+  return read;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  if(size > PERSIST_DATA_MAX_LENGTH) return -1;
+  PersistEntry *entry = persist_find(key);
+  if(!entry) {
+    if(s_persist_count == MAX_PERSIST_KEYS) return -1;
+    entry = &s_persist[s_persist_count++];
+    entry->key = key;
+  }
+  entry->size = (uint16_t)size;
+  memcpy(entry->data, data, size);
+  g_host_totals.persist_writes++;
+  g_host_totals.persist_bytes += size;
+  return (int)size;
+}
+
+status_t persist_write_bool(const uint32_t key, const bool value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+status_t persist_write_int(const uint32_t key, const int32_t value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_write_string(const uint32_t key, const char *cstring) {
+  return persist_write_data(key, cstring, strlen(cstring) + 1);
+}
+
+status_t persist_delete(const uint32_t key) {
+  PersistEntry *entry = persist_find(key);
+  if(!entry) return -1;
+  *entry = s_persist[--s_persist_count];
+  return 0;
+}
+
+bool host_persist_load(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if(!file) return false;
+  PersistEntry entry;
+  s_persist_count = 0;
+  while(s_persist_count < MAX_PERSIST_KEYS &&
+        fread(&entry.key, sizeof(entry.key), 1, file) == 1 &&
+        fread(&entry.size, sizeof(entry.size), 1, file) == 1 &&
+        entry.size <= PERSIST_DATA_MAX_LENGTH &&
+        fread(entry.data, 1, entry.size, file) == entry.size) {
+    s_persist[s_persist_count++] = entry;
+  }
+  fclose(file);
+  return true;
+}
+
+bool host_persist_save(const char *path) {
+  FILE *file = fopen(path, "wb");
+  if(!file) return false;
+  for(int i = 0; i < s_persist_count; i++) {
+    fwrite(&s_persist[i].key, sizeof(s_persist[i].key), 1, file);
+    fwrite(&s_persist[i].size, sizeof(s_persist[i].size), 1, file);
+    fwrite(s_persist[i].data, 1, s_persist[i].size, file);
+  }
+  fclose(file);
+  return true;
+}
+
+// ------------------------------
+// リソース
+// ------------------------------
+#define MAX_RESOURCES 32
+
+typedef struct {
+  uint32_t id;
+  uint8_t *data;
+  size_t size;
+} HostResource;
+
+static HostResource s_resources[MAX_RESOURCES];
+static int s_resource_count;
+
+void host_set_resource_file(uint32_t resource_id, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if(!file || s_resource_count == MAX_RESOURCES) {
+    fprintf(stderr, "resource %u: cannot open %s\n", resource_id, path);
+    if(file) fclose(file);
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  HostResource *res = &s_resources[s_resource_count++];
+  res->id = resource_id;
+  res->size = (size_t)size;
+  res->data = malloc(res->size ? res->size : 1);
+  if(fread(res->data, 1, res->size, file) != res->size) res->size = 0;
+  fclose(file);
+}
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+  for(int i = 0; i < s_resource_count; i++) {
+    if(s_resources[i].id == resource_id) return &s_resources[i];
+  }
+  return NULL;
+}
+
+size_t resource_size(ResHandle h) {
+  return h ? ((const HostResource *)h)->size : 0;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer,
+                                size_t num_bytes) {
+  const HostResource *res = h;
+  if(!res || start_offset >= res->size) return 0;
+  size_t size = MIN(num_bytes, res->size - start_offset);
+  memcpy(buffer, res->data + start_offset, size);
+  return size;
+}
+
+size_t resource_load(ResHandle h, uint8_t *buffer, size_t max_length) {
+  return resource_load_byte_range(h, 0, buffer, max_length);
+}
+
+// ------------------------------
+// アニメーション
+// ------------------------------
+struct Animation {
+  uint32_t duration_ms;
+  uint32_t delay_ms;
+  AnimationCurve curve;
+  const AnimationImplementation *implementation;
+  AnimationHandlers handlers;
+  void *context;
+  bool scheduled;
+  int64_t start_ms;
+  int64_t next_frame_ms;
+  Animation *next;
+};
+
+static Animation *s_animations;
+
+Animation *animation_create(void) {
+  Animation *animation = calloc(1, sizeof(Animation));
+  if(animation) animation->duration_ms = 250;
+  return animation;
+}
+
+static void animation_unlink(Animation *animation) {
+  for(Animation **link = &s_animations; *link; link = &(*link)->next) {
+    if(*link == animation) {
+      *link = animation->next;
+      animation->next = NULL;
+      return;
+    }
+  }
+}
+
+bool animation_destroy(Animation *animation) {
+  if(!animation) return false;
+  animation_unlink(animation);
+  free(animation);
+  return true;
+}
+
+bool animation_set_duration(Animation *animation, uint32_t duration_ms) {
+  animation->duration_ms = duration_ms;
+  return true;
+}
+
+bool animation_set_delay(Animation *animation, uint32_t delay_ms) {
+  animation->delay_ms = delay_ms;
+  return true;
+}
+
+bool animation_set_curve(Animation *animation, AnimationCurve curve) {
+  animation->curve = curve;
+  return true;
+}
+
+bool animation_set_implementation(Animation *animation,
+                                  const AnimationImplementation *implementation) {
+  animation->implementation = implementation;
+  return true;
+}
+
+bool animation_set_handlers(Animation *animation, AnimationHandlers callbacks,
+                            void *context) {
+  animation->handlers = callbacks;
+  animation->context = context;
+  return true;
+}
+
+void *animation_get_context(Animation *animation) {
+  return animation->context;
+}
+
+bool animation_schedule(Animation *animation) {
+  if(animation->scheduled) animation_unschedule(animation);
+  animation->scheduled = true;
+  animation->start_ms = g_host_now_ms + animation->delay_ms;
+  animation->next_frame_ms = animation->start_ms;
+  animation->next = s_animations;
+  s_animations = animation;
+  if(animation->implementation && animation->implementation->setup) {
+    animation->implementation->setup(animation);
+  }
+  if(animation->handlers.started) animation->handlers.started(animation, animation->context);
+  return true;
+}
+
+// 止まったアニメーションは SDK と同じく自動で破棄する
+static void animation_finish(Animation *animation, bool finished) {
+  animation_unlink(animation);
+  animation->scheduled = false;
+  if(animation->handlers.stopped) {
+    animation->handlers.stopped(animation, finished, animation->context);
+  }
+  if(animation->implementation && animation->implementation->teardown) {
+    animation->implementation->teardown(animation);
+  }
+  free(animation);
+}
+
+bool animation_unschedule(Animation *animation) {
+  if(!animation || !animation->scheduled) return false;
+  animation_finish(animation, false);
+  return true;
+}
+
+bool animation_is_scheduled(Animation *animation) {
+  return animation && animation->scheduled;
+}
+
+static AnimationProgress curve_progress(AnimationCurve curve, uint32_t linear) {
+  uint64_t t = linear;
+  uint64_t max = ANIMATION_NORMALIZED_MAX;
+  switch(curve) {
+    case AnimationCurveEaseIn:
+      return (AnimationProgress)(t * t / max);
+    case AnimationCurveEaseOut:
+      return (AnimationProgress)(max - (max - t) * (max - t) / max);
+    case AnimationCurveEaseInOut:
+      if(t < max / 2) return (AnimationProgress)(2 * t * t / max);
+      return (AnimationProgress)(max - 2 * (max - t) * (max - t) / max);
+    default:
+      return (AnimationProgress)t;
+  }
+}
+
+static Animation *earliest_animation(void) {
+  Animation *best = NULL;
+  for(Animation *a = s_animations; a; a = a->next) {
+    if(!best || a->next_frame_ms < best->next_frame_ms) best = a;
+  }
+  return best;
+}
+
+static void step_animation(Animation *animation) {
+  int64_t elapsed = g_host_now_ms - animation->start_ms;
+  bool done = elapsed >= (int64_t)animation->duration_ms;
+  uint32_t linear = done ? ANIMATION_NORMALIZED_MAX
+                         : (uint32_t)(elapsed * ANIMATION_NORMALIZED_MAX / animation->duration_ms);
+
+  g_host_totals.wakeups++;
+  g_host_totals.animation_frames++;
+  animation->next_frame_ms = g_host_now_ms + ANIMATION_FRAME_MS;
+  if(animation->implementation && animation->implementation->update) {
+    animation->implementation->update(animation, curve_progress(animation->curve, linear));
+  }
+  if(done && animation_is_scheduled(animation)) animation_finish(animation, true);
+}
+
+// ------------------------------
+// ウェイクアップ / 起動理由
+// ------------------------------
+#define MAX_WAKEUPS 8
+
+typedef struct {
+  WakeupId id;
+  time_t timestamp;
+  int32_t cookie;
+  bool foreign;       // ほかのアプリの予約（重なりの確認にだけ使う）
+} HostWakeup;
+
+static HostWakeup s_wakeups[MAX_WAKEUPS * 2];
+static int s_wakeup_count;
+static WakeupId s_next_wakeup_id = 1;
+static WakeupHandler s_wakeup_handler;
+static AppLaunchReason s_launch_reason = APP_LAUNCH_USER;
+
+void wakeup_service_subscribe(WakeupHandler handler) {
+  s_wakeup_handler = handler;
+}
+
+static WakeupId add_wakeup(time_t timestamp, int32_t cookie, bool foreign) {
+  HostWakeup *wakeup = &s_wakeups[s_wakeup_count++];
+  wakeup->id = s_next_wakeup_id++;
+  wakeup->timestamp = timestamp;
+  wakeup->cookie = cookie;
+  wakeup->foreign = foreign;
+  return wakeup->id;
+}
+
+WakeupId wakeup_schedule(time_t timestamp, int32_t cookie, bool notify_if_missed) {
+  if(timestamp <= pbl_host_time(NULL)) return E_INVALID_ARGUMENT;
+  int own = 0;
+  for(int i = 0; i < s_wakeup_count; i++) {
+    if(!s_wakeups[i].foreign) own++;
+    // ほかのアプリの分も含めて 1 分以内は入れられない
+    if(llabs((long long)(s_wakeups[i].timestamp - timestamp)) < 60) return E_RANGE;
+  }
+  if(own == MAX_WAKEUPS || s_wakeup_count == ARRAY_LENGTH(s_wakeups)) return E_OUT_OF_RESOURCES;
+  WakeupId id = add_wakeup(timestamp, cookie, false);
+  if(g_host_verbose) {
+    fprintf(stderr, "[%lld] wakeup %d at +%llds\n", (long long)g_host_now_ms, (int)id,
+            (long long)(timestamp - pbl_host_time(NULL)));
+  }
+  return id;
+}
+
+// --busy-wakeup: ほかのアプリがその時刻に予約している
+void host_add_foreign_wakeup(time_t timestamp) {
+  if(s_wakeup_count < (int)ARRAY_LENGTH(s_wakeups)) add_wakeup(timestamp, 0, true);
+}
+
+void wakeup_cancel(WakeupId wakeup_id) {
+  for(int i = 0; i < s_wakeup_count; i++) {
+    if(s_wakeups[i].id == wakeup_id && !s_wakeups[i].foreign) {
+      s_wakeups[i] = s_wakeups[--s_wakeup_count];
+      return;
+    }
+  }
+}
+
+void wakeup_cancel_all(void) {
+  for(int i = 0; i < s_wakeup_count;) {
+    if(s_wakeups[i].foreign) i++;
+    else s_wakeups[i] = s_wakeups[--s_wakeup_count];
+  }
+}
+
+// --launch wakeup で起動したときだけ（id と cookie は 0）
+bool wakeup_get_launch_event(WakeupId *wakeup_id, int32_t *cookie) {
+  if(s_launch_reason != APP_LAUNCH_WAKEUP) return false;
+  if(wakeup_id) *wakeup_id = 0;
+  if(cookie) *cookie = 0;
+  return true;
+}
+
+bool wakeup_query(WakeupId wakeup_id, time_t *timestamp) {
+  for(int i = 0; i < s_wakeup_count; i++) {
+    if(s_wakeups[i].id == wakeup_id && !s_wakeups[i].foreign) {
+      if(timestamp) *timestamp = s_wakeups[i].timestamp;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int earliest_wakeup(void) {
+  int best = -1;
+  for(int i = 0; i < s_wakeup_count; i++) {
+    if(s_wakeups[i].foreign) continue;
+    if(best < 0 || s_wakeups[i].timestamp < s_wakeups[best].timestamp) best = i;
+  }
+  return best;
+}
+
+static void fire_wakeup(int index) {
+  HostWakeup wakeup = s_wakeups[index];
+  s_wakeups[index] = s_wakeups[--s_wakeup_count];
+  g_host_totals.wakeups++;
+  if(s_wakeup_handler) s_wakeup_handler(wakeup.id, wakeup.cookie);
+}
+
+AppLaunchReason launch_reason(void) {
+  return s_launch_reason;
+}
+
+void host_set_launch_reason(AppLaunchReason reason) {
+  s_launch_reason = reason;
+}
+
+// ------------------------------
+// バックグラウンドワーカー（ホストでは動かさない）
+// ------------------------------
+bool app_worker_is_running(void) {
+  return false;
+}
+
+AppWorkerResult app_worker_launch(void) {
+  return APP_WORKER_RESULT_NO_WORKER;
+}
+
+AppWorkerResult app_worker_kill(void) {
+  return APP_WORKER_RESULT_NO_WORKER;
+}
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler) {
+  return true;
+}
+
+bool app_worker_message_unsubscribe(void) {
+  return true;
+}
+
+void app_worker_send_message(uint8_t type, AppWorkerMessage *data) {
+}
+
+// ------------------------------
+// AppMessage
+// ------------------------------
+// 送信の結果は HOST_OUTBOX_LATENCY_MS 後に outbox_failed（APP_MSG_NOT_CONNECTED）で返す。
+// --phone のときは届いたものとして outbox_sent。結果が出るまで送信箱は BUSY。
+// 電話からの受信は --inbox で台本に書き、受信箱の大きさを超えたら SDK と同じく落とす。
+struct DictionaryIterator {
+  uint8_t buffer[256];
+  uint16_t used;
+  uint16_t cursor;
+};
+
+static DictionaryIterator s_outbox;
+static DictionaryIterator s_inbox;
+static uint32_t s_inbox_size;    // app_message_open の値（0 = 開いていない）
+static uint32_t s_outbox_size;
+static AppMessageInboxReceived s_inbox_received;
+static AppMessageInboxDropped s_inbox_dropped;
+static AppMessageOutboxSent s_outbox_sent;
+static AppMessageOutboxFailed s_outbox_failed;
+static void *s_message_context;
+
+#define HOST_OUTBOX_LATENCY_MS 100
+static int64_t s_outbox_result_ms = NO_EVENT;   // 送信中の結果を返す時刻
+
+// package.json の messageKeys（resources.auto.c が登録する）
+typedef struct {
+  const char *name;
+  uint32_t key;
+} HostMessageKey;
+
+static HostMessageKey s_message_keys[32];
+static int s_message_key_count;
+
+void host_set_message_key(const char *name, uint32_t key) {
+  if(s_message_key_count < (int)ARRAY_LENGTH(s_message_keys)) {
+    s_message_keys[s_message_key_count++] = (HostMessageKey){ name, key };
+  }
+}
+
+static bool find_message_key(const char *name, size_t length, uint32_t *key) {
+  for(int i = 0; i < s_message_key_count; i++) {
+    if(strlen(s_message_keys[i].name) == length &&
+       strncmp(s_message_keys[i].name, name, length) == 0) {
+      *key = s_message_keys[i].key;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+  va_list args;
+  va_start(args, tuple_count);
+  uint32_t size = 1;
+  for(int i = 0; i < tuple_count; i++) size += 7 + va_arg(args, uint32_t);
+  va_end(args);
+  return size;
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  iter->cursor = 0;
+  return dict_read_next(iter);
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  if(iter->cursor + sizeof(Tuple) > iter->used) return NULL;
+  Tuple *tuple = (Tuple *)&iter->buffer[iter->cursor];
+  iter->cursor += sizeof(Tuple) + tuple->length;
+  return tuple;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  uint16_t cursor = 0;
+  while(cursor + sizeof(Tuple) <= iter->used) {
+    Tuple *tuple = (Tuple *)&iter->buffer[cursor];
+    if(tuple->key == key) return tuple;
+    cursor += sizeof(Tuple) + tuple->length;
+  }
+  return NULL;
+}
+
+static DictionaryResult dict_write(DictionaryIterator *iter, uint32_t key, TupleType type,
+                                   const void *data, uint16_t length) {
+  if(iter->used + sizeof(Tuple) + length > sizeof(iter->buffer)) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  Tuple *tuple = (Tuple *)&iter->buffer[iter->used];
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  memcpy(tuple->value, data, length);
+  iter->used += sizeof(Tuple) + length;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key,
+                                const void *integer, const uint8_t width_bytes,
+                                const bool is_signed) {
+  return dict_write(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key,
+                                  const uint8_t value) {
+  return dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key,
+                                   const uint16_t value) {
+  return dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key,
+                                  const int32_t value) {
+  return dict_write(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key,
+                                 const uint8_t *const data, const uint16_t size) {
+  return dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound,
+                                  const uint32_t size_outbound) {
+  if(s_inbox_size) return APP_MSG_INVALID_ARGS;
+  s_inbox_size = MIN(size_inbound, sizeof(s_inbox.buffer));
+  s_outbox_size = MIN(size_outbound, sizeof(s_outbox.buffer));
+  return APP_MSG_OK;
+}
+
+void app_message_deregister_callbacks(void) {
+  s_inbox_received = NULL;
+  s_inbox_dropped = NULL;
+  s_outbox_sent = NULL;
+  s_outbox_failed = NULL;
+}
+
+void *app_message_set_context(void *context) {
+  void *previous = s_message_context;
+  s_message_context = context;
+  return previous;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(
+    AppMessageInboxReceived received_callback) {
+  AppMessageInboxReceived previous = s_inbox_received;
+  s_inbox_received = received_callback;
+  return previous;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(
+    AppMessageInboxDropped dropped_callback) {
+  AppMessageInboxDropped previous = s_inbox_dropped;
+  s_inbox_dropped = dropped_callback;
+  return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  AppMessageOutboxSent previous = s_outbox_sent;
+  s_outbox_sent = sent_callback;
+  return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(
+    AppMessageOutboxFailed failed_callback) {
+  AppMessageOutboxFailed previous = s_outbox_failed;
+  s_outbox_failed = failed_callback;
+  return previous;
+}
+
+uint32_t app_message_inbox_size_maximum(void) {
+  return sizeof(s_inbox.buffer);
+}
+
+uint32_t app_message_outbox_size_maximum(void) {
+  return sizeof(s_outbox.buffer);
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if(s_outbox_result_ms != NO_EVENT) return APP_MSG_BUSY;
+  s_outbox.used = 0;
+  s_outbox.cursor = 0;
+  *iterator = &s_outbox;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  // 辞書の先頭には件数の 1 バイトが付く
+  if(1 + s_outbox.used > s_outbox_size) return APP_MSG_BUFFER_OVERFLOW;
+  g_host_totals.messages_out++;
+  if(g_host_verbose) {
+    fprintf(stderr, "[%lld] app_message out %u bytes\n", (long long)g_host_now_ms,
+            1 + s_outbox.used);
+  }
+  s_outbox_result_ms = g_host_now_ms + HOST_OUTBOX_LATENCY_MS;
+  return APP_MSG_OK;
+}
+
+static void fire_outbox_result(void) {
+  s_outbox_result_ms = NO_EVENT;
+  s_outbox.cursor = 0;
+  if(g_host_verbose) {
+    fprintf(stderr, "[%lld] app_message out %s\n", (long long)g_host_now_ms,
+            g_host_phone_connected ? "sent" : "failed (not connected)");
+  }
+  if(g_host_phone_connected) {
+    if(s_outbox_sent) s_outbox_sent(&s_outbox, s_message_context);
+  } else if(s_outbox_failed) {
+    s_outbox_failed(&s_outbox, APP_MSG_NOT_CONNECTED, s_message_context);
+  }
+}
+
+// "[0a1b...]" をバイト列にする。読めたバイト数（読めなければ -1）
+static int parse_hex_bytes(const char *p, char **end, uint8_t *out, int max) {
+  int n = 0;
+  for(p++; isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]) && n < max; p += 2) {
+    char pair[3] = { p[0], p[1], '\0' };
+    out[n++] = (uint8_t)strtoul(pair, NULL, 16);
+  }
+  *end = (char *)p + 1;
+  return *p == ']' ? n : -1;
+}
+
+// --inbox: 電話から "name=value,name=[0a1b...]" を 1 通で受け取る（値は int32 かバイト列）
+bool host_app_message_receive(const char *spec) {
+  s_inbox.used = 0;
+  s_inbox.cursor = 0;
+  for(const char *p = spec; *p; ) {
+    const char *eq = strchr(p, '=');
+    uint32_t key;
+    if(!eq || !find_message_key(p, eq - p, &key)) return false;
+    char *end;
+    DictionaryResult result;
+    if(eq[1] == '[') {
+      uint8_t bytes[sizeof(s_inbox.buffer)];
+      int n = parse_hex_bytes(eq + 1, &end, bytes, sizeof(bytes));
+      if(n < 0) return false;
+      result = dict_write_data(&s_inbox, key, bytes, n);
+    } else {
+      int32_t value = (int32_t)strtol(eq + 1, &end, 10);
+      if(end == eq + 1) return false;
+      result = dict_write_int32(&s_inbox, key, value);
+    }
+    if(result != DICT_OK || (*end && *end != ',')) return false;
+    p = *end ? end + 1 : end;
+  }
+
+  g_host_totals.wakeups++;
+  g_host_totals.messages_in++;
+  uint32_t size = 1 + s_inbox.used;
+  if(g_host_verbose) {
+    fprintf(stderr, "[%lld] app_message in %u bytes (inbox %u)\n", (long long)g_host_now_ms,
+            size, s_inbox_size);
+  }
+  if(size > s_inbox_size) {
+    if(s_inbox_dropped) {
+      s_inbox_dropped(s_inbox_size ? APP_MSG_BUFFER_OVERFLOW : APP_MSG_CLOSED, s_message_context);
+    }
+  } else if(s_inbox_received) {
+    s_inbox_received(&s_inbox, s_message_context);
+  }
+  return true;
+}
+
+// ------------------------------
+// 次のイベント
+// ------------------------------
+int64_t host_next_service_event(void) {
+  int64_t next = s_tick_next_ms;
+  AppTimer *timer = earliest_timer();
+  if(timer && timer->due_ms < next) next = timer->due_ms;
+  Animation *animation = earliest_animation();
+  if(animation && animation->next_frame_ms < next) next = animation->next_frame_ms;
+  int wakeup = earliest_wakeup();
+  if(wakeup >= 0 && (int64_t)s_wakeups[wakeup].timestamp * 1000 < next) {
+    next = (int64_t)s_wakeups[wakeup].timestamp * 1000;
+  }
+  if(s_accel_next_ms < next) next = s_accel_next_ms;
+  if(s_outbox_result_ms < next) next = s_outbox_result_ms;
+  return next;
+}
+
+// 現在時刻までに期限が来たものを一つずつ発火する
+void host_dispatch_services(void) {
+  for(;;) {
+    AppTimer *timer = earliest_timer();
+    Animation *animation = earliest_animation();
+    int wakeup = earliest_wakeup();
+
+    if(s_tick_next_ms <= g_host_now_ms) {
+      fire_tick();
+    } else if(timer && timer->due_ms <= g_host_now_ms) {
+      fire_timer(timer);
+    } else if(animation && animation->next_frame_ms <= g_host_now_ms) {
+      step_animation(animation);
+    } else if(wakeup >= 0 && (int64_t)s_wakeups[wakeup].timestamp * 1000 <= g_host_now_ms) {
+      fire_wakeup(wakeup);
+    } else if(s_accel_next_ms <= g_host_now_ms) {
+      fire_accel_data();
+    } else if(s_outbox_result_ms <= g_host_now_ms) {
+      fire_outbox_result();
+    } else {
+      return;
+    }
+    if(g_host_exit) return;
+  }
+}
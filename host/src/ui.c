@@ -0,0 +1,611 @@
+// ================================
+//  ウィンドウ・レイヤー・ボタン
+// ================================
+#include "host.h"
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  Window *window;
+  bool hidden;
+  void *data;
+};
+
+struct Window {
+  Layer *root;
+  WindowHandlers handlers;
+  ClickConfigProvider click_config_provider;
+  void *click_config_context;
+  GColor background_color;
+  bool loaded;
+  void *user_data;
+};
+
+struct TextLayer {
+  Layer *layer;
+  const char *text;
+  GFont font;
+  GTextAlignment alignment;
+  GTextOverflowMode overflow_mode;
+  GColor text_color;
+  GColor background_color;
+};
+
+struct MenuLayer {
+  Layer *layer;
+  MenuLayerCallbacks callbacks;
+  void *callback_context;
+  MenuIndex selected;
+};
+
+#define MAX_WINDOWS 8
+#define MENU_ROW_HEIGHT 44
+
+static Window *s_stack[MAX_WINDOWS];
+static int s_stack_count;
+static bool s_dirty;
+static HostButtonConfig s_buttons[NUM_BUTTONS];
+static void *s_click_context;
+
+void host_mark_dirty(void) {
+  s_dirty = true;
+}
+
+bool host_has_window(void) {
+  return s_stack_count > 0;
+}
+
+// ------------------------------
+// レイヤー
+// ------------------------------
+Layer *layer_create(GRect frame) {
+  return layer_create_with_data(frame, 0);
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = calloc(1, sizeof(Layer) + data_size);
+  if(!layer) return NULL;
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+  layer->data = data_size ? (void *)(layer + 1) : NULL;
+  return layer;
+}
+
+void layer_remove_from_parent(Layer *child) {
+  Layer *parent = child->parent;
+  if(!parent) return;
+  Layer **link = &parent->first_child;
+  while(*link && *link != child) link = &(*link)->next_sibling;
+  if(*link) *link = child->next_sibling;
+  child->parent = NULL;
+  child->next_sibling = NULL;
+  s_dirty = true;
+}
+
+void layer_destroy(Layer *layer) {
+  if(!layer) return;
+  layer_remove_from_parent(layer);
+  for(Layer *c = layer->first_child; c; c = c->next_sibling) c->parent = NULL;
+  free(layer);
+}
+
+void layer_mark_dirty(Layer *layer) {
+  s_dirty = true;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  layer->frame = frame;
+  layer->bounds.size = frame.size;
+  s_dirty = true;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+}
+
+void layer_set_bounds(Layer *layer, GRect bounds) {
+  layer->bounds = bounds;
+  s_dirty = true;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return layer->bounds;
+}
+
+GPoint layer_convert_point_to_screen(const Layer *layer, GPoint point) {
+  for(const Layer *l = layer; l; l = l->parent) {
+    point.x += l->frame.origin.x + l->bounds.origin.x;
+    point.y += l->frame.origin.y + l->bounds.origin.y;
+  }
+  return point;
+}
+
+Window *layer_get_window(const Layer *layer) {
+  return layer->window;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  layer_remove_from_parent(child);
+  child->parent = parent;
+  child->window = parent->window;
+  Layer **link = &parent->first_child;
+  while(*link) link = &(*link)->next_sibling;
+  *link = child;
+  s_dirty = true;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  layer->hidden = hidden;
+  s_dirty = true;
+}
+
+bool layer_get_hidden(const Layer *layer) {
+  return layer->hidden;
+}
+
+void *layer_get_data(const Layer *layer) {
+  return layer->data;
+}
+
+// ------------------------------
+// テキストレイヤー
+// ------------------------------
+static void text_layer_update_proc(Layer *layer, GContext *ctx) {
+  TextLayer *text_layer = *(TextLayer **)layer_get_data(layer);
+  if(text_layer->background_color.a) {
+    graphics_context_set_fill_color(ctx, text_layer->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+  }
+  if(text_layer->text && *text_layer->text) {
+    graphics_context_set_text_color(ctx, text_layer->text_color);
+    graphics_draw_text(ctx, text_layer->text, text_layer->font, layer->bounds,
+                       text_layer->overflow_mode, text_layer->alignment, NULL);
+  }
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *text_layer = calloc(1, sizeof(TextLayer));
+  text_layer->layer = layer_create_with_data(frame, sizeof(TextLayer *));
+  *(TextLayer **)layer_get_data(text_layer->layer) = text_layer;
+  layer_set_update_proc(text_layer->layer, text_layer_update_proc);
+  text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  if(!text_layer) return;
+  layer_destroy(text_layer->layer);
+  free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  text_layer->text = text;
+  s_dirty = true;
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+  return text_layer->text;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  text_layer->font = font;
+  s_dirty = true;
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment alignment) {
+  text_layer->alignment = alignment;
+  s_dirty = true;
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+  text_layer->text_color = color;
+  s_dirty = true;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  text_layer->background_color = color;
+  s_dirty = true;
+}
+
+void text_layer_set_overflow_mode(TextLayer *text_layer, GTextOverflowMode mode) {
+  text_layer->overflow_mode = mode;
+  s_dirty = true;
+}
+
+// ------------------------------
+// ウィンドウ
+// ------------------------------
+static void window_root_update_proc(Layer *layer, GContext *ctx) {
+  Window *window = layer->window;
+  if(window->background_color.a) {
+    graphics_context_set_fill_color(ctx, window->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+  }
+}
+
+Window *window_create(void) {
+  Window *window = calloc(1, sizeof(Window));
+  window->root = layer_create(GRect(0, 0, HOST_SCREEN_W, HOST_SCREEN_H));
+  window->root->window = window;
+  layer_set_update_proc(window->root, window_root_update_proc);
+  window->background_color = GColorWhite;
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if(!window) return;
+  window_stack_remove(window, false);
+  layer_destroy(window->root);
+  free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider provider) {
+  window_set_click_config_provider_with_context(window, provider, window);
+}
+
+void window_set_click_config_provider_with_context(Window *window,
+                                                   ClickConfigProvider provider,
+                                                   void *context) {
+  window->click_config_provider = provider;
+  window->click_config_context = context;
+  if(s_stack_count && s_stack[s_stack_count - 1] == window) {
+    memset(s_buttons, 0, sizeof(s_buttons));
+    s_click_context = context;
+    if(provider) provider(context);
+  }
+}
+
+void window_set_background_color(Window *window, GColor color) {
+  window->background_color = color;
+  s_dirty = true;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return window->root;
+}
+
+bool window_is_loaded(Window *window) {
+  return window->loaded;
+}
+
+void window_set_user_data(Window *window, void *data) {
+  window->user_data = data;
+}
+
+void *window_get_user_data(const Window *window) {
+  return window->user_data;
+}
+
+// 一番上のウィンドウのボタン設定を作り直す
+static void configure_top_window(void) {
+  memset(s_buttons, 0, sizeof(s_buttons));
+  s_click_context = NULL;
+  if(!s_stack_count) return;
+  Window *top = s_stack[s_stack_count - 1];
+  s_click_context = top->click_config_context;
+  if(top->click_config_provider) top->click_config_provider(top->click_config_context);
+  s_dirty = true;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  if(s_stack_count == MAX_WINDOWS) return;
+  if(s_stack_count && s_stack[s_stack_count - 1]->handlers.disappear) {
+    s_stack[s_stack_count - 1]->handlers.disappear(s_stack[s_stack_count - 1]);
+  }
+  s_stack[s_stack_count++] = window;
+  if(!window->loaded) {
+    window->loaded = true;
+    if(window->handlers.load) window->handlers.load(window);
+  }
+  if(window->handlers.appear) window->handlers.appear(window);
+  configure_top_window();
+}
+
+bool window_stack_remove(Window *window, bool animated) {
+  int index = -1;
+  for(int i = 0; i < s_stack_count; i++) {
+    if(s_stack[i] == window) index = i;
+  }
+  if(index < 0) return false;
+  bool was_top = (index == s_stack_count - 1);
+  memmove(&s_stack[index], &s_stack[index + 1], (s_stack_count - index - 1) * sizeof(Window *));
+  s_stack_count--;
+  if(was_top && window->handlers.disappear) window->handlers.disappear(window);
+  if(window->loaded) {
+    window->loaded = false;
+    if(window->handlers.unload) window->handlers.unload(window);
+  }
+  if(was_top && s_stack_count) {
+    Window *top = s_stack[s_stack_count - 1];
+    if(top->handlers.appear) top->handlers.appear(top);
+  }
+  configure_top_window();
+  return true;
+}
+
+Window *window_stack_pop(bool animated) {
+  if(!s_stack_count) return NULL;
+  Window *top = s_stack[s_stack_count - 1];
+  window_stack_remove(top, animated);
+  return top;
+}
+
+void window_stack_pop_all(const bool animated) {
+  while(s_stack_count) window_stack_pop(animated);
+}
+
+Window *window_stack_get_top_window(void) {
+  return s_stack_count ? s_stack[s_stack_count - 1] : NULL;
+}
+
+bool window_stack_contains_window(Window *window) {
+  for(int i = 0; i < s_stack_count; i++) {
+    if(s_stack[i] == window) return true;
+  }
+  return false;
+}
+
+// ------------------------------
+// ボタン
+// ------------------------------
+struct ClickRecognizer {
+  ButtonId button;
+  uint8_t clicks;
+  bool repeating;
+};
+
+uint8_t click_number_of_clicks_counted(ClickRecognizerRef recognizer) {
+  return recognizer->clicks;
+}
+
+ButtonId click_recognizer_get_button_id(ClickRecognizerRef recognizer) {
+  return recognizer->button;
+}
+
+bool click_recognizer_is_repeating(ClickRecognizerRef recognizer) {
+  return recognizer->repeating;
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler) {
+  s_buttons[button_id].single = handler;
+}
+
+void window_single_repeating_click_subscribe(ButtonId button_id, uint16_t repeat_interval_ms,
+                                             ClickHandler handler) {
+  s_buttons[button_id].single = handler;
+  s_buttons[button_id].repeat_ms = repeat_interval_ms;
+}
+
+void window_multi_click_subscribe(ButtonId button_id, uint8_t min_clicks, uint8_t max_clicks,
+                                  uint16_t timeout, bool last_click_only,
+                                  ClickHandler handler) {
+  s_buttons[button_id].multi = handler;
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms,
+                                 ClickHandler down_handler, ClickHandler up_handler) {
+  s_buttons[button_id].long_down = down_handler;
+  s_buttons[button_id].long_up = up_handler;
+  s_buttons[button_id].long_delay_ms = delay_ms ? delay_ms : 500;
+}
+
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler,
+                                ClickHandler up_handler, void *context) {
+  s_buttons[button_id].raw_down = down_handler;
+  s_buttons[button_id].raw_up = up_handler;
+  s_buttons[button_id].raw_context = context;
+}
+
+const HostButtonConfig *host_button_config(ButtonId button) {
+  return &s_buttons[button];
+}
+
+void host_button_fire(ButtonId button, HostClickKind kind) {
+  struct ClickRecognizer recognizer = { .button = button, .clicks = 1 };
+  HostButtonConfig *config = &s_buttons[button];
+  void *context = s_click_context;
+
+  switch(kind) {
+    case HOST_CLICK_SINGLE:
+    case HOST_CLICK_REPEAT:
+      recognizer.repeating = (kind == HOST_CLICK_REPEAT);
+      if(config->single) config->single(&recognizer, context);
+      else if(config->multi) config->multi(&recognizer, context);
+      else if(button == BUTTON_ID_BACK) window_stack_pop(true);
+      break;
+    case HOST_CLICK_LONG_DOWN:
+      if(config->long_down) config->long_down(&recognizer, context);
+      break;
+    case HOST_CLICK_LONG_UP:
+      if(config->long_up) config->long_up(&recognizer, context);
+      break;
+    case HOST_CLICK_RAW_DOWN:
+      if(config->raw_down) config->raw_down(&recognizer, config->raw_context);
+      break;
+    case HOST_CLICK_RAW_UP:
+      if(config->raw_up) config->raw_up(&recognizer, config->raw_context);
+      break;
+  }
+}
+
+// ------------------------------
+// メニュー
+// ------------------------------
+static void menu_layer_update_proc(Layer *layer, GContext *ctx) {
+  MenuLayer *menu = *(MenuLayer **)layer_get_data(layer);
+  if(!menu->callbacks.get_num_rows || !menu->callbacks.draw_row) return;
+
+  uint16_t rows = menu->callbacks.get_num_rows(menu, 0, menu->callback_context);
+  int first = MAX(0, menu->selected.row - (layer->bounds.size.h / MENU_ROW_HEIGHT) + 1);
+  GRect saved_box = ctx->draw_box;
+
+  for(int row = first; row < rows; row++) {
+    int y = (row - first) * MENU_ROW_HEIGHT;
+    if(y >= layer->bounds.size.h) break;
+    bool selected = (row == menu->selected.row);
+
+    graphics_context_set_fill_color(ctx, selected ? GColorBlack : GColorWhite);
+    graphics_fill_rect(ctx, GRect(0, y, layer->bounds.size.w, MENU_ROW_HEIGHT), 0, GCornerNone);
+    graphics_context_set_text_color(ctx, selected ? GColorWhite : GColorBlack);
+
+    Layer cell = { .frame = GRect(0, 0, layer->bounds.size.w, MENU_ROW_HEIGHT) };
+    cell.bounds = cell.frame;
+    ctx->draw_box.origin.y = saved_box.origin.y + y;
+    MenuIndex index = { .section = 0, .row = row };
+    menu->callbacks.draw_row(ctx, &cell, &index, menu->callback_context);
+    ctx->draw_box = saved_box;
+  }
+}
+
+MenuLayer *menu_layer_create(GRect frame) {
+  MenuLayer *menu = calloc(1, sizeof(MenuLayer));
+  menu->layer = layer_create_with_data(frame, sizeof(MenuLayer *));
+  *(MenuLayer **)layer_get_data(menu->layer) = menu;
+  layer_set_update_proc(menu->layer, menu_layer_update_proc);
+  return menu;
+}
+
+void menu_layer_destroy(MenuLayer *menu) {
+  if(!menu) return;
+  layer_destroy(menu->layer);
+  free(menu);
+}
+
+Layer *menu_layer_get_layer(const MenuLayer *menu) {
+  return menu->layer;
+}
+
+void menu_layer_set_callbacks(MenuLayer *menu, void *context, MenuLayerCallbacks callbacks) {
+  menu->callbacks = callbacks;
+  menu->callback_context = context;
+  s_dirty = true;
+}
+
+void menu_layer_reload_data(MenuLayer *menu) {
+  s_dirty = true;
+}
+
+static void menu_move(MenuLayer *menu, int delta) {
+  uint16_t rows = menu->callbacks.get_num_rows
+                      ? menu->callbacks.get_num_rows(menu, 0, menu->callback_context) : 0;
+  int row = menu->selected.row + delta;
+  if(row >= 0 && row < rows) menu->selected.row = row;
+  s_dirty = true;
+}
+
+static void menu_up_handler(ClickRecognizerRef recognizer, void *context) {
+  menu_move(context, -1);
+}
+
+static void menu_down_handler(ClickRecognizerRef recognizer, void *context) {
+  menu_move(context, 1);
+}
+
+static void menu_select_handler(ClickRecognizerRef recognizer, void *context) {
+  MenuLayer *menu = context;
+  if(menu->callbacks.select_click) {
+    menu->callbacks.select_click(menu, &menu->selected, menu->callback_context);
+  }
+}
+
+static void menu_select_long_handler(ClickRecognizerRef recognizer, void *context) {
+  MenuLayer *menu = context;
+  if(menu->callbacks.select_long_click) {
+    menu->callbacks.select_long_click(menu, &menu->selected, menu->callback_context);
+  }
+}
+
+static void menu_click_config_provider(void *context) {
+  window_single_repeating_click_subscribe(BUTTON_ID_UP, 100, menu_up_handler);
+  window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 100, menu_down_handler);
+  window_single_click_subscribe(BUTTON_ID_SELECT, menu_select_handler);
+  window_long_click_subscribe(BUTTON_ID_SELECT, 0, menu_select_long_handler, NULL);
+}
+
+void menu_layer_set_click_config_onto_window(MenuLayer *menu, Window *window) {
+  window_set_click_config_provider_with_context(window, menu_click_config_provider, menu);
+}
+
+void menu_cell_basic_draw(GContext *ctx, const Layer *cell_layer, const char *title,
+                          const char *subtitle, GBitmap *icon) {
+  GRect bounds = layer_get_bounds(cell_layer);
+  if(title) {
+    graphics_draw_text(ctx, title, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+                       GRect(5, -4, bounds.size.w - 10, 28), GTextOverflowModeTrailingEllipsis,
+                       GTextAlignmentLeft, NULL);
+  }
+  if(subtitle) {
+    graphics_draw_text(ctx, subtitle, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                       GRect(5, 20, bounds.size.w - 10, 22), GTextOverflowModeTrailingEllipsis,
+                       GTextAlignmentLeft, NULL);
+  }
+}
+
+// ------------------------------
+// 描画
+// ------------------------------
+static void render_layer(Layer *layer, GContext *ctx, GPoint origin, GRect clip) {
+  if(layer->hidden) return;
+
+  GRect frame = GRect(origin.x + layer->frame.origin.x, origin.y + layer->frame.origin.y,
+                      layer->frame.size.w, layer->frame.size.h);
+  grect_clip(&frame, &clip);
+  GPoint draw_origin = GPoint(origin.x + layer->frame.origin.x + layer->bounds.origin.x,
+                              origin.y + layer->frame.origin.y + layer->bounds.origin.y);
+
+  if(layer->update_proc) {
+    ctx->draw_box = GRect(draw_origin.x, draw_origin.y, layer->bounds.size.w,
+                          layer->bounds.size.h);
+    ctx->clip_box = frame;
+    ctx->comp_op = GCompOpAssign;
+    ctx->stroke_width = 1;
+    layer->update_proc(layer, ctx);
+  }
+
+  for(Layer *child = layer->first_child; child; child = child->next_sibling) {
+    render_layer(child, ctx, draw_origin, frame);
+  }
+}
+
+// span_fill をリンクしていないアプリでは NULL
+uint32_t span_fill_pixels_written(void) __attribute__((weak));
+
+bool host_render_if_dirty(void) {
+  if(!s_dirty || !s_stack_count) return false;
+  s_dirty = false;
+
+  memset(&g_host_frame, 0, sizeof(g_host_frame));
+  GContext *ctx = host_graphics_context();
+  uint32_t written = span_fill_pixels_written ? span_fill_pixels_written() : 0;
+  uint64_t start = host_cpu_ns();
+  render_layer(s_stack[s_stack_count - 1]->root, ctx, GPointZero,
+               GRect(0, 0, HOST_SCREEN_W, HOST_SCREEN_H));
+  g_host_frame.render_ns = host_cpu_ns() - start - g_host_frame.accounting_ns;
+  if(span_fill_pixels_written) g_host_frame.fb_written_pixels = span_fill_pixels_written() - written;
+
+  g_host_totals.redraws++;
+  g_host_totals.draw_calls += g_host_frame.draw_calls;
+  g_host_totals.pixels += g_host_frame.pixels;
+  g_host_totals.fb_direct_pixels += g_host_frame.fb_direct_pixels;
+  g_host_totals.fb_written_pixels += g_host_frame.fb_written_pixels;
+  g_host_totals.render_ns += g_host_frame.render_ns;
+  return true;
+}
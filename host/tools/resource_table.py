@@ -0,0 +1,49 @@
+#
+# アプリの package.json の resources.media から、ホスト用の
+#   resource_ids.auto.h   RESOURCE_ID_<name>（SDK と同じく 1 から順に）
+#   resources.auto.c      host_register_resources(): ID とファイルを結びつける
+#   message_keys.auto.h   MESSAGE_KEY_<name>（messageKeys から。SDK と同じく 10000 から順に）
+# を生成する。ファイルは <app>/resources/ からの相対パスで書かれている。
+# MESSAGE_KEY_* は SDK と同じく定数ではなく変数（定義は resources.auto.c）。
+#
+#   python tools/resource_table.py ../DSonPaper out_dir
+#
+import json
+import os
+import sys
+
+# SDK が messageKeys に振る最初の番号
+MESSAGE_KEY_BASE = 10000
+
+
+def main(app_dir, out_dir):
+    with open(os.path.join(app_dir, 'package.json'), encoding='utf-8') as f:
+        pebble = json.load(f)['pebble']
+    media = pebble['resources']['media']
+    message_keys = pebble.get('messageKeys', [])
+    resource_dir = os.path.abspath(os.path.join(app_dir, 'resources'))
+
+    ids = ['#pragma once', '// tools/resource_table.py が生成']
+    keys = ['#pragma once', '// tools/resource_table.py が生成', '#include <stdint.h>']
+    table = ['// tools/resource_table.py が生成', '#include "host.h"', '']
+    for number, name in enumerate(message_keys, MESSAGE_KEY_BASE):
+        keys.append('extern uint32_t MESSAGE_KEY_{};'.format(name))
+        table.append('uint32_t MESSAGE_KEY_{} = {};'.format(name, number))
+    table += ['', 'void host_register_resources(void) {']
+    for number, entry in enumerate(media, 1):
+        ids.append('#define RESOURCE_ID_{} {}'.format(entry['name'], number))
+        path = os.path.join(resource_dir, entry['file'])
+        table.append('  host_set_resource_file({}, {});'.format(number, json.dumps(path)))
+    for number, name in enumerate(message_keys, MESSAGE_KEY_BASE):
+        table.append('  host_set_message_key({}, {});'.format(json.dumps(name), number))
+    table.append('}')
+
+    os.makedirs(out_dir, exist_ok=True)
+    for name, lines in (('resource_ids.auto.h', ids), ('resources.auto.c', table),
+                        ('message_keys.auto.h', keys)):
+        with open(os.path.join(out_dir, name), 'w', encoding='utf-8') as f:
+            f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main(sys.argv[1], sys.argv[2])
@@ -0,0 +1,127 @@
+#include "chime.h"
+
+// ================================
+//  定義
+// ================================
+// ほかのアプリの wakeup と重なったとき、何分まで後ろへずらすか
+#define MAX_SHIFT_MIN 3
+// それでも埋まっていたら次の区切りを試す。その回数
+#define MAX_SLOT_TRIES 4
+
+// 予約より早く起こされたとみなす幅（秒）
+#define EARLY_S 2
+
+static const uint8_t INTERVALS[] = { 0, 60, 30, 15 };
+
+static ChimeSchedule s_schedule;
+static ChimeHandler s_handler;
+
+// ================================
+//  次の時刻
+// ================================
+static bool in_hours(int minute_of_day) {
+  int hour = minute_of_day / 60;
+  if(s_schedule.first_hour <= s_schedule.last_hour) {
+    return hour >= s_schedule.first_hour && hour <= s_schedule.last_hour;
+  }
+  return hour >= s_schedule.first_hour || hour <= s_schedule.last_hour;   // 日をまたぐ
+}
+
+// now の分より後で、決めた時台に入る最初の区切り（UTC の time_t）。なければ 0
+static time_t next_slot(time_t now) {
+  int interval = s_schedule.interval_min;
+  if(interval == 0) return 0;
+
+  struct tm *t = localtime(&now);
+  int minute = t->tm_hour * 60 + t->tm_min;
+  time_t midnight = now - minute * 60 - t->tm_sec;
+
+  // 1 日ぶん見れば、時台のどこかに必ず当たる
+  int slot = minute / interval * interval + interval;
+  for(int i = 0; i <= 24 * 60 / interval; i++, slot += interval) {
+    if(in_hours(slot % (24 * 60))) return midnight + (time_t)slot * 60;
+  }
+  return 0;
+}
+
+// ================================
+//  予約
+// ================================
+// 1 つの区切りに入れてみる（重なったら MAX_SHIFT_MIN 分まで後ろへ）
+static StatusCode schedule_near(time_t slot) {
+  StatusCode result = E_RANGE;
+  for(int shift = 0; shift <= MAX_SHIFT_MIN && result == E_RANGE; shift++) {
+    WakeupId id = wakeup_schedule(slot + shift * 60, (int32_t)(slot / 60), false);
+    result = id >= 0 ? S_SUCCESS : (StatusCode)id;
+  }
+  return result;
+}
+
+void chime_arm(void) {
+  // 自分の wakeup は常に 1 つだけ（上限の 8 個に溜まらない）
+  wakeup_cancel_all();
+
+  // 区切りの直前（時計のずれの分）に起こされても、同じ区切りをもう一度入れない
+  time_t slot = next_slot(time(NULL) + EARLY_S);
+  for(int tries = 0; slot && tries < MAX_SLOT_TRIES; tries++) {
+    StatusCode result = schedule_near(slot);
+    if(result != E_RANGE) return;
+    // この区切りはほかのアプリで埋まっている：次の区切りへ
+    slot = next_slot(slot);
+  }
+}
+
+// ================================
+//  設定の範囲
+// ================================
+// 間隔は INTERVALS のどれか（0 = 切はそのまま。ほかは一番近いもの）、時は 0〜23
+static ChimeSchedule normalize(const ChimeSchedule *schedule) {
+  ChimeSchedule s = *schedule;
+  if(s.interval_min != 0) {
+    uint8_t best = INTERVALS[1];
+    for(int i = 2; i < (int)ARRAY_LENGTH(INTERVALS); i++) {
+      if(abs(INTERVALS[i] - s.interval_min) < abs(best - s.interval_min)) best = INTERVALS[i];
+    }
+    s.interval_min = best;
+  }
+  s.first_hour = MIN(s.first_hour, 23);
+  s.last_hour = MIN(s.last_hour, 23);
+  return s;
+}
+
+// ================================
+//  公開関数
+// ================================
+static void wakeup_handler(WakeupId wakeup_id, int32_t cookie) {
+  chime_arm();
+  if(s_handler) s_handler();
+}
+
+bool chime_init(ChimeHandler handler, const ChimeSchedule *schedule) {
+  s_handler = handler;
+  s_schedule = normalize(schedule);
+  wakeup_service_subscribe(wakeup_handler);
+
+  WakeupId id;
+  int32_t cookie;
+  bool woke = launch_reason() == APP_LAUNCH_WAKEUP && wakeup_get_launch_event(&id, &cookie);
+  chime_arm();
+  return woke;
+}
+
+void chime_set_schedule(const ChimeSchedule *schedule) {
+  ChimeSchedule s = normalize(schedule);
+  if(memcmp(&s, &s_schedule, sizeof(s_schedule)) == 0) return;
+  s_schedule = s;
+  chime_arm();
+}
+
+uint8_t chime_next_interval(uint8_t interval_min) {
+  int i = 0;
+  while(i < (int)ARRAY_LENGTH(INTERVALS) && INTERVALS[i] != interval_min) i++;
+  return INTERVALS[(i + 1) % ARRAY_LENGTH(INTERVALS)];
+}
+
+const ChimeSchedule *chime_schedule(void) {
+  return &s_schedule;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <pebble.h>
+
+// ================================
+//  chime: 決まった時刻に時刻を鳴らす（Wakeup API）
+// ================================
+// 次の時刻に wakeup を 1 つだけ予約しておき、起こされたアプリが鳴らして
+// 次を予約し直し、閉じる。鳴らす間のほかは何も動かない（常駐しない）。
+//
+//   chime_init(on_chime, &schedule);   // init()。wakeup で起こされたなら true を返す
+//   chime_set_schedule(&schedule);     // 設定が変わったら（変わっていれば予約し直す）
+//   chime_next_interval(interval);     // 切 → 60 → 30 → 15 分 → 切 …
+//
+// 設定の保存はアプリ側（silentwatch.c の設定表。電話の設定画面からも変わる）。
+// 予約は自分の分を全部取り消してから 1 つだけ入れるので、上限（1 アプリ 8 個）には
+// 届かない。ほかのアプリの wakeup と 1 分以内で重なったら少しずらす。
+
+typedef struct {
+  uint8_t interval_min;  // 0（鳴らさない）/ 15 / 30 / 60。ほかの値は近いものに丸める
+  uint8_t first_hour;    // この時台から
+  uint8_t last_hour;     // この時台まで（含む）。first_hour より前なら日をまたぐ（22-6 など）
+} ChimeSchedule;
+
+typedef void (*ChimeHandler)(void);
+
+bool chime_init(ChimeHandler handler, const ChimeSchedule *schedule);
+void chime_arm(void);
+void chime_set_schedule(const ChimeSchedule *schedule);
+uint8_t chime_next_interval(uint8_t interval_min);
+const ChimeSchedule *chime_schedule(void);
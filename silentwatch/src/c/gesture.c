@@ -0,0 +1,126 @@
+#include "gesture.h"
+
+// ================================
+//  しきい値
+// ================================
+// 文字盤が上を向いているときの z は -1000mg 付近。横を向くと 0 付近になる
+#define FACE_UP_MG        (-700)  // これより小さければ文字盤は上（傾き 45 度まで）
+#define FACE_AWAY_MG      (-250)  // これより大きければ文字盤は横（傾き 75 度から）
+
+#define REST_MS           600     // ひねる前に止まっている時間
+#define ARM_MS            800     // 静止が終わってから、ひねり始めを待つ時間
+#define TILT_MAX_MS       400     // 上から横まで（ゆっくり傾けるのは腕を下ろしただけ）
+#define TWIST_MAX_MS      1000    // 上から横へ行って戻るまで
+#define REFRACTORY_MS     2000
+#define REST_MOTION_MG    120     // 静止とみなす、ならした値からのずれ（3 軸の絶対値の和）
+
+// ================================
+//  初期化
+// ================================
+static int ms_to_samples(int ms, int rate_hz) {
+  int n = (ms * rate_hz + 999) / 1000;
+  return n > 0 ? n : 1;
+}
+
+void gesture_init(GestureDetector *g, int rate_hz) {
+  if(rate_hz < 1) rate_hz = 1;
+  g->rest_samples = ms_to_samples(REST_MS, rate_hz);
+  g->arm_samples = ms_to_samples(ARM_MS, rate_hz);
+  g->tilt_samples = ms_to_samples(TILT_MAX_MS, rate_hz);
+  g->twist_samples = ms_to_samples(TWIST_MAX_MS, rate_hz);
+  g->refractory_samples = ms_to_samples(REFRACTORY_MS, rate_hz);
+
+  // 平滑化の時定数をおよそ 100ms にそろえる（2^shift サンプル。
+  // 0 だとずれが常に 0 になるので、10Hz でも 1 にする）
+  g->lp_shift = 1;
+  while((1 << (g->lp_shift + 1)) * 1000 <= 100 * rate_hz) g->lp_shift++;
+
+  gesture_reset(g);
+}
+
+void gesture_reset(GestureDetector *g) {
+  g->primed = false;
+  g->rest = 0;
+  g->armed = 0;
+  g->phase = GESTURE_IDLE;
+  g->elapsed = 0;
+}
+
+// ================================
+//  判定
+// ================================
+static int iabs(int v) {
+  return v < 0 ? -v : v;
+}
+
+bool gesture_feed(GestureDetector *g, int x, int y, int z) {
+  if(!g->primed) {
+    g->x_q4 = x * 16;
+    g->y_q4 = y * 16;
+    g->z_q4 = z * 16;
+    g->primed = true;
+    return false;
+  }
+
+  // 1 次の IIR で重力をならし、ならした値からのずれの和で動きの大きさを見る
+  // （差分と違い、ずれの大きさは周波数によらない）
+  g->x_q4 += (x * 16 - g->x_q4) >> g->lp_shift;
+  g->y_q4 += (y * 16 - g->y_q4) >> g->lp_shift;
+  g->z_q4 += (z * 16 - g->z_q4) >> g->lp_shift;
+  int motion = iabs(x - g->x_q4 / 16) + iabs(y - g->y_q4 / 16) + iabs(z - g->z_q4 / 16);
+
+  // 向きは生の z で見る（ならすと速いひねりが 10Hz で届かなくなる。
+  // ノイズはしきい値の幅に比べて十分小さい）
+  bool face_up = z < FACE_UP_MG;
+  if(face_up && motion <= REST_MOTION_MG) {
+    if(g->rest < g->rest_samples) g->rest++;
+  } else {
+    g->rest = 0;
+  }
+  if(g->rest >= g->rest_samples) g->armed = g->arm_samples;
+  else if(g->armed > 0) g->armed--;
+
+  switch(g->phase) {
+    case GESTURE_IDLE:
+      if(g->armed > 0 && !face_up) {
+        g->phase = GESTURE_TILTING;
+        g->elapsed = 0;
+      }
+      return false;
+
+    case GESTURE_TILTING:
+      g->elapsed++;
+      if(z > FACE_AWAY_MG) {
+        g->phase = GESTURE_AWAY;
+      } else if(face_up || g->elapsed > g->tilt_samples) {
+        // 少し揺れただけ／ゆっくり傾けただけ
+        g->phase = GESTURE_IDLE;
+        g->armed = 0;
+      }
+      return false;
+
+    case GESTURE_AWAY:
+      g->elapsed++;
+      if(face_up) {
+        g->phase = GESTURE_REFRACTORY;
+        g->elapsed = 0;
+        g->armed = 0;
+        return true;
+      }
+      if(g->elapsed > g->twist_samples) {
+        // 横を向いたまま（腕を下ろした）
+        g->phase = GESTURE_IDLE;
+        g->armed = 0;
+      }
+      return false;
+
+    case GESTURE_REFRACTORY:
+      if(++g->elapsed >= g->refractory_samples) {
+        g->phase = GESTURE_IDLE;
+        g->rest = 0;
+      }
+      g->armed = 0;
+      return false;
+  }
+  return false;
+}
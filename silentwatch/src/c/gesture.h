@@ -0,0 +1,48 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// ================================
+//  gesture: 手首のひねりを加速度から見つける
+// ================================
+// 文字盤を上にして少し止めたあと、手首をひねって文字盤を横まで向け、
+// すぐに戻す動きを 1 回のジェスチャとする。整数だけで、サンプルごとに
+// 数回の足し算とシフトしか使わない（浮動小数点なし）。
+//
+//   GestureDetector g;
+//   gesture_init(&g, 10);                         // サンプリング周波数（Hz）
+//   if(gesture_feed(&g, d->x, d->y, d->z)) ...   // サンプルごと（mg）
+//   gesture_reset(&g);                            // モーターが回ったあとなど
+//
+// 判定はサンプル単位なので、バッチの大きさには依存しない（遅れが変わるだけ）。
+// SDK に依存しない（ホストの評価ツール tools/gesture_eval.c からも使う）。
+
+typedef enum {
+  GESTURE_IDLE,       // 静止を待っている
+  GESTURE_TILTING,    // 文字盤が上から傾き始めた
+  GESTURE_AWAY,       // 文字盤が横を向いた（戻るのを待つ）
+  GESTURE_REFRACTORY, // 見つけた直後（しばらく数えない）
+} GesturePhase;
+
+typedef struct {
+  // サンプル数に直したしきい値（gesture_init で周波数から決める）
+  int rest_samples;
+  int arm_samples;
+  int tilt_samples;
+  int twist_samples;
+  int refractory_samples;
+  int lp_shift;       // 平滑化（大きいほど遅い）
+
+  int32_t x_q4, y_q4, z_q4; // 平滑化した重力（mg の 16 倍）
+  bool primed;
+  int rest;           // 静止が続いているサンプル数
+  int armed;          // 静止のあと、ひねりを受け付ける残りサンプル数
+  GesturePhase phase;
+  int elapsed;
+} GestureDetector;
+
+void gesture_init(GestureDetector *g, int rate_hz);
+void gesture_reset(GestureDetector *g);
+
+// サンプルを 1 つ入れる。ジェスチャが終わったサンプルで true
+bool gesture_feed(GestureDetector *g, int x, int y, int z);
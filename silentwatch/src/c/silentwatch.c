@@ -1,18 +1,81 @@
 #include <pebble.h>
+#include "frame_profiler.h"
+#include "battery_ledger.h"
+#include "time_code.h"
+#include "gesture.h"
+#include "worker_protocol.h"
+#include "chime.h"
+#include "settings_sync.h"
 
 static Window *s_main_window;
 static TextLayer *s_time_layer;
 static TextLayer *s_date_layer;
+static TextLayer *s_code_layer;
+static TextLayer *s_chime_layer;
 static Layer *s_indicator_layer;
 
 static bool is_vibrating = false;
 
+// ------------------------------
+// 設定（電話の設定画面から。common/c/settings_sync.h）
+// ------------------------------
+// persist のキー 2 は以前の時報の設定（ひとまとめの blob）。使わない
+enum {
+  SETTING_SCHEME, SETTING_CHIME_INTERVAL, SETTING_CHIME_FIRST, SETTING_CHIME_LAST,
+  SETTING_PULSE, SETTING_GAP, SETTING_COUNT
+};
+
+static const SettingDef SETTINGS[SETTING_COUNT] = {
+  [SETTING_SCHEME]         = { &MESSAGE_KEY_scheme, 1, 0, TIME_CODE_COUNT - 1, TIME_CODE_UNARY },
+  [SETTING_CHIME_INTERVAL] = { &MESSAGE_KEY_chime_interval, 3, 0, 60, 0 },
+  [SETTING_CHIME_FIRST]    = { &MESSAGE_KEY_chime_first_hour, 4, 0, 23, 8 },
+  [SETTING_CHIME_LAST]     = { &MESSAGE_KEY_chime_last_hour, 5, 0, 23, 22 },
+  [SETTING_PULSE]          = { &MESSAGE_KEY_pulse_ms, 6, 100, 600, 300 },
+  [SETTING_GAP]            = { &MESSAGE_KEY_gap_ms, 7, 100, 500, 180 },
+};
+static int32_t s_settings[SETTING_COUNT];
+
+// 伝え方（time_code）。ボタンで選んだ方式は終了時に残す（押すたびには書かない）
+static TimeCodeScheme s_scheme = TIME_CODE_UNARY;
+
+// 次に押されたときのパターン（tick_handler で 1 分に 1 回作る）
+static TimeCode s_code;
+
+// 鳴らしている途中のパターン（偶数番目が ON、奇数番目が OFF の長さ ms）。
+// 鳴っている間に s_code が作り直されても崩れないよう、押したときに写す
+static uint32_t s_segments[TIME_CODE_MAX_SEGMENTS];
+static int s_segment_count;
+
+// インジケータはタイマー 1 つでセグメントを順にたどる（パターンの長さによらずヒープは一定）
+static AppTimer *s_indicator_timer;
+static int s_segment_index;
+
+// 手首のひねりでも鳴らす（gesture）。周波数とバッチの大きさが電池を決める：
+// 起きるのは 周波数/バッチ 回/秒、見つけてから鳴るまで最大でバッチ 1 つ分遅れる。
+// host の make gesture でトレースを流して、起きる回数と誤検出を比べて決めた値
+#define GESTURE_RATE ACCEL_SAMPLING_10HZ
+#define GESTURE_BATCH 25
+static GestureDetector s_gesture;
+
+// ワーカーが動いていれば、ひねりはワーカーが見張って知らせてくる（アプリでは購読しない）。
+// ワーカーに起こされたときは、鳴らし終わったら閉じて元の画面に戻す
+#define WORKER_START_MS 1000
+static bool s_worker;
+static bool s_exit_when_done;
+
+// 電池消費の記録（battery_ledger）で使うモード
+enum { LEDGER_IDLE, LEDGER_VIBE };
+static const char *const LEDGER_MODES[] = { "idle", "vibe" };
+
 // ===============================
 //  プロトタイプ宣言
 // ===============================
 static void set_vibe_on(void *data);
 static void set_vibe_off(void *data);
-static void schedule_vibe_indicator(uint32_t *segments, int count);
+static void set_vibe_done(void *data);
+static void start_vibe_indicator(void);
+static void cancel_vibration(void);
+static void worker_notify(WorkerMessageType type);
 
 // ===============================
 //  描画（右上の黒丸）
@@ -29,9 +92,39 @@ static void indicator_update_proc(Layer *layer, GContext *ctx) {
 // ===============================
 //  時刻表示
 // ===============================
+// 方式の名前と、モーター／全体の秒数を出す
+static void update_code_text(void) {
+  static char code_buffer[32];
+  snprintf(code_buffer, sizeof(code_buffer), "%s %d.%ds / %d.%ds",
+           time_code_name(s_scheme),
+           (int)(s_code.motor_ms / 1000), (int)(s_code.motor_ms % 1000 / 100),
+           (int)(s_code.total_ms / 1000), (int)(s_code.total_ms % 1000 / 100));
+  text_layer_set_text(s_code_layer, code_buffer);
+}
+
+// 時報の設定（例: "chime 15m 8-22"）
+static void update_chime_text(void) {
+  static char chime_buffer[24];
+  const ChimeSchedule *schedule = chime_schedule();
+  if(schedule->interval_min == 0) {
+    snprintf(chime_buffer, sizeof(chime_buffer), "chime off");
+  } else {
+    snprintf(chime_buffer, sizeof(chime_buffer), "chime %dm %d-%d", schedule->interval_min,
+             schedule->first_hour, schedule->last_hour);
+  }
+  text_layer_set_text(s_chime_layer, chime_buffer);
+}
+
+// 今の時刻を今の方式でパターンにしておく
+static void update_code(struct tm *tick_time) {
+  time_code_encode(s_scheme, tick_time->tm_hour, tick_time->tm_min, &s_code);
+  update_code_text();
+}
+
 static void update_time() {
   time_t temp = time(NULL);
   struct tm *tick_time = localtime(&temp);
+  update_code(tick_time);
 
   static char time_buffer[8];
   strftime(time_buffer, sizeof(time_buffer), "%H:%M", tick_time);
@@ -59,84 +152,127 @@ static void set_vibe_off(void *data) {
   layer_mark_dirty(s_indicator_layer);
 }
 
-static void schedule_vibe_indicator(uint32_t *segments, int count) {
-  uint32_t elapsed = 0;
-  bool state_on = true;
+// パターンの最後：インジケータを消して待機モードへ戻る
+static void set_vibe_done(void *data) {
+  set_vibe_off(data);
+  battery_ledger_set_mode(LEDGER_IDLE);
+  worker_notify(WORKER_MSG_IDLE);
+  if(s_exit_when_done) window_stack_pop_all(false);
+}
 
-  for (int i = 0; i < count; i++) {
-    if(state_on) {
-      app_timer_register(elapsed, set_vibe_on, NULL);
-    } else {
-      app_timer_register(elapsed, set_vibe_off, NULL);
-    }
+// 今のセグメントの ON/OFF にして、その長さだけ経ったら次へ進む
+static void indicator_step(void *data) {
+  s_indicator_timer = NULL;
 
-    elapsed += segments[i];
-    state_on = !state_on;
+  // 最後は必ずOFFで終了
+  if(s_segment_index >= s_segment_count) {
+    set_vibe_done(NULL);
+    return;
   }
 
-  // 最後は必ずOFFで終了
-  app_timer_register(elapsed, set_vibe_off, NULL);
+  if(s_segment_index % 2 == 0) {
+    set_vibe_on(NULL);
+  } else {
+    set_vibe_off(NULL);
+  }
+  s_indicator_timer = app_timer_register(s_segments[s_segment_index++], indicator_step, NULL);
+}
+
+static void start_vibe_indicator(void) {
+  worker_notify(WORKER_MSG_BUSY);
+  s_segment_index = 0;
+  indicator_step(NULL);
+}
+
+// 鳴っている途中なら、モーターとインジケータを両方止める
+static void cancel_vibration(void) {
+  if(!s_indicator_timer) return;
+  app_timer_cancel(s_indicator_timer);
+  s_indicator_timer = NULL;
+  vibes_cancel();
+  set_vibe_off(NULL);
+  worker_notify(WORKER_MSG_IDLE);
 }
 
 // ===============================
 //  バイブレーションパターン
 // ===============================
+// パターンは作ってあるので、写して鳴らすだけ
 static void send_time_vibration() {
-  time_t now = time(NULL);
-  struct tm *t = localtime(&now);
-
-  int hour = t->tm_hour % 12;
-  if(hour == 0) hour = 12;
+  // 前のパターンが残っていたら止めてから鳴らし直す（重ねない）
+  cancel_vibration();
+  if(s_code.count == 0) return;
 
-  int tens = t->tm_min / 10;
-  int ones = t->tm_min % 10;
+  memcpy(s_segments, s_code.durations, s_code.count * sizeof(s_segments[0]));
+  s_segment_count = s_code.count;
 
-  const uint32_t pulse = 300;
-  const uint32_t gap_short = 180;
-  const uint32_t gap_long = 500;
+  VibePattern pattern = {
+    .durations = s_segments,
+    .num_segments = s_segment_count
+  };
 
-  uint32_t segments[64];
-  int idx = 0;
+  vibes_enqueue_custom_pattern(pattern);
+  battery_ledger_set_mode(LEDGER_VIBE);
 
-  // 時
-  for(int i = 0; i < hour; i++){
-    segments[idx++] = pulse;
-    segments[idx++] = gap_short;
-  }
-  segments[idx++] = gap_long;
+  // ★ インジケータと同期
+  start_vibe_indicator();
+}
 
-  // 10分
-  if(tens == 0) {
-    segments[idx++] = pulse * 2;
-    segments[idx++] = gap_short;
-  } else {
-    for(int i = 0; i < tens; i++){
-      segments[idx++] = pulse;
-      segments[idx++] = gap_short;
+// ===============================
+//  ジェスチャ
+// ===============================
+static void accel_data_handler(AccelData *data, uint32_t num_samples) {
+  for(uint32_t i = 0; i < num_samples; i++) {
+    // 自分のパターンが鳴っている間の揺れは数えない
+    if(s_indicator_timer || data[i].did_vibrate) {
+      gesture_reset(&s_gesture);
+      continue;
     }
+    if(gesture_feed(&s_gesture, data[i].x, data[i].y, data[i].z)) send_time_vibration();
   }
-  segments[idx++] = gap_long;
+}
 
-  // 1分
-  if(ones == 0) {
-    segments[idx++] = pulse * 2;
-    segments[idx++] = gap_short;
-  } else {
-    for(int i = 0; i < ones; i++){
-      segments[idx++] = pulse;
-      segments[idx++] = gap_short;
-    }
-  }
+// ===============================
+//  ワーカー
+// ===============================
+static void worker_notify(WorkerMessageType type) {
+  if(!s_worker) return;
+  AppWorkerMessage msg = { 0 };
+  app_worker_send_message(type, &msg);
+}
 
-  VibePattern pattern = {
-    .durations = segments,
-    .num_segments = idx
-  };
+static void worker_message_handler(uint16_t type, AppWorkerMessage *data) {
+  if(type == WORKER_MSG_GESTURE) send_time_vibration();
+}
 
-  vibes_enqueue_custom_pattern(pattern);
+static void announce_open(void *data) {
+  worker_notify(WORKER_MSG_APP_OPEN);
+}
 
-  // ★ インジケータと同期
-  schedule_vibe_indicator(segments, idx);
+// ワーカーを動かす（初回は本体が確認を出すので、その回はアプリで見張る）
+static void start_gesture(void) {
+  bool running = app_worker_is_running();
+  bool launched = !running && app_worker_launch() == APP_WORKER_RESULT_SUCCESS;
+  s_worker = running || launched;
+  if(s_worker) {
+    app_worker_message_subscribe(worker_message_handler);
+    announce_open(NULL);
+    // 今起こしたワーカーは最初のメッセージを取りこぼすことがあるので、少し後にもう一度
+    if(launched) app_timer_register(WORKER_START_MS, announce_open, NULL);
+    return;
+  }
+  gesture_init(&s_gesture, GESTURE_RATE);
+  accel_data_service_subscribe(GESTURE_BATCH, accel_data_handler);
+  accel_service_set_sampling_rate(GESTURE_RATE);
+}
+
+static void stop_gesture(void) {
+  if(s_worker) {
+    worker_notify(WORKER_MSG_APP_CLOSED);
+    app_worker_message_unsubscribe();
+  } else {
+    accel_data_service_unsubscribe();
+  }
 }
 
 // ===============================
@@ -146,8 +282,63 @@ static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
   send_time_vibration();
 }
 
+// 長押しで時報の間隔を切り替える（切 → 60 → 30 → 15 分）
+static void select_long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  ChimeSchedule schedule = *chime_schedule();
+  schedule.interval_min = chime_next_interval(schedule.interval_min);
+  settings_sync_set(SETTING_CHIME_INTERVAL, schedule.interval_min);
+  chime_set_schedule(&schedule);
+  update_chime_text();
+}
+
+// 伝え方を切り替える（UP で次、DOWN で前）
+static void select_scheme(int step) {
+  s_scheme = (TimeCodeScheme)((s_scheme + step + TIME_CODE_COUNT) % TIME_CODE_COUNT);
+
+  time_t now = time(NULL);
+  update_code(localtime(&now));
+}
+
+static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
+  select_scheme(1);
+}
+
+static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
+  select_scheme(-1);
+}
+
 static void click_config_provider(void *context) {
   window_single_click_subscribe(BUTTON_ID_SELECT, select_click_handler);
+  window_long_click_subscribe(BUTTON_ID_SELECT, 0, select_long_click_handler, NULL);
+  window_single_click_subscribe(BUTTON_ID_UP, up_click_handler);
+  window_single_click_subscribe(BUTTON_ID_DOWN, down_click_handler);
+  battery_ledger_long_click_subscribe(BUTTON_ID_UP);
+  frame_profiler_long_click_subscribe(BUTTON_ID_DOWN);
+}
+
+// ===============================
+//  設定
+// ===============================
+static ChimeSchedule settings_chime_schedule(void) {
+  return (ChimeSchedule){
+    .interval_min = s_settings[SETTING_CHIME_INTERVAL],
+    .first_hour = s_settings[SETTING_CHIME_FIRST],
+    .last_hour = s_settings[SETTING_CHIME_LAST],
+  };
+}
+
+// 電話から設定が届いた（鳴っている途中のパターンはそのまま、次に押したときから）。
+// 方式は UP/DOWN で変えたものを終了時まで保存しないので、電話で方式を変えたときだけ上書きする
+static void settings_changed(uint32_t changed) {
+  if(changed & (1u << SETTING_SCHEME)) s_scheme = (TimeCodeScheme)s_settings[SETTING_SCHEME];
+  time_code_set_timing(s_settings[SETTING_PULSE], s_settings[SETTING_GAP]);
+
+  ChimeSchedule schedule = settings_chime_schedule();
+  chime_set_schedule(&schedule);
+
+  time_t now = time(NULL);
+  update_code(localtime(&now));
+  update_chime_text();
 }
 
 // ===============================
@@ -167,15 +358,28 @@ static void main_window_load(Window *window) {
   text_layer_set_text_alignment(s_date_layer, GTextAlignmentCenter);
   layer_add_child(root, text_layer_get_layer(s_date_layer));
 
+  s_code_layer = text_layer_create(GRect(0, bounds.size.h - 30, bounds.size.w, 24));
+  text_layer_set_font(s_code_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_alignment(s_code_layer, GTextAlignmentCenter);
+  layer_add_child(root, text_layer_get_layer(s_code_layer));
+
+  s_chime_layer = text_layer_create(GRect(4, 4, bounds.size.w - 30, 20));
+  text_layer_set_font(s_chime_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14));
+  layer_add_child(root, text_layer_get_layer(s_chime_layer));
+  update_chime_text();
+
   // ★ インジケータレイヤー
   s_indicator_layer = layer_create(bounds);
-  layer_set_update_proc(s_indicator_layer, indicator_update_proc);
+  frame_profiler_attach(s_indicator_layer, indicator_update_proc);
   layer_add_child(root, s_indicator_layer);
 }
 
 static void main_window_unload(Window *window) {
+  cancel_vibration();
   text_layer_destroy(s_time_layer);
   text_layer_destroy(s_date_layer);
+  text_layer_destroy(s_code_layer);
+  text_layer_destroy(s_chime_layer);
   layer_destroy(s_indicator_layer);
 }
 
@@ -183,6 +387,18 @@ static void main_window_unload(Window *window) {
 //  main
 // ===============================
 static void init() {
+  frame_profiler_init("silentwatch");
+  battery_ledger_init(LEDGER_MODES, ARRAY_LENGTH(LEDGER_MODES));
+
+  settings_sync_init(&MESSAGE_KEY_settings_revision, SETTINGS, s_settings, SETTING_COUNT,
+                     settings_changed);
+  s_scheme = (TimeCodeScheme)s_settings[SETTING_SCHEME];
+  time_code_set_timing(s_settings[SETTING_PULSE], s_settings[SETTING_GAP]);
+
+  // 時報の wakeup で起こされたか（どちらにしても次の時報を予約し直す）
+  ChimeSchedule schedule = settings_chime_schedule();
+  bool chime = chime_init(send_time_vibration, &schedule);
+
   s_main_window = window_create();
   window_set_click_config_provider(s_main_window, click_config_provider);
 
@@ -195,10 +411,23 @@ static void init() {
 
   tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
   update_time();
+
+  // 時報、またはワーカーがひねりを見つけて起こした：すぐ鳴らし、終わったら閉じる。
+  // 時報のときはジェスチャも始めない（鳴らす間のほかは何もしない）
+  if(!chime) start_gesture();
+  if(chime || launch_reason() == APP_LAUNCH_WORKER) {
+    s_exit_when_done = true;
+    send_time_vibration();
+  }
 }
 
 static void deinit() {
+  stop_gesture();
+  settings_sync_set(SETTING_SCHEME, s_scheme);
+  settings_sync_deinit();
   window_destroy(s_main_window);
+  battery_ledger_deinit();
+  frame_profiler_deinit();
 }
 
 int main(void) {
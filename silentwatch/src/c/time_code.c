@@ -0,0 +1,156 @@
+#include "time_code.h"
+
+// ================================
+//  長さ（ms）
+// ================================
+// unary は元の send_time_vibration と同じ長さ
+#define UNARY_PULSE     300
+#define UNARY_ZERO      600
+#define UNARY_GAP       180
+#define UNARY_GROUP_GAP 500
+
+// 長短で区別する方式（quarter / binary / roman）。短い方は指で数えられる下限くらい
+#define MARK_LONG       450
+#define MARK_SHORT      120
+#define MARK_TICK       60    // 0 の印
+#define MARK_GAP        250
+#define MARK_GROUP_GAP  700
+
+// 設定画面で選んだ長さ（time_code_set_timing）。上の値はこの比で伸び縮みする
+static uint32_t s_pulse_ms = UNARY_PULSE;
+static uint32_t s_gap_ms = UNARY_GAP;
+
+static uint32_t scale_on(uint32_t ms) {
+  return ms * s_pulse_ms / UNARY_PULSE;
+}
+
+static uint32_t scale_off(uint32_t ms) {
+  return ms * s_gap_ms / UNARY_GAP;
+}
+
+// ================================
+//  パターンを積む
+// ================================
+// ON と OFF を必ず組で積む（偶数番目が ON のまま崩れない）
+static void emit(TimeCode *c, uint32_t on, uint32_t off) {
+  if(c->count + 2 > TIME_CODE_MAX_SEGMENTS) return;
+  on = scale_on(on);
+  off = scale_off(off);
+  c->durations[c->count++] = on;
+  c->durations[c->count++] = off;
+  c->motor_ms += on;
+  c->total_ms += on + off;
+}
+
+// グループの区切り：直前の OFF を gap まで延ばす
+static void separate(TimeCode *c, uint32_t gap) {
+  if(c->count == 0) return;
+  gap = scale_off(gap);
+  uint32_t *off = &c->durations[c->count - 1];
+  if(*off < gap) {
+    c->total_ms += gap - *off;
+    *off = gap;
+  }
+}
+
+// 最後の OFF は鳴らす意味がないので落とす
+static void finish(TimeCode *c) {
+  if(c->count == 0) return;
+  c->total_ms -= c->durations[--c->count];
+}
+
+static void repeat(TimeCode *c, int n, uint32_t on, uint32_t off) {
+  for(int i = 0; i < n; i++) emit(c, on, off);
+}
+
+// ================================
+//  方式
+// ================================
+static void encode_unary(TimeCode *c, int hour, int minute) {
+  int digits[3] = { hour, minute / 10, minute % 10 };
+  for(int g = 0; g < 3; g++) {
+    // 時は 1〜12 なので 0 になるのは分だけ
+    if(digits[g] == 0) emit(c, UNARY_ZERO, UNARY_GAP);
+    else repeat(c, digits[g], UNARY_PULSE, UNARY_GAP);
+    separate(c, UNARY_GROUP_GAP);
+  }
+}
+
+static void encode_quarter(TimeCode *c, int hour, int minute) {
+  repeat(c, hour, MARK_SHORT, MARK_GAP);
+  separate(c, MARK_GROUP_GAP);
+
+  // 5 分単位に切り捨て。ちょうどの時は印だけ
+  int quarters = minute / 15;
+  int fives = (minute % 15) / 5;
+  if(quarters == 0 && fives == 0) emit(c, MARK_TICK, MARK_GAP);
+  repeat(c, quarters, MARK_LONG, MARK_GAP);
+  repeat(c, fives, MARK_SHORT, MARK_GAP);
+}
+
+static void encode_bits(TimeCode *c, int value, int bits) {
+  for(int i = bits - 1; i >= 0; i--) {
+    emit(c, (value >> i) & 1 ? MARK_LONG : MARK_SHORT, MARK_GAP);
+  }
+}
+
+static void encode_binary(TimeCode *c, int hour, int minute) {
+  encode_bits(c, hour, 4);
+  separate(c, MARK_GROUP_GAP);
+  encode_bits(c, minute, 6);
+}
+
+// 5 を長く、1 を短く（例: 8 = 長 短 短 短）
+static void encode_roman_digit(TimeCode *c, int n) {
+  if(n == 0) {
+    emit(c, MARK_TICK, MARK_GAP);
+    return;
+  }
+  repeat(c, n / 5, MARK_LONG, MARK_GAP);
+  repeat(c, n % 5, MARK_SHORT, MARK_GAP);
+}
+
+static void encode_roman(TimeCode *c, int hour, int minute) {
+  encode_roman_digit(c, hour);
+  separate(c, MARK_GROUP_GAP);
+  encode_roman_digit(c, minute / 10);
+  separate(c, MARK_GROUP_GAP);
+  encode_roman_digit(c, minute % 10);
+}
+
+typedef struct {
+  const char *name;
+  void (*encode)(TimeCode *c, int hour, int minute);
+} Scheme;
+
+static const Scheme SCHEMES[TIME_CODE_COUNT] = {
+  [TIME_CODE_UNARY]   = { "unary",   encode_unary },
+  [TIME_CODE_QUARTER] = { "quarter", encode_quarter },
+  [TIME_CODE_BINARY]  = { "binary",  encode_binary },
+  [TIME_CODE_ROMAN]   = { "roman",   encode_roman },
+};
+
+// ================================
+//  公開関数
+// ================================
+const char *time_code_name(TimeCodeScheme scheme) {
+  if(scheme < 0 || scheme >= TIME_CODE_COUNT) return "?";
+  return SCHEMES[scheme].name;
+}
+
+void time_code_set_timing(uint32_t pulse_ms, uint32_t gap_ms) {
+  s_pulse_ms = pulse_ms ? pulse_ms : UNARY_PULSE;
+  s_gap_ms = gap_ms ? gap_ms : UNARY_GAP;
+}
+
+void time_code_encode(TimeCodeScheme scheme, int hour, int minute, TimeCode *out) {
+  out->count = 0;
+  out->motor_ms = 0;
+  out->total_ms = 0;
+  if(scheme < 0 || scheme >= TIME_CODE_COUNT) return;
+
+  int hour12 = hour % 12;
+  if(hour12 == 0) hour12 = 12;
+  SCHEMES[scheme].encode(out, hour12, minute);
+  finish(out);
+}
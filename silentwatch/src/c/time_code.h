@@ -0,0 +1,44 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// ================================
+//  time_code: 時刻をバイブのパターンにする（方式は選べる）
+// ================================
+// パターンは VibePattern と同じ形（偶数番目が ON、奇数番目が OFF の長さ ms）。
+// モーターが回っている時間が一番電池を使うので、方式ごとに ON の合計と
+// 全体の長さを一緒に出す。tick_handler で 1 分に 1 回作っておき、ボタンでは鳴らすだけにする。
+//
+//   TimeCode code;
+//   time_code_encode(TIME_CODE_BINARY, 11, 59, &code);
+//   code.motor_ms, code.total_ms
+//   time_code_set_timing(250, 150);   // 設定画面の長さ（unary の 1 回と間隔。既定 300 / 180）
+//
+// SDK に依存しない（ホストの評価からも使える）。
+
+// 一番長い unary（12 時 59 分）で 52。余裕を見て
+#define TIME_CODE_MAX_SEGMENTS 64
+
+typedef enum {
+  TIME_CODE_UNARY,     // 時・10 分・1 分をその数だけ（0 は長い 1 回）
+  TIME_CODE_QUARTER,   // 時、15 分ごとに長く 1 回、残りの 5 分ごとに短く 1 回（5 分単位）
+  TIME_CODE_BINARY,    // 時 4 桁・分 6 桁の 2 進（1 が長い、0 が短い）
+  TIME_CODE_ROMAN,     // 5 を長く 1 回、1 を短く 1 回（時・10 分・1 分。0 はごく短く 1 回）
+  TIME_CODE_COUNT
+} TimeCodeScheme;
+
+typedef struct {
+  uint32_t durations[TIME_CODE_MAX_SEGMENTS];
+  int count;
+  uint32_t motor_ms;   // ON の合計
+  uint32_t total_ms;   // 最初の ON から最後の ON の終わりまで
+} TimeCode;
+
+const char *time_code_name(TimeCodeScheme scheme);
+
+// ON は pulse_ms / 300、OFF は gap_ms / 180 の比で全方式の長さを伸び縮みさせる
+// （次の time_code_encode から）。0 は既定のまま
+void time_code_set_timing(uint32_t pulse_ms, uint32_t gap_ms);
+
+// hour は 0〜23（12 時間にして 1〜12 で伝える）、minute は 0〜59
+void time_code_encode(TimeCodeScheme scheme, int hour, int minute, TimeCode *out);
@@ -0,0 +1,16 @@
+#pragma once
+
+// ================================
+//  アプリとワーカーのメッセージ（app_worker_send_message の type）
+// ================================
+// ワーカー（worker_src/c）は一日中ひねりを見張る。アプリが前面にいれば
+// 見つけたことを送り、いなければ worker_launch_app() でアプリを起こす
+// （ワーカーからはバイブを鳴らせないので、鳴らすのは常にアプリ）。
+// 中身（AppWorkerMessage）は使わない。
+typedef enum {
+  WORKER_MSG_GESTURE = 1,  // ワーカー → アプリ: ひねりを見つけた
+  WORKER_MSG_APP_OPEN,     // アプリ → ワーカー: 前面に出た（見つけたら送ってほしい）
+  WORKER_MSG_APP_CLOSED,   // アプリ → ワーカー: 閉じた（見つけたらアプリを起こしてほしい）
+  WORKER_MSG_BUSY,         // アプリ → ワーカー: パターンを鳴らし始めた（その間は数えない）
+  WORKER_MSG_IDLE,         // アプリ → ワーカー: 鳴らし終わった
+} WorkerMessageType;
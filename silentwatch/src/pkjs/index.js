@@ -1,5 +1,16 @@
-Pebble.addEventListener("ready",
-    function(e) {
-        console.log("Hello world! - Sent from your javascript application.");
-    }
-);
+// 設定画面とウォッチへの同期（アプリ間で共有。wscript が一緒に同梱する）
+var settings = require('../../../common/pkjs/settings_sync');
+
+// fallback は src/c/silentwatch.c の SETTINGS と同じ値
+settings.init('silentwatch', [
+  { key: 'scheme', label: 'Code (0 unary, 1 quarter, 2 binary, 3 roman)', min: 0, max: 3,
+    fallback: 0 },
+  { key: 'pulse_ms', label: 'Pulse length (ms)', min: 100, max: 600, fallback: 300 },
+  { key: 'gap_ms', label: 'Gap length (ms)', min: 100, max: 500, fallback: 180 },
+  // src/c/chime.c の INTERVALS と同じ選択肢
+  { key: 'chime_interval', label: 'Chime every (min, 0 off)', options: [0, 15, 30, 60],
+    fallback: 0 },
+  { key: 'chime_first_hour', label: 'Chime from hour', min: 0, max: 23, fallback: 8 },
+  { key: 'chime_last_hour', label: 'Chime until hour (before "from" wraps past midnight)',
+    min: 0, max: 23, fallback: 22 }
+]);
@@ -0,0 +1,206 @@
+// ================================
+//  silentwatch ジェスチャ判定の評価
+// ================================
+// 加速度トレース（tools/trace_gen.py の形。実機で取ったものも同じ形にする）を
+// src/c/gesture.c にそのまま流し、サンプリング周波数とバッチの大きさの
+// 組み合わせごとに、1 時間あたりの起床回数・正解の検出率・誤検出の回数・
+// 鳴るまでの遅れを出す。
+//
+//   make -C host gesture                   （合成トレースを作ってから流す）
+//   gesture_eval [--rate HZ] [--batch N] trace.txt...
+//
+// トレースは周波数ごとに区間平均で間引く（センサ側のフィルタの代わり）。
+// 判定はサンプル単位なので、バッチの大きさは起床回数と遅れだけを変える。
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gesture.h"
+
+#define MAX_GESTURES 4096
+#define MATCH_MS 3000        // 印からこの時間内に見つければ正解
+
+static const int RATES[] = { 10, 25, 50, 100 };
+static const int BATCHES[] = { 1, 5, 10, 25 };
+#define RATE_COUNT (int)(sizeof(RATES) / sizeof(RATES[0]))
+#define BATCH_COUNT (int)(sizeof(BATCHES) / sizeof(BATCHES[0]))
+
+// ------------------------------
+// トレース
+// ------------------------------
+typedef struct {
+  const char *path;
+  int rate;
+  int count;
+  int16_t (*xyz)[3];
+  int gesture_count;
+  long long gestures[MAX_GESTURES];
+} Trace;
+
+static bool trace_load(const char *path, Trace *tr) {
+  FILE *f = fopen(path, "r");
+  if(!f) return false;
+  memset(tr, 0, sizeof(*tr));
+  tr->path = path;
+  tr->rate = 100;
+  int capacity = 0;
+  char line[256];
+  while(fgets(line, sizeof(line), f)) {
+    long long t;
+    int x, y, z;
+    if(line[0] == '#') {
+      if(sscanf(line, "# rate %d", &tr->rate) == 1) continue;
+      if(sscanf(line, "# gesture %lld", &t) == 1 && tr->gesture_count < MAX_GESTURES) {
+        tr->gestures[tr->gesture_count++] = t;
+      }
+      continue;
+    }
+    if(sscanf(line, "%lld %d %d %d", &t, &x, &y, &z) != 4) continue;
+    if(tr->count == capacity) {
+      capacity = capacity ? capacity * 2 : 4096;
+      tr->xyz = realloc(tr->xyz, capacity * sizeof(*tr->xyz));
+    }
+    tr->xyz[tr->count][0] = x;
+    tr->xyz[tr->count][1] = y;
+    tr->xyz[tr->count][2] = z;
+    tr->count++;
+  }
+  fclose(f);
+  return tr->count > 0;
+}
+
+static double trace_hours(const Trace *tr) {
+  return (double)tr->count / tr->rate / 3600;
+}
+
+// ------------------------------
+// 1 つの周波数で流す
+// ------------------------------
+typedef struct {
+  int gestures;
+  int hits;
+  int false_triggers;
+  double hours;
+  // バッチごとの遅れの合計（印から、検出したサンプルを含むバッチが届くまで）
+  double latency_ms[BATCH_COUNT];
+} Result;
+
+static void run(const Trace *tr, int rate, Result *out) {
+  GestureDetector g;
+  gesture_init(&g, rate);
+
+  int step = tr->rate / rate;
+  if(step < 1) step = 1;
+  int n = tr->count / step;
+  bool *matched = calloc(tr->gesture_count + 1, sizeof(bool));
+
+  out->gestures += tr->gesture_count;
+  out->hours += trace_hours(tr);
+  for(int k = 0; k < n; k++) {
+    int sum[3] = { 0, 0, 0 };
+    for(int i = 0; i < step; i++) {
+      for(int a = 0; a < 3; a++) sum[a] += tr->xyz[k * step + i][a];
+    }
+    if(!gesture_feed(&g, sum[0] / step, sum[1] / step, sum[2] / step)) continue;
+
+    long long t = (long long)(k + 1) * 1000 / rate;
+    int hit = -1;
+    for(int i = 0; i < tr->gesture_count; i++) {
+      if(!matched[i] && t >= tr->gestures[i] && t <= tr->gestures[i] + MATCH_MS) {
+        hit = i;
+        break;
+      }
+    }
+    if(hit < 0) {
+      out->false_triggers++;
+      continue;
+    }
+    matched[hit] = true;
+    out->hits++;
+    for(int b = 0; b < BATCH_COUNT; b++) {
+      long long delivered = (long long)((k / BATCHES[b]) + 1) * BATCHES[b] * 1000 / rate;
+      out->latency_ms[b] += delivered - tr->gestures[hit];
+    }
+  }
+  free(matched);
+}
+
+// ------------------------------
+// main
+// ------------------------------
+int main(int argc, char **argv) {
+  int only_rate = 0, only_batch = 0;
+  static const struct option options[] = {
+    { "rate", required_argument, NULL, 'r' },
+    { "batch", required_argument, NULL, 'b' },
+    { NULL, 0, NULL, 0 },
+  };
+  int c;
+  while((c = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch(c) {
+      case 'r': only_rate = atoi(optarg); break;
+      case 'b': only_batch = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [--rate HZ] [--batch N] trace.txt...\n", argv[0]);
+        return 2;
+    }
+  }
+  int trace_count = argc - optind;
+  if(trace_count < 1) {
+    fprintf(stderr, "usage: %s [--rate HZ] [--batch N] trace.txt...\n", argv[0]);
+    return 2;
+  }
+  Trace *traces = calloc(trace_count, sizeof(Trace));
+  for(int i = 0; i < trace_count; i++) {
+    if(!trace_load(argv[optind + i], &traces[i])) {
+      fprintf(stderr, "cannot read %s\n", argv[optind + i]);
+      return 1;
+    }
+  }
+
+  // トレースごとの誤検出（周波数ごと）
+  printf("%-24s %7s %8s", "trace", "hours", "gestures");
+  for(int r = 0; r < RATE_COUNT; r++) {
+    if(only_rate && RATES[r] != only_rate) continue;
+    printf("   %3dHz hit/false", RATES[r]);
+  }
+  printf("\n");
+  Result totals[RATE_COUNT];
+  memset(totals, 0, sizeof(totals));
+  for(int i = 0; i < trace_count; i++) {
+    const char *name = strrchr(traces[i].path, '/');
+    printf("%-24s %7.3f %8d", name ? name + 1 : traces[i].path, trace_hours(&traces[i]),
+           traces[i].gesture_count);
+    for(int r = 0; r < RATE_COUNT; r++) {
+      if(only_rate && RATES[r] != only_rate) continue;
+      Result one = { 0 };
+      run(&traces[i], RATES[r], &one);
+      printf("   %9d/%-5d", one.hits, one.false_triggers);
+
+      Result *t = &totals[r];
+      t->gestures += one.gestures;
+      t->hits += one.hits;
+      t->false_triggers += one.false_triggers;
+      t->hours += one.hours;
+      for(int b = 0; b < BATCH_COUNT; b++) t->latency_ms[b] += one.latency_ms[b];
+    }
+    printf("\n");
+  }
+
+  // 組み合わせごとの合計
+  printf("\n%5s %5s %10s %7s %8s %10s\n", "rate", "batch", "wakeups/h", "recall", "false/h",
+         "latency");
+  for(int r = 0; r < RATE_COUNT; r++) {
+    if(only_rate && RATES[r] != only_rate) continue;
+    const Result *t = &totals[r];
+    for(int b = 0; b < BATCH_COUNT; b++) {
+      if(only_batch && BATCHES[b] != only_batch) continue;
+      printf("%3dHz %5d %10.0f %6.1f%% %8.2f %8.0fms\n", RATES[r], BATCHES[b],
+             3600.0 * RATES[r] / BATCHES[b],
+             t->gestures ? 100.0 * t->hits / t->gestures : 0.0,
+             t->hours > 0 ? t->false_triggers / t->hours : 0.0,
+             t->hits ? t->latency_ms[b] / t->hits : 0.0);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+# ================================
+#  加速度トレースの合成（ジェスチャ判定の評価用）
+# ================================
+# 100Hz の「t_ms x y z」（mg）を書き出す。意図したジェスチャの開始時刻は
+# 「# gesture T_MS」の行で印を付ける（tools/gesture_eval.c が正解として使う）。
+# 実機で取ったトレースも同じ形にすれば一緒に評価できる。
+#
+#   trace_gen.py OUT_DIR [--seed N] [--minutes M]
+#
+# シナリオ（乱数の種を変えても傾向は同じ）:
+#   desk     机で作業。ときどき文字盤を見てひねる（正解あり）
+#   walk     歩く。腕を振り続ける（正解なし）
+#   glance   腕を上げて文字盤を見て下ろす、を繰り返す（正解なし）
+#   typing   キーボードを打つ。文字盤は上で小刻みに揺れる（正解なし）
+#   fidget   机の上で手を返す・マウスを握り直す。ひねりに近い動きを含む（正解なし）
+#   mixed    上のすべてを混ぜた 1 日の縮図（正解あり）
+import math
+import os
+import random
+import sys
+
+RATE = 100
+DT = 1000 // RATE
+NOISE_MG = 12
+
+
+class Trace:
+    def __init__(self, rng):
+        self.rng = rng
+        self.samples = []
+        self.gestures = []
+        # 文字盤の向き（x 軸＝前腕まわりのひねり、y 軸まわりの傾き）
+        self.roll = 0.0
+        self.pitch = 0.0
+
+    @property
+    def t(self):
+        return len(self.samples) * DT
+
+    def emit(self, extra=(0.0, 0.0, 0.0)):
+        r, p = self.roll, self.pitch
+        g = (1000 * math.sin(p),
+             1000 * math.sin(r) * math.cos(p),
+             -1000 * math.cos(r) * math.cos(p))
+        self.samples.append(tuple(
+            int(round(g[i] + extra[i] + self.rng.gauss(0, NOISE_MG))) for i in range(3)))
+
+    def hold(self, ms, jitter=0.0):
+        for _ in range(ms // DT):
+            j = (self.rng.gauss(0, jitter), self.rng.gauss(0, jitter), self.rng.gauss(0, jitter))
+            self.emit(j)
+
+    def move_to(self, roll, pitch, ms):
+        # なめらかに（余弦補間）
+        r0, p0 = self.roll, self.pitch
+        n = max(1, ms // DT)
+        for i in range(1, n + 1):
+            a = (1 - math.cos(math.pi * i / n)) / 2
+            self.roll = r0 + (roll - r0) * a
+            self.pitch = p0 + (pitch - p0) * a
+            self.emit()
+
+    # ---- 動き ----
+    def twist(self):
+        self.gestures.append(self.t)
+        side = self.rng.choice((-1, 1))
+        angle = math.radians(self.rng.uniform(80, 110)) * side
+        self.move_to(angle, self.pitch, int(self.rng.uniform(180, 350)))
+        self.hold(int(self.rng.uniform(0, 200)))
+        self.move_to(0.0, self.pitch, int(self.rng.uniform(180, 350)))
+
+    def rest_face_up(self, ms, jitter=4.0):
+        self.move_to(0.0, math.radians(self.rng.uniform(-15, 15)), 300)
+        self.hold(ms, jitter)
+
+    def walk(self, ms):
+        # 腕は下（文字盤は横向き）で前後に振れ、一歩ごとに衝撃
+        self.move_to(math.radians(85), math.radians(-60), 500)
+        period = self.rng.uniform(1000, 1200)
+        start = self.t
+        while self.t - start < ms:
+            ph = 2 * math.pi * (self.t - start) / period
+            self.pitch = math.radians(-60 + 25 * math.sin(ph))
+            self.roll = math.radians(85 + 15 * math.sin(ph + 0.7))
+            step = 400 * math.exp(-(((self.t - start) % (period / 2)) / 40.0))
+            self.emit((0.0, 0.0, step))
+
+    def glance(self):
+        self.move_to(math.radians(85), math.radians(-60), 300)
+        self.hold(int(self.rng.uniform(1000, 4000)), 20)
+        self.move_to(0.0, math.radians(self.rng.uniform(-10, 10)), int(self.rng.uniform(300, 700)))
+        self.hold(int(self.rng.uniform(1500, 5000)), 6)
+        self.move_to(math.radians(self.rng.uniform(70, 95)), math.radians(-60),
+                     int(self.rng.uniform(300, 800)))
+        self.hold(int(self.rng.uniform(1000, 4000)), 20)
+
+    def typing(self, ms):
+        self.move_to(math.radians(self.rng.uniform(-20, 20)), 0.0, 300)
+        start = self.t
+        while self.t - start < ms:
+            burst = self.rng.random() < 0.3
+            self.emit((0.0, 0.0, self.rng.gauss(0, 150 if burst else 10)))
+
+    def fidget(self):
+        # 角度も速さもばらばらに手首を返して戻す（多くはひねりより浅いか遅い）
+        angle = math.radians(self.rng.uniform(20, 120)) * self.rng.choice((-1, 1))
+        self.move_to(angle, self.pitch, int(self.rng.uniform(200, 1200)))
+        self.hold(int(self.rng.uniform(0, 2000)), 15)
+        self.move_to(0.0, self.pitch, int(self.rng.uniform(200, 1200)))
+
+
+def scenario(name, rng, minutes):
+    tr = Trace(rng)
+    end = minutes * 60000
+    while tr.t < end:
+        kind = name if name != 'mixed' else rng.choice(('desk', 'walk', 'glance', 'typing', 'fidget'))
+        if kind == 'desk':
+            tr.rest_face_up(int(rng.uniform(2000, 15000)))
+            if rng.random() < 0.5:
+                tr.twist()
+        elif kind == 'walk':
+            tr.walk(int(rng.uniform(10000, 60000)))
+        elif kind == 'glance':
+            tr.glance()
+        elif kind == 'fidget':
+            tr.rest_face_up(int(rng.uniform(500, 5000)))
+            tr.fidget()
+        elif kind == 'typing':
+            tr.typing(int(rng.uniform(5000, 30000)))
+            if name == 'mixed' and rng.random() < 0.3:
+                tr.rest_face_up(int(rng.uniform(800, 2000)))
+                tr.twist()
+    return tr
+
+
+def write(tr, path, name, seed):
+    with open(path, 'w') as f:
+        f.write('# silentwatch accel trace (synthetic: %s, seed %d)\n' % (name, seed))
+        f.write('# rate %d\n' % RATE)
+        for g in tr.gestures:
+            f.write('# gesture %d\n' % g)
+        for i, (x, y, z) in enumerate(tr.samples):
+            f.write('%d %d %d %d\n' % (i * DT, x, y, z))
+
+
+def main(argv):
+    out_dir = None
+    seed = 1
+    minutes = 10
+    args = iter(argv[1:])
+    for a in args:
+        if a == '--seed':
+            seed = int(next(args))
+        elif a == '--minutes':
+            minutes = int(next(args))
+        else:
+            out_dir = a
+    if not out_dir:
+        sys.stderr.write('usage: trace_gen.py OUT_DIR [--seed N] [--minutes M]\n')
+        return 2
+    os.makedirs(out_dir, exist_ok=True)
+    for i, name in enumerate(('desk', 'walk', 'glance', 'typing', 'fidget', 'mixed')):
+        tr = scenario(name, random.Random(seed * 100 + i), minutes)
+        write(tr, os.path.join(out_dir, name + '.txt'), name, seed)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,84 @@
+#include <pebble_worker.h>
+#include "gesture.h"
+#include "worker_protocol.h"
+
+// ================================
+//  silentwatch ワーカー
+// ================================
+// 他のアプリやウォッチフェイスが前面にいる間も、手首のひねりを見張る。
+// ワーカーのメモリと CPU は小さいので、持つのは判定の状態だけ
+// （パターンを作って鳴らすのはアプリ。src/c/worker_protocol.h）。
+// 周波数とバッチはアプリと同じ（起きるのは 10Hz / 25 で 2.5 秒に 1 回）。
+#define GESTURE_RATE ACCEL_SAMPLING_10HZ
+#define GESTURE_BATCH 25
+
+// アプリが BUSY のまま IDLE を返さなかったとき（起動に失敗したなど）の上限
+#define BUSY_TIMEOUT_S 30
+
+static GestureDetector s_gesture;
+static bool s_app_open;
+static time_t s_busy_until;
+
+// ===============================
+//  ジェスチャ
+// ===============================
+static void accel_data_handler(AccelData *data, uint32_t num_samples) {
+  for(uint32_t i = 0; i < num_samples; i++) {
+    // アプリがパターンを鳴らしている間の揺れは数えない
+    if(data[i].did_vibrate || time(NULL) < s_busy_until) {
+      gesture_reset(&s_gesture);
+      continue;
+    }
+    if(!gesture_feed(&s_gesture, data[i].x, data[i].y, data[i].z)) continue;
+
+    if(s_app_open) {
+      AppWorkerMessage msg = { 0 };
+      app_worker_send_message(WORKER_MSG_GESTURE, &msg);
+    } else {
+      worker_launch_app();
+    }
+    s_busy_until = time(NULL) + BUSY_TIMEOUT_S;
+  }
+}
+
+// ===============================
+//  アプリからのメッセージ
+// ===============================
+static void app_message_handler(uint16_t type, AppWorkerMessage *data) {
+  switch(type) {
+    case WORKER_MSG_APP_OPEN:
+      s_app_open = true;
+      break;
+    case WORKER_MSG_APP_CLOSED:
+      s_app_open = false;
+      s_busy_until = 0;
+      break;
+    case WORKER_MSG_BUSY:
+      s_busy_until = time(NULL) + BUSY_TIMEOUT_S;
+      break;
+    case WORKER_MSG_IDLE:
+      s_busy_until = 0;
+      break;
+  }
+}
+
+// ===============================
+//  main
+// ===============================
+static void worker_init() {
+  gesture_init(&s_gesture, GESTURE_RATE);
+  app_worker_message_subscribe(app_message_handler);
+  accel_data_service_subscribe(GESTURE_BATCH, accel_data_handler);
+  accel_service_set_sampling_rate(GESTURE_RATE);
+}
+
+static void worker_deinit() {
+  accel_data_service_unsubscribe();
+  app_worker_message_unsubscribe();
+}
+
+int main(void) {
+  worker_init();
+  worker_event_loop();
+  worker_deinit();
+}